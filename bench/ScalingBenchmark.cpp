@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+
+/**
+ * Options of a scaling benchmark, parsed from the command line
+ */
+struct BenchmarkOptions {
+    std::string mode;
+    std::vector<int> rank_counts;
+    int length = 0;
+    int max_time = 0;
+    int repeats = 1;
+    std::string cats = "./cats";
+    std::string mpirun = "mpirun --oversubscribe";
+    std::string input_dir = ".";
+    std::string work_dir = "bench-runs";
+    std::string output = "scaling.csv";
+};
+
+/**
+ * Measurements of a single run of the simulation
+ */
+struct RunResult {
+    int ranks;
+    int length;
+    std::vector<double> rates;
+    double wall_time;
+};
+
+/**
+ * Prints the usage of the benchmark driver
+ */
+void printUsage() {
+    std::cout << "usage: cats-bench <strong|weak> <rank counts, e.g. 1,2,4,8> [options]" << std::endl
+              << "  --length N      road length, per rank for weak scaling (default from cats-input.txt)" << std::endl
+              << "  --max-time N    number of steps of each run (default from cats-input.txt)" << std::endl
+              << "  --repeats N     runs per rank count, the fastest is kept (default 1)" << std::endl
+              << "  --cats PATH     path to the cats executable (default ./cats)" << std::endl
+              << "  --mpirun CMD    MPI launcher command, empty for cats built without MPI (default \"mpirun --oversubscribe\")"
+              << std::endl
+              << "  --inputs DIR    directory with cats-input.txt and interarrival-cdf.dat (default .)" << std::endl
+              << "  --work-dir DIR  directory for the generated input decks (default bench-runs)" << std::endl
+              << "  --output FILE   CSV file of the results (default scaling.csv)" << std::endl;
+}
+
+/**
+ * Parses a positive whole number from a command line argument
+ * @param text the argument
+ * @param value the number to fill
+ * @return 0 if successful, nonzero if the argument is not a positive whole number that fits in an int
+ */
+int parsePositive(const std::string& text, int& value) {
+    char* end = nullptr;
+    errno = 0;
+    long number = std::strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || errno == ERANGE || number <= 0 || number > INT_MAX) {
+        return 1;
+    }
+    value = (int) number;
+    return 0;
+}
+
+/**
+ * Parses the command line into the options of the benchmark
+ * @param argc number of command line arguments
+ * @param argv command line arguments
+ * @param options the options to fill
+ * @return 0 if successful, nonzero otherwise
+ */
+int parseArguments(int argc, char** argv, BenchmarkOptions& options) {
+    if (argc < 3) {
+        return 1;
+    }
+
+    options.mode = argv[1];
+    if (options.mode != "strong" && options.mode != "weak") {
+        return 1;
+    }
+
+    std::stringstream counts_stream(argv[2]);
+    std::string count;
+    while (std::getline(counts_stream, count, ',')) {
+        int ranks;
+        if (parsePositive(count, ranks) != 0) {
+            return 1;
+        }
+        options.rank_counts.push_back(ranks);
+    }
+    if (options.rank_counts.empty()) {
+        return 1;
+    }
+
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        if (flag == "--length") {
+            if (parsePositive(value, options.length) != 0) {
+                return 1;
+            }
+        } else if (flag == "--max-time") {
+            if (parsePositive(value, options.max_time) != 0) {
+                return 1;
+            }
+        } else if (flag == "--repeats") {
+            if (parsePositive(value, options.repeats) != 0) {
+                return 1;
+            }
+        } else if (flag == "--cats") {
+            options.cats = std::filesystem::absolute(value).string();
+        } else if (flag == "--mpirun") {
+            options.mpirun = value;
+        } else if (flag == "--inputs") {
+            options.input_dir = value;
+        } else if (flag == "--work-dir") {
+            options.work_dir = value;
+        } else if (flag == "--output") {
+            options.output = value;
+        } else {
+            return 1;
+        }
+    }
+    if ((argc - 3) % 2 != 0) {
+        return 1;
+    }
+
+    options.cats = std::filesystem::absolute(options.cats).string();
+    return 0;
+}
+
+/**
+ * Reads the lines of the base input deck
+ * @param file_name path of the input file
+ * @param lines the lines of the file
+ * @return 0 if successful, nonzero otherwise
+ */
+int readDeck(std::string file_name, std::vector<std::string>& lines) {
+    std::ifstream file(file_name);
+    if (!file) {
+        std::cout << "error: failure to open " << file_name << " file!" << std::endl;
+        return 1;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    return 0;
+}
+
+/**
+ * Writes an input deck for one run into its own directory, with the road length and the number of steps replaced
+ * @param base_lines the lines of the base input deck
+ * @param options the options of the benchmark
+ * @param run_dir directory of the run
+ * @param length road length of the run
+ * @return 0 if successful, nonzero otherwise
+ */
+int writeDeck(std::vector<std::string> base_lines, BenchmarkOptions& options, std::string run_dir, int length) {
+    std::filesystem::create_directories(run_dir);
+
+    // The road length is the second line and the number of steps is the ninth line of the input file
+    base_lines[1] = std::to_string(length);
+    if (options.max_time > 0) {
+        base_lines[8] = std::to_string(options.max_time);
+    }
+
+    std::ofstream deck(run_dir + "/cats-input.txt");
+    for (std::string& line : base_lines) {
+        deck << line << "\n";
+    }
+
+    // The interarrival times are shared by all the runs
+    std::filesystem::copy_file(options.input_dir + "/interarrival-cdf.dat", run_dir + "/interarrival-cdf.dat",
+                               std::filesystem::copy_options::overwrite_existing);
+    return deck.good() ? 0 : 1;
+}
+
+/**
+ * Runs the simulation in a directory and parses the performance report of each rank from its output
+ * @param options the options of the benchmark
+ * @param run_dir directory of the run, with the input deck
+ * @param result the result to fill with the iteration rate of each rank and the wall time of the slowest rank
+ * @return 0 if successful, nonzero otherwise
+ */
+int runSimulation(BenchmarkOptions& options, std::string run_dir, RunResult& result) {
+    // Without a launcher, cats is built without MPI and runs its processes as threads
+    std::string np = " -np " + std::to_string(result.ranks);
+    std::string launch = options.mpirun.empty() ? "\"" + options.cats + "\"" + np
+                                                : options.mpirun + np + " \"" + options.cats + "\"";
+    std::string command = "cd \"" + run_dir + "\" && " + launch + " 2>&1";
+    FILE* pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+        std::cout << "error: failure to run \"" << command << "\"" << std::endl;
+        return 1;
+    }
+
+    // Parse lines like "Process : 3 average iterating frequency: 1234.5 [iter/s]"
+    result.rates.assign(result.ranks, 0.0);
+    result.wall_time = 0.0;
+    char buffer[1024];
+    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
+        std::string line = buffer;
+        int rank;
+        double value;
+        if (sscanf(line.c_str(), "Process : %d average iterating frequency: %lf", &rank, &value) == 2 &&
+            rank >= 0 && rank < result.ranks) {
+            result.rates[rank] = value;
+        } else if (sscanf(line.c_str(), "Process : %d total computation time: %lf", &rank, &value) == 2) {
+            result.wall_time = std::max(result.wall_time, value);
+        }
+    }
+
+    int status = pclose(pipe);
+    if (status != 0 || *std::min_element(result.rates.begin(), result.rates.end()) <= 0.0) {
+        std::cout << "error: run with " << result.ranks << " ranks failed, see \"" << command << "\"" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Driver for strong and weak scaling benchmarks of the simulation. Generates an input deck for each rank count, with
+ * a fixed road length for strong scaling or a road length proportional to the rank count for weak scaling, runs the
+ * simulation with each rank count on the local machine and writes the speedup and parallel efficiency relative to the
+ * smallest rank count to a CSV file, along with the iteration rate of every rank to a second CSV file.
+ * @param argc number of command line arguments
+ * @param argv command line arguments
+ * @return 0 if successful, nonzero otherwise
+ */
+int main(int argc, char** argv) {
+    BenchmarkOptions options;
+    if (parseArguments(argc, argv, options) != 0) {
+        printUsage();
+        return 1;
+    }
+    std::sort(options.rank_counts.begin(), options.rank_counts.end());
+
+    std::vector<std::string> base_lines;
+    if (readDeck(options.input_dir + "/cats-input.txt", base_lines) != 0 || base_lines.size() < 11) {
+        return 1;
+    }
+    int base_length = options.length > 0 ? options.length : std::stoi(base_lines[1]);
+
+    // Run the simulation for each rank count, keeping the fastest of the repeated runs
+    std::vector<RunResult> results;
+    for (int ranks : options.rank_counts) {
+        RunResult best;
+        best.wall_time = -1.0;
+        for (int repeat = 0; repeat < options.repeats; repeat++) {
+            RunResult result;
+            result.ranks = ranks;
+            result.length = options.mode == "weak" ? base_length * ranks : base_length;
+
+            std::string run_dir = options.work_dir + "/" + options.mode + "-np" + std::to_string(ranks);
+            if (writeDeck(base_lines, options, run_dir, result.length) != 0 ||
+                runSimulation(options, run_dir, result) != 0) {
+                return 1;
+            }
+            if (best.wall_time < 0.0 || result.wall_time < best.wall_time) {
+                best = result;
+            }
+        }
+
+        std::cout << options.mode << " scaling: " << ranks << " ranks, length " << best.length << ", "
+                  << best.wall_time << " [s], slowest rank "
+                  << *std::min_element(best.rates.begin(), best.rates.end()) << " [iter/s]" << std::endl;
+        results.push_back(best);
+    }
+
+    // Write the speedup and efficiency relative to the smallest rank count
+    std::ofstream output(options.output);
+    output << "mode,ranks,length,wall_time_s,min_rate_iter_s,mean_rate_iter_s,speedup,efficiency" << std::endl;
+    RunResult& base = results.front();
+    for (RunResult& result : results) {
+        double min_rate = *std::min_element(result.rates.begin(), result.rates.end());
+        double mean_rate = 0.0;
+        for (double rate : result.rates) {
+            mean_rate += rate / result.rates.size();
+        }
+
+        // Strong scaling compares the time of the same problem, weak scaling the time of a proportionally larger one
+        double relative_ranks = (double) result.ranks / (double) base.ranks;
+        double speedup, efficiency;
+        if (options.mode == "strong") {
+            speedup = base.wall_time / result.wall_time;
+            efficiency = speedup / relative_ranks;
+        } else {
+            efficiency = base.wall_time / result.wall_time;
+            speedup = efficiency * relative_ranks;
+        }
+
+        output << options.mode << "," << result.ranks << "," << result.length << "," << result.wall_time << ","
+               << min_rate << "," << mean_rate << "," << speedup << "," << efficiency << std::endl;
+    }
+
+    // Write the iteration rate of every rank of every run
+    std::string ranks_output = options.output.substr(0, options.output.rfind(".csv")) + "-ranks.csv";
+    std::ofstream ranks_file(ranks_output);
+    ranks_file << "mode,ranks,rank,rate_iter_s" << std::endl;
+    for (RunResult& result : results) {
+        for (int rank = 0; rank < result.ranks; rank++) {
+            ranks_file << options.mode << "," << result.ranks << "," << rank << "," << result.rates[rank] << std::endl;
+        }
+    }
+
+    std::cout << "results written to " << options.output << " and " << ranks_output << std::endl;
+    return 0;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ArrivalTrace.h"
+#include "Road.h"
+#include "Vehicle.h"
+#include "VehicleClass.h"
+#include "Random.h"
+#include "Process.h"
+
+// Number of bytes of the trace that are read before the pages that were read are released
+const long ARRIVAL_RELEASE_BYTES = 1 << 22;
+
+/**
+ * Constructor for the ArrivalTrace, which has no arrivals until it is loaded
+ */
+ArrivalTrace::ArrivalTrace() {
+    this->fd = -1;
+    this->mapping = nullptr;
+    this->mapping_size = 0;
+    this->records = nullptr;
+    this->num_records = 0;
+    this->next_record = 0;
+    this->released_bytes = 0;
+    this->start_time = 0.0;
+    this->step = 0;
+    this->count = 0;
+    this->dropped = 0;
+    this->counts_trace = false;
+}
+
+/**
+ * Destructor for the ArrivalTrace, which unmaps its file
+ */
+ArrivalTrace::~ArrivalTrace() {
+    if (this->mapping != nullptr) {
+        munmap(this->mapping, this->mapping_size);
+    }
+    if (this->fd != -1) {
+        close(this->fd);
+    }
+}
+
+/**
+ * Maps a file of recorded arrivals, written by cats-convert-arrivals, without reading its records. The file has an
+ * ArrivalHeader followed by its ArrivalRecords, sorted by time, in the byte order of the machine. The time of the first
+ * record is the start of the simulation. The file is optional.
+ * @param file_name name of the file
+ * @return 0 if successful, 1 if there is no file, 2 if the file is malformed
+ */
+int ArrivalTrace::loadFromFile(std::string file_name) {
+    // Open the file containing the arrivals, which is optional
+    this->fd = open(file_name.c_str(), O_RDONLY);
+    if (this->fd == -1) {
+        return 1;
+    }
+
+    struct stat file_stat;
+    if (fstat(this->fd, &file_stat) != 0 || file_stat.st_size < (off_t) sizeof(ArrivalHeader)) {
+        std::cout << "error: " << file_name << " file is too short for its header!" << std::endl;
+        return 2;
+    }
+    this->mapping_size = file_stat.st_size;
+    this->mapping = mmap(nullptr, this->mapping_size, PROT_READ, MAP_PRIVATE, this->fd, 0);
+    if (this->mapping == MAP_FAILED) {
+        this->mapping = nullptr;
+        std::cout << "error: failed to map " << file_name << " file!" << std::endl;
+        return 2;
+    }
+
+    // The records are read once, in order
+    madvise(this->mapping, this->mapping_size, MADV_SEQUENTIAL);
+
+    const ArrivalHeader* header = (const ArrivalHeader*) this->mapping;
+    if (memcmp(header->magic, ARRIVAL_TRACE_MAGIC, sizeof(ARRIVAL_TRACE_MAGIC)) != 0 ||
+        sizeof(ArrivalHeader) + header->num_records * sizeof(ArrivalRecord) != this->mapping_size) {
+        std::cout << "error: " << file_name << " file is not a trace of arrivals!" << std::endl;
+        return 2;
+    }
+    this->num_records = header->num_records;
+    this->records = (const ArrivalRecord*) ((const char*) this->mapping + sizeof(ArrivalHeader));
+    if (this->num_records > 0) {
+        this->start_time = this->records[0].time;
+    }
+    return 0;
+}
+
+/**
+ * Checks if there is no trace of arrivals
+ * @return whether no trace was loaded
+ */
+bool ArrivalTrace::isEmpty() {
+    return this->records == nullptr;
+}
+
+/**
+ * Attempts to spawn the recorded arrivals of a group of Lanes at the start of the road, once per step. The arrivals
+ * that are due by the end of the step join the queue of their Lane, and the first arrival of each queue enters when
+ * the start of its Lane is free, as with the interarrival times. Arrivals in a Lane or of a class outside the road are
+ * dropped.
+ * @param road_ptr pointer to the Road
+ * @param vehicles pointer to the list of Vehicles to add the spawned Vehicles to
+ * @param next_id_ptr pointer to the id of the next spawned Vehicle
+ * @param last_vehicles position of the last Vehicle in each Lane of the road
+ * @param first_lane first Lane of the group
+ * @param last_lane last Lane of the group
+ * @param step_size time of a step, in the units of the interarrival times
+ * @return number of spawned Vehicles
+ */
+int ArrivalTrace::attemptSpawn(Road* road_ptr, std::vector<Vehicle*>* vehicles, int* next_id_ptr,
+                               const std::vector<int>& last_vehicles, int first_lane, int last_lane,
+                               double step_size) {
+    int num_lanes = road_ptr->getNumLanes();
+    int num_classes = VehicleClass::table.size();
+    if (this->pending.empty()) {
+        this->pending.resize(num_lanes);
+    }
+
+    // The process with the first Lane counts the arrivals that are outside the road and the arrivals left in the trace
+    this->counts_trace = first_lane == 0;
+
+    // Queue the batch of arrivals that are due by the end of the step
+    double end_time = this->start_time + (this->step + 1) * step_size;
+    while (this->next_record < this->num_records && this->records[this->next_record].time < end_time) {
+        const ArrivalRecord& record = this->records[this->next_record++];
+        if (record.lane < 0 || record.lane >= num_lanes) {
+            this->dropped += this->counts_trace;
+        } else if (record.lane >= first_lane && record.lane <= last_lane) {
+            if (record.class_id >= num_classes) {
+                this->dropped++;
+            } else {
+                this->pending[record.lane].push_back({record.speed, record.class_id});
+            }
+        }
+    }
+    this->step++;
+
+    // Release the pages of the records that were read
+    long read_bytes = sizeof(ArrivalHeader) + this->next_record * sizeof(ArrivalRecord);
+    if (read_bytes - this->released_bytes >= ARRIVAL_RELEASE_BYTES) {
+        long page_size = sysconf(_SC_PAGESIZE);
+        long release_end = read_bytes / page_size * page_size;
+        madvise((char*) this->mapping + this->released_bytes, release_end - this->released_bytes, MADV_DONTNEED);
+        this->released_bytes = release_end;
+    }
+
+    // Spawn the first arrival of each Lane if the start of the Lane is free
+    int num_spawned = 0;
+    for (int i = first_lane; i <= last_lane; i++) {
+        Lane* lane_ptr = road_ptr->getLane(i);
+        if (this->pending[i].empty() || lane_ptr->hasVehicleInSite(0) || last_vehicles[i] == 0) {
+            continue;
+        }
+        PendingArrival arrival = this->pending[i].front();
+        this->pending[i].pop_front();
+
+#ifdef DEBUG
+        std::cout << "creating recorded vehicle " << (*next_id_ptr) << " in lane " << i << " at site " << 0
+                  << std::endl;
+#endif
+        int class_id = arrival.class_id < 0 ? VehicleClass::sampleClass() : arrival.class_id;
+        Vehicle* vehicle_ptr = new Vehicle(lane_ptr, *next_id_ptr, 0, class_id);
+        lane_ptr->addVehicle(0, vehicle_ptr);
+        (*next_id_ptr)++;
+        vehicles->push_back(vehicle_ptr);
+
+        // A recorded speed is kept up to the maximum speed of the class, otherwise the Vehicle enters as it would
+        // with the interarrival times
+        if (arrival.speed >= 0) {
+            vehicle_ptr->setSpeed(std::min((int) arrival.speed, VehicleClass::table[class_id].max_speed));
+        } else if (randomUniform() < VehicleClass::table[class_id].prob_slow_down) {
+            vehicle_ptr->setSpeed(0);
+        }
+        this->count++;
+        num_spawned++;
+    }
+    return num_spawned;
+}
+
+/**
+ * Prints the number of recorded arrivals that entered the road, that were still waiting to enter, that were dropped
+ * and that were not reached by the end of the simulation, summed over the processes
+ * @param curr_process pointer to the current process
+ */
+void ArrivalTrace::report(Process* curr_process) {
+    if (this->records == nullptr) {
+        return;
+    }
+    long waiting = 0;
+    for (std::deque<PendingArrival>& lane_pending : this->pending) {
+        waiting += lane_pending.size();
+    }
+    long unreached = this->counts_trace ? this->num_records - this->next_record : 0;
+    std::vector<double> sums = curr_process->reduceSum({(double) this->count, (double) waiting,
+                                                        (double) this->dropped, (double) unreached});
+    if (curr_process->getRank() != 0) {
+        return;
+    }
+    std::ostringstream report;
+    report << "--- Arrival Trace ---" << std::endl;
+    report << "recorded arrivals: " << this->num_records << ", entered: " << (long) sums[0] << ", waiting: "
+           << (long) sums[1] << ", dropped: " << (long) sums[2] << ", not reached: " << (long) sums[3] << std::endl;
+    std::cout << report.str();
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_ARRIVALTRACE_H
+#define CA_TRAFFIC_SIMULATION_ARRIVALTRACE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <deque>
+
+// Forward Declarations
+class Road;
+class Vehicle;
+class Process;
+
+// Magic number at the start of a file of recorded arrivals, which also gives the version of the format
+const char ARRIVAL_TRACE_MAGIC[8] = {'C', 'A', 'T', 'S', 'A', 'R', 'R', '1'};
+
+/**
+ * Structure for the header of a file of recorded arrivals, followed by its records
+ */
+struct ArrivalHeader {
+    char magic[8];
+    uint64_t num_records;
+};
+
+/**
+ * Structure for a recorded arrival at the start of the road, in the units of time of the interarrival times. A
+ * negative speed enters at the maximum speed of the class, and a negative class is drawn from the mix of the classes.
+ */
+struct ArrivalRecord {
+    double time;
+    int32_t lane;
+    int32_t speed;
+    int32_t class_id;
+    int32_t reserved;
+};
+
+/**
+ * Structure for a recorded arrival that is due and waits for the start of its Lane to be free
+ */
+struct PendingArrival {
+    int32_t speed;
+    int32_t class_id;
+};
+
+/**
+ * Class for a trace of recorded arrivals that replaces the interarrival times at the start of the road. The file of
+ * the trace is memory-mapped and read in order, a batch of the arrivals that are due in each step, so that traces of
+ * millions of arrivals are never read into memory. The pages that were read are released as the trace advances. Each
+ * process at the start of the road replays the arrivals of its own Lanes.
+ */
+class ArrivalTrace {
+private:
+    int fd;
+    void* mapping;
+    size_t mapping_size;
+    const ArrivalRecord* records;
+    long num_records;
+    long next_record;
+    long released_bytes;
+    double start_time;
+    int step;
+    std::vector<std::deque<PendingArrival>> pending;
+    long count;
+    long dropped;
+    bool counts_trace;
+public:
+    ArrivalTrace();
+    ~ArrivalTrace();
+    int loadFromFile(std::string file_name);
+    bool isEmpty();
+    int attemptSpawn(Road* road_ptr, std::vector<Vehicle*>* vehicles, int* next_id_ptr,
+                     const std::vector<int>& last_vehicles, int first_lane, int last_lane, double step_size);
+    void report(Process* curr_process);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_ARRIVALTRACE_H
@@ -3,6 +3,7 @@
  */
 
 #include "CDF.h"
+#include "Random.h"
 
 #include <fstream>
 #include <string>
@@ -29,7 +30,7 @@ int CDF::read_cdf(std::string file_name) {
     while (std::getline(file, line))
     {
         this->x.push_back(std::stod(line.substr(0, line.find(','))));
-        this->cdf.push_back(std::stod(line.substr(1, line.find(','))));
+        this->cdf.push_back(std::stod(line.substr(line.find(',') + 1)));
     }
 
     // Close the file
@@ -44,7 +45,15 @@ int CDF::read_cdf(std::string file_name) {
  * @return sampled point from the distribution
  */
 double CDF::query() {
-    double u = ((double) std::rand()) / ((double) RAND_MAX);
+    return this->query(randomUniform());
+}
+
+/**
+ * Sampled a point from the cumulative distribution function with a given uniform random number
+ * @param u uniformly distributed number in [0, 1]
+ * @return sampled point from the distribution
+ */
+double CDF::query(double u) {
     for (int i = 0; i < (int) this->cdf.size(); i++) {
         if (this->cdf[i] >= u) {
             return this->x[i];
@@ -18,6 +18,7 @@ private:
 public:
     int read_cdf(std::string file_name);
     double query();
+    double query(double u);
 };
 
 
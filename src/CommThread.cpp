@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <chrono>
+#include <algorithm>
+
+#include "CommThread.h"
+#include "MpiProfiler.h"
+
+/**
+ * Constructor for the CommThread, which starts the thread. Must be called by all the ranks, since it duplicates the
+ * communicator.
+ * @param capacity minimum number of messages that each ring holds
+ */
+CommThread::CommThread(int capacity) : outbound(capacity), inbound(capacity), stopping(false),
+                                       inbound_depth_sum(0), inbound_depth_max(0) {
+    this->messages_sent = 0;
+    this->messages_received = 0;
+    this->outbound_depth_sum = 0;
+    this->outbound_depth_max = 0;
+    this->waits = 0;
+    this->wait_time = 0.0;
+
+    MPI_Comm_dup(MPI_COMM_WORLD, &this->comm);
+    this->thread = std::thread(&CommThread::progress, this);
+}
+
+/**
+ * Destructor for the CommThread, which waits for the outbound messages to be sent and stops the thread
+ */
+CommThread::~CommThread() {
+    this->stopping.store(true, std::memory_order_release);
+    this->thread.join();
+    MPI_Comm_free(&this->comm);
+}
+
+/**
+ * Main loop of the communication thread. Posts the sends of the outbound messages, completes them, and receives the
+ * messages of the neighbouring ranks as they arrive, until it is stopped and all the outbound messages are sent.
+ */
+void CommThread::progress() {
+    MpiProfileSite site("CommThread");
+    std::vector<CommMessage> sending;
+    std::vector<MPI_Request> requests;
+    std::deque<CommMessage> received;
+    CommMessage message;
+
+    while (!this->stopping.load(std::memory_order_acquire) || this->outbound.size() > 0 || !requests.empty()) {
+        bool busy = false;
+
+        // Post the sends of the new outbound messages, whose buffers stay in place when the messages are moved
+        while (this->outbound.tryPop(message)) {
+            sending.push_back(std::move(message));
+            requests.emplace_back();
+            MPI_Isend(sending.back().values.data(), sending.back().values.size(), MPI_INT, sending.back().rank,
+                      sending.back().tag, this->comm, &requests.back());
+            busy = true;
+        }
+
+        // Release the messages whose sends are complete
+        for (int i = (int) requests.size() - 1; i >= 0; i--) {
+            int done;
+            MPI_Test(&requests[i], &done, MPI_STATUS_IGNORE);
+            if (done) {
+                std::swap(requests[i], requests.back());
+                std::swap(sending[i], sending.back());
+                requests.pop_back();
+                sending.pop_back();
+                busy = true;
+            }
+        }
+
+        // Receive the next message of a neighbouring rank
+        int arrived;
+        MPI_Status status;
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, this->comm, &arrived, &status);
+        if (arrived) {
+            int count;
+            MPI_Get_count(&status, MPI_INT, &count);
+            received.push_back({status.MPI_SOURCE, status.MPI_TAG, std::vector<int>(count)});
+            MPI_Recv(received.back().values.data(), count, MPI_INT, status.MPI_SOURCE, status.MPI_TAG, this->comm,
+                     MPI_STATUS_IGNORE);
+            busy = true;
+        }
+
+        // Hand the received messages to the compute thread, in the order they arrived
+        while (!received.empty() && this->inbound.tryPush(received.front())) {
+            received.pop_front();
+            long depth = this->inbound.size();
+            this->inbound_depth_sum.fetch_add(depth, std::memory_order_relaxed);
+            if (depth > this->inbound_depth_max.load(std::memory_order_relaxed)) {
+                this->inbound_depth_max.store(depth, std::memory_order_relaxed);
+            }
+        }
+
+        if (!busy) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/**
+ * Hands a message for a neighbouring rank to the communication thread, waiting only if the outbound ring is full
+ * @param destination rank of the neighbouring process
+ * @param tag tag of the message
+ * @param values the contents of the message
+ */
+void CommThread::send(int destination, int tag, std::vector<int> values) {
+    CommMessage message = {destination, tag, std::move(values)};
+    if (!this->outbound.tryPush(message)) {
+        auto start = std::chrono::steady_clock::now();
+        while (!this->outbound.tryPush(message)) {
+            std::this_thread::yield();
+        }
+        this->wait_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        this->waits++;
+    }
+
+    long depth = this->outbound.size();
+    this->outbound_depth_sum += depth;
+    this->outbound_depth_max = std::max(this->outbound_depth_max, depth);
+    this->messages_sent++;
+}
+
+/**
+ * Takes the oldest message from a neighbouring rank with a tag from the communication thread, waiting until it
+ * arrives. Messages with other sources or tags that come first are kept until they are asked for.
+ * @param source rank of the neighbouring process
+ * @param tag tag of the message
+ * @return the contents of the message
+ */
+std::vector<int> CommThread::receive(int source, int tag) {
+    std::deque<CommMessage>& queue = this->mailbox[{source, tag}];
+    CommMessage message;
+
+    // Sort the messages handed over so far into the mailbox
+    auto collect = [this, &message]() {
+        while (this->inbound.tryPop(message)) {
+            this->mailbox[{message.rank, message.tag}].push_back(std::move(message));
+        }
+    };
+
+    collect();
+    if (queue.empty()) {
+        auto start = std::chrono::steady_clock::now();
+        while (queue.empty()) {
+            std::this_thread::yield();
+            collect();
+        }
+        this->wait_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        this->waits++;
+    }
+
+    std::vector<int> values = std::move(queue.front().values);
+    queue.pop_front();
+    this->messages_received++;
+    return values;
+}
+
+/**
+ * Writes the metrics of the hand-off queues to a report
+ * @param report the report
+ * @param rank rank of the process
+ */
+void CommThread::report(std::ostream& report, int rank) {
+    double outbound_mean = this->messages_sent > 0 ? (double) this->outbound_depth_sum / this->messages_sent : 0.0;
+    double inbound_mean = this->messages_received > 0 ?
+                          (double) this->inbound_depth_sum.load(std::memory_order_relaxed) / this->messages_received : 0.0;
+
+    report << "Process : " << rank << " comm thread messages: sent " << this->messages_sent << ", received "
+           << this->messages_received << std::endl;
+    report << "Process : " << rank << " comm thread queue depth: outbound mean " << outbound_mean << " max "
+           << this->outbound_depth_max << ", inbound mean " << inbound_mean << " max "
+           << this->inbound_depth_max.load(std::memory_order_relaxed) << std::endl;
+    report << "Process : " << rank << " comm thread wait time: " << this->wait_time << " [s] in " << this->waits
+           << " waits" << std::endl;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_COMMTHREAD_H
+#define CA_TRAFFIC_SIMULATION_COMMTHREAD_H
+
+#include <mpi.h>
+#include <vector>
+#include <deque>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <ostream>
+
+#include "SpscRing.h"
+
+/**
+ * Structure for a message between neighbouring ranks, with the rank it goes to or comes from
+ */
+struct CommMessage {
+    int rank;
+    int tag;
+    std::vector<int> values;
+};
+
+/**
+ * Class for a thread of an MPI rank that owns all the traffic with the neighbouring ranks. The compute thread hands it
+ * the outbound messages and takes the inbound ones back through two single-producer/single-consumer rings, so that it
+ * never calls MPI for the neighbour traffic, and the messages progress while it computes. The thread uses its own
+ * communicator, so that it only ever matches the neighbour traffic.
+ */
+class CommThread {
+private:
+    MPI_Comm comm;
+    SpscRing<CommMessage> outbound;
+    SpscRing<CommMessage> inbound;
+    std::atomic<bool> stopping;
+    std::thread thread;
+
+    // Messages taken out of the inbound ring by the compute thread before they were asked for
+    std::map<std::pair<int, int>, std::deque<CommMessage>> mailbox;
+
+    // Metrics of the compute thread
+    long messages_sent;
+    long messages_received;
+    long outbound_depth_sum;
+    long outbound_depth_max;
+    long waits;
+    double wait_time;
+
+    // Metrics of the communication thread
+    std::atomic<long> inbound_depth_sum;
+    std::atomic<long> inbound_depth_max;
+
+    void progress();
+public:
+    CommThread(int capacity);
+    ~CommThread();
+    void send(int destination, int tag, std::vector<int> values);
+    std::vector<int> receive(int source, int tag);
+    void report(std::ostream& report, int rank);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_COMMTHREAD_H
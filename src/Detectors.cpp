@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+#include "Detectors.h"
+#include "Process.h"
+
+// Number of aggregation intervals buffered before they are combined over the processes and written
+const int FLUSH_INTERVALS = 10;
+
+// Default number of steps of an aggregation interval
+const int DEFAULT_INTERVAL = 60;
+
+/**
+ * Constructor for the Detectors, without any detector
+ */
+Detectors::Detectors() {
+    this->interval = DEFAULT_INTERVAL;
+    this->num_lanes = 0;
+}
+
+/**
+ * Reads the detectors from a comma delimited text file. Each line is either a detector, given as
+ * "detector,<segment>,<position>", or the number of steps of the aggregation intervals, given as "interval,<steps>".
+ * The segment is the index of the segment in the network file, or 0 for a single road.
+ * @param file_name path and name of the file to read
+ * @param inputs instance of the Inputs class with the number of lanes
+ * @return 0 if successful, 1 if the file does not exist, 2 if the file is malformed
+ */
+int Detectors::loadFromFile(std::string file_name, Inputs inputs) {
+    // Open the file containing the detectors, which is optional
+    std::ifstream file(file_name);
+    if (!file) {
+        return 1;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::vector<std::string> fields;
+        std::stringstream line_stream(line);
+        std::string field;
+        while (std::getline(line_stream, field, ',')) {
+            fields.push_back(field);
+        }
+
+        if (fields[0] == "detector" && fields.size() == 3) {
+            this->locations.push_back({std::stoi(fields[1]), std::stoi(fields[2])});
+        } else if (fields[0] == "interval" && fields.size() == 2 && std::stoi(fields[1]) > 0) {
+            this->interval = std::stoi(fields[1]);
+        } else {
+            std::cout << "error: malformed line \"" << line << "\" in " << file_name << " file!" << std::endl;
+            return 2;
+        }
+    }
+
+    // Index the detectors of each segment by their cell
+    for (int d = 0; d < (int) this->locations.size(); d++) {
+        int segment = this->locations[d].first;
+        int position = this->locations[d].second;
+        auto it = this->cells.find(segment);
+        if (it == this->cells.end()) {
+            this->cells[segment] = {position, position, {}};
+        }
+        DetectorCells& detector_cells = this->cells[segment];
+        detector_cells.first_cell = std::min(detector_cells.first_cell, position);
+        detector_cells.last_cell = std::max(detector_cells.last_cell, position);
+        detector_cells.detectors[position] = d;
+    }
+
+    this->num_lanes = inputs.num_lanes;
+    this->counts.assign(3 * this->locations.size() * this->num_lanes, 0.0);
+    return 0;
+}
+
+/**
+ * Checks whether there are any detectors
+ * @return true if there are detectors, false otherwise
+ */
+bool Detectors::isEnabled() {
+    return !this->locations.empty();
+}
+
+/**
+ * Getter method for the detectors of a segment
+ * @param segment index of the segment
+ * @return pointer to the detectors of the segment, or nullptr if it has none
+ */
+DetectorCells* Detectors::getCells(int segment) {
+    auto it = this->cells.find(segment);
+    return it == this->cells.end() ? nullptr : &it->second;
+}
+
+/**
+ * Ends a step of the simulation. At the end of an interval, the counts of the interval are added to the batch, and
+ * the batch is flushed when it is full or when no complete interval is left in the simulation.
+ * @param time number of steps completed
+ * @param max_time number of steps of the simulation
+ * @param curr_process pointer to the current process
+ */
+void Detectors::endStep(int time, int max_time, Process* curr_process) {
+    if (!this->isEnabled() || time % this->interval != 0) {
+        return;
+    }
+
+    this->batch.insert(this->batch.end(), this->counts.begin(), this->counts.end());
+    this->batch_times.push_back(time);
+    std::fill(this->counts.begin(), this->counts.end(), 0.0);
+
+    if ((int) this->batch_times.size() == FLUSH_INTERVALS || time + this->interval > max_time) {
+        this->flush(curr_process);
+    }
+}
+
+/**
+ * Combines the buffered intervals over all the processes and writes them on the first process, one line per
+ * interval, detector and Lane with the number of passages, the flow in Vehicles per step, the time-mean speed in cells
+ * per step (nan without passages) and the occupancy as the fraction of the interval the detector was occupied
+ * @param curr_process pointer to the current process
+ */
+void Detectors::flush(Process* curr_process) {
+    std::vector<double> sums = curr_process->reduceSum(this->batch);
+
+    if (curr_process->getRank() == 0) {
+        if (!this->output.is_open()) {
+            this->output.open("detectors.csv");
+            this->output << "time,detector,segment,position,lane,count,flow,speed,occupancy" << "\n";
+        }
+
+        int k = 0;
+        for (int time : this->batch_times) {
+            for (int d = 0; d < (int) this->locations.size(); d++) {
+                for (int i = 0; i < this->num_lanes; i++, k += 3) {
+                    double count = sums[k];
+                    this->output << time << "," << d << "," << this->locations[d].first << ","
+                                 << this->locations[d].second << "," << i << "," << (int) count << ","
+                                 << count / this->interval << "," << (count > 0 ? sums[k + 1] / count : NAN) << ","
+                                 << sums[k + 2] / this->interval << "\n";
+                }
+            }
+        }
+        this->output.flush();
+    }
+
+    this->batch.clear();
+    this->batch_times.clear();
+}
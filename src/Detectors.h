@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_DETECTORS_H
+#define CA_TRAFFIC_SIMULATION_DETECTORS_H
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <fstream>
+
+#include "Inputs.h"
+
+// Forward Declarations
+class Process;
+
+/**
+ * Structure for the detectors of one road segment, with the range of cells that they span and the detector at each
+ * cell, so that a Vehicle move is checked against them with a range check and a few hash probes
+ */
+struct DetectorCells {
+    int first_cell;
+    int last_cell;
+    std::unordered_map<int, int> detectors;
+};
+
+/**
+ * Class for virtual loop detectors at fixed cells of the road segments. Like inductive loops, each detector counts the
+ * Vehicles passing over it in each Lane, with their spot speeds and the time they occupy it, and aggregates them over
+ * fixed intervals into the flow, the time-mean speed and the occupancy. Each process records the moves of its own
+ * Vehicles, and the intervals are buffered and only combined over the processes and written in batches.
+ */
+class Detectors {
+private:
+    int interval;
+    int num_lanes;
+    std::vector<std::pair<int, int>> locations;
+    std::map<int, DetectorCells> cells;
+    std::vector<double> counts;
+    std::vector<double> batch;
+    std::vector<int> batch_times;
+    std::ofstream output;
+    void flush(Process* curr_process);
+public:
+    Detectors();
+    int loadFromFile(std::string file_name, Inputs inputs);
+    bool isEnabled();
+    DetectorCells* getCells(int segment);
+    void endStep(int time, int max_time, Process* curr_process);
+
+    /**
+     * Records the move of a Vehicle over the detectors of its segment. A Vehicle passes a detector when the detector
+     * is in (from, to], and occupies it for the time its length of one cell takes to pass at its speed. A stopped
+     * Vehicle occupies the detector under it for the whole step.
+     * @param detector_cells the detectors of the segment of the Vehicle
+     * @param lane_num number of the Lane of the Vehicle
+     * @param from position of the Vehicle before the move
+     * @param to position of the Vehicle after the move, which may be beyond the end of the segment
+     */
+    inline void recordMove(const DetectorCells& detector_cells, int lane_num, int from, int to) {
+        if (to < detector_cells.first_cell || from > detector_cells.last_cell) {
+            return;
+        }
+
+        int speed = to - from;
+        if (speed == 0) {
+            auto it = detector_cells.detectors.find(from);
+            if (it != detector_cells.detectors.end()) {
+                this->counts[3 * (it->second * this->num_lanes + lane_num) + 2] += 1.0;
+            }
+            return;
+        }
+
+        for (int cell = from + 1; cell <= to; cell++) {
+            auto it = detector_cells.detectors.find(cell);
+            if (it != detector_cells.detectors.end()) {
+                double* count = &this->counts[3 * (it->second * this->num_lanes + lane_num)];
+                count[0] += 1.0;
+                count[1] += speed;
+                count[2] += 1.0 / speed;
+            }
+        }
+    }
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_DETECTORS_H
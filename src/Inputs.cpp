@@ -6,8 +6,11 @@
 #include <iostream>
 #include <vector>
 #include <sstream>
+#include <algorithm>
+#include <ctime>
 
 #include "Inputs.h"
+#include "RulePolicies.h"
 
 /**
  * Helper function to parse a line in the input file and return the parameter value of the line
@@ -18,6 +21,20 @@ std::string parseLine(std::string line) {
     return line.substr(0, line.find(' '));
 }
 
+/**
+ * Helper function to parse an optional line in the input file, which may be missing at the end of the file
+ * @param input_lines the lines of the input file
+ * @param n index of the line
+ * @param default_value value of the parameter if the line is missing
+ * @return the parameter on the line, or the default value
+ */
+double parseOptionalLine(const std::vector<std::string>& input_lines, int n, double default_value) {
+    if (n >= (int) input_lines.size() || parseLine(input_lines[n]).empty()) {
+        return default_value;
+    }
+    return std::stod(parseLine(input_lines[n]));
+}
+
 /**
  * Loads the inputs options from a text file into the class variables
  * @return 0 if successful, nonzero otherwise
@@ -55,6 +72,29 @@ int Inputs::loadFromFile() {
     this->step_size           = std::stod(parseLine(input_lines[n++]));
     this->warmup_time         = std::stoi(parseLine(input_lines[n++]));
 
+    // Parse the optional lines of the input file, which keep their default values if they are missing
+    this->percent_full        = parseOptionalLine(input_lines, n++, this->percent_full);
+    double rules              = parseOptionalLine(input_lines, n++, this->rules);
+    this->rules               = (int) rules;
+    this->prob_slow_to_start  = parseOptionalLine(input_lines, n++, this->prob_slow_to_start);
+    this->bin_length          = (int) parseOptionalLine(input_lines, n++, this->bin_length);
+    this->window_length       = (int) parseOptionalLine(input_lines, n++, this->window_length);
+    this->memory_interval     = (int) parseOptionalLine(input_lines, n++, this->memory_interval);
+    this->exchange_interval   = std::max(1, (int) parseOptionalLine(input_lines, n++, this->exchange_interval));
+    this->optimistic_window   = std::max(0, (int) parseOptionalLine(input_lines, n++, this->optimistic_window));
+
+    // A typo in the rules would otherwise run a different model
+    if (rules != this->rules || (this->rules != RULES_RICKERT && this->rules != RULES_SLOW_TO_START &&
+                                 this->rules != RULES_CRUISE_CONTROL && this->rules != RULES_ASYMMETRIC)) {
+        std::cout << "error: unknown rules " << rules << " in \"cats-input.txt\" file!" << std::endl;
+        return 2;
+    }
+
+    // Seed the random draws of the Vehicles, which are the same on every process
+#ifndef DEBUG
+    this->seed = (unsigned int) time(NULL);
+#endif
+
     // Close the input file
     input_file.close();
 
@@ -65,6 +105,7 @@ int Inputs::loadFromFile() {
 Inputs::Inputs(Config config){
     this->num_lanes           = config.num_lanes;
     this->length              = config.length;
+    this->percent_full        = config.percent_full;
     this->max_speed           = config.max_speed;
     this->look_forward        = config.look_forward;
     this->look_other_forward  = config.look_other_forward;
@@ -74,4 +115,12 @@ Inputs::Inputs(Config config){
     this->max_time            = config.max_time;
     this->step_size           = config.step_size;
     this->warmup_time         = config.warmup_time;
+    this->rules               = config.rules;
+    this->prob_slow_to_start  = config.prob_slow_to_start;
+    this->bin_length          = config.bin_length;
+    this->window_length       = config.window_length;
+    this->memory_interval     = config.memory_interval;
+    this->exchange_interval   = config.exchange_interval;
+    this->optimistic_window   = config.optimistic_window;
+    this->seed                = config.seed;
 }
\ No newline at end of file
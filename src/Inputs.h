@@ -17,7 +17,7 @@ class Inputs {
 public:
     int num_lanes;
     int length;
-    double percent_full;
+    double percent_full = -1.0;
     int max_speed;
     int look_forward;
     int look_other_forward;
@@ -27,6 +27,14 @@ public:
     int max_time;
     double step_size;
     int warmup_time;
+    int rules = 0;
+    double prob_slow_to_start = 0.0;
+    int bin_length = 0;
+    int window_length = 0;
+    int memory_interval = 0;
+    int exchange_interval = 1;
+    int optimistic_window = 0;
+    unsigned int seed = 1;
     int loadFromFile();
 
     // Constructor with Config
@@ -47,6 +55,14 @@ struct Config {
     int max_time;
     double step_size;
     int warmup_time;
+    int rules;
+    double prob_slow_to_start;
+    int bin_length;
+    int window_length;
+    int memory_interval;
+    int exchange_interval;
+    int optimistic_window;
+    unsigned int seed;
 };
 
 
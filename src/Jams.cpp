@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "Jams.h"
+#include "Vehicle.h"
+#include "Lane.h"
+#include "Process.h"
+
+// Number of samples buffered before the runs of slow Vehicles are gathered and written
+const int FLUSH_SAMPLES = 100;
+
+// Number of values of a run of slow Vehicles: time, lane, back, front, size, sum of speeds, joins the previous process
+const int RUN_VALUES = 7;
+
+/**
+ * Constructor for the Jams, which are not tracked until they are loaded
+ */
+Jams::Jams() {
+    this->max_speed = 1;
+    this->max_gap = 1;
+    this->min_size = 3;
+    this->interval = 1;
+    this->num_lanes = 0;
+    this->next_cluster_id = 0;
+    this->num_clusters = 0;
+    this->max_cluster_size = 0;
+    this->longest_duration = 0;
+}
+
+/**
+ * Reads the definition of a jam from a comma delimited text file. Each line is one of "speed,<cells per step>", the
+ * highest speed of a Vehicle in a jam (default 1), "gap,<cells>", the largest gap between the Vehicles of a jam
+ * (default 1), "size,<vehicles>", the fewest Vehicles of a jam (default 3), or "interval,<steps>", the number of steps
+ * between the samples (default 1).
+ * @param file_name path and name of the file to read
+ * @param inputs instance of the Inputs class with the number of lanes
+ * @return 0 if successful, 1 if the file does not exist, 2 if the file is malformed
+ */
+int Jams::loadFromFile(std::string file_name, Inputs inputs) {
+    // Open the file with the definition of a jam, which is optional
+    std::ifstream file(file_name);
+    if (!file) {
+        return 1;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::vector<std::string> fields;
+        std::stringstream line_stream(line);
+        std::string field;
+        while (std::getline(line_stream, field, ',')) {
+            fields.push_back(field);
+        }
+
+        // A threshold that is not a number makes the line malformed
+        int value = -1;
+        try {
+            value = fields.size() == 2 ? std::stoi(fields[1]) : -1;
+        } catch (const std::logic_error&) {
+            value = -1;
+        }
+        if (fields[0] == "speed" && value >= 0) {
+            this->max_speed = value;
+        } else if (fields[0] == "gap" && value >= 0) {
+            this->max_gap = value;
+        } else if (fields[0] == "size" && value > 0) {
+            this->min_size = value;
+        } else if (fields[0] == "interval" && value > 0) {
+            this->interval = value;
+        } else {
+            std::cout << "error: malformed line \"" << line << "\" in " << file_name << " file!" << std::endl;
+            return 2;
+        }
+    }
+
+    this->num_lanes = inputs.num_lanes;
+    return 0;
+}
+
+/**
+ * Checks whether the jams are tracked
+ * @return true if the jams were loaded, false otherwise
+ */
+bool Jams::isEnabled() {
+    return this->num_lanes > 0;
+}
+
+/**
+ * Ends a step of the simulation. At a sample, finds the runs of slow Vehicles in each Lane of the part of the road of
+ * the process, after telling the next process which of its Lanes end in a slow Vehicle, and adds them to the batch.
+ * The batch is flushed when it is full or when no sample is left in the simulation. Every process takes part in every
+ * sample.
+ * @param time number of steps completed
+ * @param max_time number of steps of the simulation
+ * @param vehicles the Vehicles of the process, of which only the ones in its part of the road and Lanes are sampled
+ * @param start_position first site of the part of the road of the process
+ * @param end_position last site of the part of the road of the process
+ * @param first_lane first Lane of the process
+ * @param last_lane last Lane of the process
+ * @param curr_process pointer to the current process
+ */
+void Jams::endStep(int time, int max_time, const std::vector<Vehicle*>& vehicles, int start_position,
+                   int end_position, int first_lane, int last_lane, Process* curr_process) {
+    if (!this->isEnabled() || time % this->interval != 0) {
+        return;
+    }
+
+    // Sort the Vehicles of each Lane by position
+    std::vector<std::vector<Vehicle*>> lane_vehicles(this->num_lanes);
+    for (Vehicle* vehicle : vehicles) {
+        int lane = vehicle->getLanePtr()->getLaneNumber();
+        if (vehicle->getPosition() >= start_position && vehicle->getPosition() <= end_position && lane >= first_lane &&
+            lane <= last_lane) {
+            lane_vehicles[lane].push_back(vehicle);
+        }
+    }
+    std::vector<int> tails(this->num_lanes, -1);
+    for (int i = first_lane; i <= last_lane; i++) {
+        std::sort(lane_vehicles[i].begin(), lane_vehicles[i].end(), [](Vehicle* a, Vehicle* b) {
+            return a->getPosition() < b->getPosition();
+        });
+        if (!lane_vehicles[i].empty() && lane_vehicles[i].back()->getSpeed() <= this->max_speed) {
+            tails[i] = lane_vehicles[i].back()->getPosition();
+        }
+    }
+
+    // The last slow Vehicle of each Lane of the previous process, or -1, continues a run at the start of this process
+    std::vector<int> prev_tails = curr_process->exchangeTails(tails);
+
+    // Add the runs of slow Vehicles that are no further apart than the largest gap, a fast Vehicle ends a run
+    for (int i = first_lane; i <= last_lane; i++) {
+        int prev_tail = prev_tails.empty() ? -1 : prev_tails[i];
+        int last_position = -1;
+        bool in_run = false;
+        bool first_vehicle = true;
+        for (Vehicle* vehicle : lane_vehicles[i]) {
+            int position = vehicle->getPosition();
+            if (vehicle->getSpeed() > this->max_speed) {
+                in_run = false;
+            } else if (in_run && position - last_position - 1 <= this->max_gap) {
+                double* run = &this->batch[this->batch.size() - RUN_VALUES];
+                run[3] = position;
+                run[4] += 1.0;
+                run[5] += vehicle->getSpeed();
+            } else {
+                bool joins_prev = first_vehicle && prev_tail != -1 && position - prev_tail - 1 <= this->max_gap;
+                this->batch.insert(this->batch.end(), {(double) time, (double) i, (double) position,
+                                                       (double) position, 1.0, (double) vehicle->getSpeed(),
+                                                       (double) joins_prev});
+                in_run = true;
+            }
+            first_vehicle = false;
+            last_position = position;
+        }
+    }
+    this->batch_times.push_back(time);
+
+    if ((int) this->batch_times.size() == FLUSH_SAMPLES || time + this->interval > max_time) {
+        this->flush(curr_process);
+    }
+}
+
+/**
+ * Gathers the buffered runs of slow Vehicles of all the processes on the first process, which stitches the runs that
+ * continue a run of the previous process into clusters, keeps the clusters of at least the fewest Vehicles of a jam,
+ * and follows them sample by sample
+ * @param curr_process pointer to the current process
+ */
+void Jams::flush(Process* curr_process) {
+    std::vector<double> runs = curr_process->gather(this->batch);
+    std::vector<int> times;
+    times.swap(this->batch_times);
+    this->batch.clear();
+    if (curr_process->getRank() != 0) {
+        return;
+    }
+
+    // Order the runs by sample and Lane, keeping the order of the processes, so that a run that continues a run of
+    // the previous process follows it
+    int num_runs = runs.size() / RUN_VALUES;
+    std::vector<int> order(num_runs);
+    for (int r = 0; r < num_runs; r++) {
+        order[r] = r;
+    }
+    std::stable_sort(order.begin(), order.end(), [&runs](int a, int b) {
+        const double* run_a = &runs[a * RUN_VALUES];
+        const double* run_b = &runs[b * RUN_VALUES];
+        return run_a[0] < run_b[0] || (run_a[0] == run_b[0] && run_a[1] < run_b[1]);
+    });
+
+    int r = 0;
+    std::vector<JamCluster> found;
+    for (int time : times) {
+        found.clear();
+        for (; r < num_runs && (int) runs[order[r] * RUN_VALUES] == time; r++) {
+            const double* run = &runs[order[r] * RUN_VALUES];
+            if (run[6] != 0.0 && !found.empty() && found.back().lane == (int) run[1]) {
+                found.back().front = run[3];
+                found.back().size += run[4];
+                found.back().speed += run[5];
+            } else {
+                found.push_back({-1, (int) run[1], (int) run[2], (int) run[3], (int) run[4], run[5], time});
+            }
+        }
+
+        // Keep the clusters that are large enough to be jams, with their mean speed
+        std::vector<JamCluster> jams;
+        for (JamCluster& cluster : found) {
+            if (cluster.size >= this->min_size) {
+                cluster.speed /= cluster.size;
+                jams.push_back(cluster);
+            }
+        }
+        this->trackSample(time, jams);
+    }
+    this->output.flush();
+}
+
+/**
+ * Follows the jams from the previous sample to the jams of a sample. The jams are matched largest first, each to the
+ * oldest unmatched jam of the previous sample in its Lane that it overlaps after the jam of the previous sample is
+ * widened by the distance a jam can move between the samples. A matched jam keeps the id of the jam of the previous
+ * sample, and the jams that are not matched start or end.
+ * @param time the step of the sample
+ * @param found the jams of the sample, which are given their ids
+ */
+void Jams::trackSample(int time, std::vector<JamCluster>& found) {
+    if (!this->output.is_open()) {
+        this->output.open("jams.csv");
+        this->output << "time,cluster,lane,back,front,size,speed,event" << "\n";
+    }
+
+    int reach = this->interval * std::max(1, this->max_speed);
+    std::vector<int> order(found.size());
+    for (int n = 0; n < (int) found.size(); n++) {
+        order[n] = n;
+    }
+    std::stable_sort(order.begin(), order.end(), [&found](int a, int b) {
+        return found[a].size > found[b].size;
+    });
+
+    // The jams of the previous sample are in the order of their ids
+    std::vector<char> matched(this->clusters.size(), 0);
+    for (int n : order) {
+        JamCluster& cluster = found[n];
+        for (int k = 0; k < (int) this->clusters.size(); k++) {
+            const JamCluster& previous = this->clusters[k];
+            if (!matched[k] && previous.lane == cluster.lane && cluster.back <= previous.front + reach &&
+                cluster.front >= previous.back - reach) {
+                matched[k] = 1;
+                cluster.id = previous.id;
+                cluster.first_time = previous.first_time;
+                break;
+            }
+        }
+        if (cluster.id == -1) {
+            cluster.id = this->next_cluster_id++;
+            this->num_clusters++;
+        }
+        this->max_cluster_size = std::max(this->max_cluster_size, cluster.size);
+        this->longest_duration = std::max(this->longest_duration, time - cluster.first_time);
+    }
+
+    for (int k = 0; k < (int) this->clusters.size(); k++) {
+        if (!matched[k]) {
+            this->writeEvent(time, this->clusters[k], "end");
+        }
+    }
+    std::sort(found.begin(), found.end(), [](const JamCluster& a, const JamCluster& b) {
+        return a.id < b.id;
+    });
+    for (const JamCluster& cluster : found) {
+        this->writeEvent(time, cluster, cluster.first_time == time ? "start" : "update");
+    }
+    this->clusters = found;
+}
+
+/**
+ * Writes an event of a jam as a line of the output file
+ * @param time the step of the event
+ * @param cluster the jam, as it was last seen
+ * @param event the kind of event
+ */
+void Jams::writeEvent(int time, const JamCluster& cluster, const char* event) {
+    this->output << time << "," << cluster.id << "," << cluster.lane << "," << cluster.back << "," << cluster.front
+                 << "," << cluster.size << "," << cluster.speed << "," << event << "\n";
+}
+
+/**
+ * Prints the number of jams, the largest jam and the longest lasting jam, on the first process
+ * @param curr_process pointer to the current process
+ */
+void Jams::report(Process* curr_process) {
+    if (!this->isEnabled() || curr_process->getRank() != 0) {
+        return;
+    }
+    std::ostringstream report;
+    report << "--- Jams ---" << std::endl;
+    report << "jams: " << this->num_clusters << ", largest: " << this->max_cluster_size << " vehicles, longest: "
+           << this->longest_duration << " steps, still jammed at the end: " << this->clusters.size() << std::endl;
+    std::cout << report.str();
+}
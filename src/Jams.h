@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_JAMS_H
+#define CA_TRAFFIC_SIMULATION_JAMS_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+
+#include "Inputs.h"
+
+// Forward Declarations
+class Vehicle;
+class Process;
+
+/**
+ * Structure for a jam that is tracked between the samples, with the sample it was first seen in
+ */
+struct JamCluster {
+    int id;
+    int lane;
+    int back;
+    int front;
+    int size;
+    double speed;
+    int first_time;
+};
+
+/**
+ * Class for the jams of a single road, the clusters of stopped or slow Vehicles in a Lane. Each process finds the runs
+ * of slow Vehicles in its own part of each of its Lanes at every sample, and tells the next process whether its last
+ * Vehicle in each Lane is slow, so that a cluster that spans the boundary between the processes is stitched together.
+ * The runs are buffered and gathered on the first process in batches, where the clusters are followed from sample to
+ * sample and written as a stream of events when they start, change and end.
+ */
+class Jams {
+private:
+    int max_speed;
+    int max_gap;
+    int min_size;
+    int interval;
+    int num_lanes;
+    std::vector<double> batch;
+    std::vector<int> batch_times;
+    std::vector<JamCluster> clusters;
+    int next_cluster_id;
+    int num_clusters;
+    int max_cluster_size;
+    int longest_duration;
+    std::ofstream output;
+    void flush(Process* curr_process);
+    void trackSample(int time, std::vector<JamCluster>& found);
+    void writeEvent(int time, const JamCluster& cluster, const char* event);
+public:
+    Jams();
+    int loadFromFile(std::string file_name, Inputs inputs);
+    bool isEnabled();
+    void endStep(int time, int max_time, const std::vector<Vehicle*>& vehicles, int start_position, int end_position,
+                 int first_lane, int last_lane, Process* curr_process);
+    void report(Process* curr_process);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_JAMS_H
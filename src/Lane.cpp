@@ -6,31 +6,45 @@
 #include <cstdio>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 
 #include "Lane.h"
 #include "Vehicle.h"
 #include "Inputs.h"
+#include "Random.h"
 
 /**
  * Constructor for the Lane class
  * @param inputs instance of the Inputs class with simulation inputs
  * @param lane_num the number of lane in the road, starting with zero as the first lane
+ * @param sparse whether the Lane only stores its occupied sites instead of every site of the road
  */
-Lane::Lane(Inputs inputs, int lane_num) {
+Lane::Lane(Inputs inputs, int lane_num, bool sparse) {
 #ifdef DEBUG
-    std::cout << "creating lane " << lane_num << "...";
+    std::cout << "creating " << (sparse ? "sparse" : "dense") << " lane " << lane_num << "...";
 #endif
-    // Allocate memory for the vehicle pointers list
-    this->sites.reserve(inputs.length);
-    this->sites.resize(inputs.length);
+    // Set the number of sites in the Lane
+    this->length = inputs.length;
+
+    // Allocate memory for the vehicle pointers list, only needed if the Lane is dense
+    this->sparse = false;
+    this->setSparse(sparse);
 
     // Set the lane number for the lane
     this->lane_num = lane_num;
 #ifdef DEBUG
-    std::cout << "done, lane " << lane_num << " created with length " << this->sites.size() << std::endl;
+    std::cout << "done, lane " << lane_num << " created with length " << this->length << std::endl;
 #endif
 
     this->steps_to_spawn = 0;
+
+    // The Lane has no detectors until they are set
+    this->detectors_ptr = nullptr;
+    this->detector_cells = nullptr;
+
+    // The moves of the Vehicles are recorded over the whole Lane
+    this->record_first = 0;
+    this->record_last = this->length - 1;
 }
 
 /**
@@ -38,7 +52,7 @@ Lane::Lane(Inputs inputs, int lane_num) {
  * @return number of sites in the Lane
  */
 int Lane::getSize() {
-    return this->sites.size();
+    return this->length;
 }
 
 /**
@@ -49,15 +63,130 @@ int Lane::getLaneNumber() {
     return this->lane_num;
 }
 
+/**
+ * Getter method for the number of steps until the next Vehicle is spawned in the Lane
+ * @return the number of steps
+ */
+int Lane::getStepsToSpawn() {
+    return this->steps_to_spawn;
+}
+
+/**
+ * Setter method for the number of steps until the next Vehicle is spawned in the Lane
+ * @param steps_to_spawn the number of steps
+ */
+void Lane::setStepsToSpawn(int steps_to_spawn) {
+    this->steps_to_spawn = steps_to_spawn;
+}
+
+/**
+ * Getter method for the storage mode of the Lane
+ * @return whether the Lane only stores its occupied sites
+ */
+bool Lane::isSparse() {
+    return this->sparse;
+}
+
+/**
+ * Switches the Lane between the dense and the sparse storage, moving the Vehicles in the Lane to the new storage
+ * @param sparse whether the Lane should only store its occupied sites
+ */
+void Lane::setSparse(bool sparse) {
+    if (sparse) {
+        // Collect the occupied sites in order of the site number and release the dense sites
+        if (!this->sparse) {
+            this->occupants.clear();
+            for (int i = 0; i < (int) this->sites.size(); i++) {
+                for (Vehicle* vehicle_ptr : this->sites[i]) {
+                    this->occupants.push_back({i, vehicle_ptr});
+                }
+            }
+            std::vector<std::deque<Vehicle*>>().swap(this->sites);
+        }
+    } else {
+        // Allocate every site of the Lane and move the occupants into their sites
+        if (this->sparse || this->sites.empty()) {
+            this->sites.reserve(this->length);
+            this->sites.resize(this->length);
+            for (Occupant& occupant : this->occupants) {
+                this->sites[occupant.site].push_back(occupant.vehicle_ptr);
+            }
+            std::vector<Occupant>().swap(this->occupants);
+        }
+    }
+
+    this->sparse = sparse;
+}
+
+/**
+ * Locates the first entry of a site in the occupants of a sparse Lane
+ * @param site the site to locate
+ * @return iterator to the first occupant in the site, or to the first occupant beyond the site if it is empty
+ */
+std::vector<Occupant>::iterator Lane::findOccupant(int site) {
+    return std::lower_bound(this->occupants.begin(), this->occupants.end(), site,
+                            [](const Occupant& occupant, int value) { return occupant.site < value; });
+}
+
 /**
  * Checks if the Lane has a Vehicle in a specific site
  * @param site the site in which to check for a Vehicle
  * @return whether or not the Lane has a Vehicle in the site
  */
 bool Lane::hasVehicleInSite(int site) {
+    if (this->sparse) {
+        std::vector<Occupant>::iterator it = this->findOccupant(site);
+        return it != this->occupants.end() && it->site == site;
+    }
     return !(this->sites[site].empty());
 }
 
+/**
+ * Finds the first occupied site in a range of sites of the Lane
+ * @param from_site first site of the range
+ * @param to_site last site of the range
+ * @return the lowest occupied site in the range, or -1 if there is none
+ */
+int Lane::nextOccupiedSite(int from_site, int to_site) {
+    if (this->sparse) {
+        std::vector<Occupant>::iterator it = this->findOccupant(from_site);
+        if (it != this->occupants.end() && it->site <= to_site) {
+            return it->site;
+        }
+        return -1;
+    }
+
+    for (int i = std::max(from_site, 0); i <= to_site && i < this->length; i++) {
+        if (!this->sites[i].empty()) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Finds the last occupied site in a range of sites of the Lane
+ * @param from_site first site of the range
+ * @param to_site last site of the range
+ * @return the highest occupied site in the range, or -1 if there is none
+ */
+int Lane::lastOccupiedSite(int from_site, int to_site) {
+    if (this->sparse) {
+        std::vector<Occupant>::iterator it = this->findOccupant(to_site + 1);
+        if (it != this->occupants.begin() && (it - 1)->site >= from_site) {
+            return (it - 1)->site;
+        }
+        return -1;
+    }
+
+    for (int i = std::min(to_site, this->length - 1); i >= from_site && i >= 0; i--) {
+        if (!this->sites[i].empty()) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 /**
  * Adds a Vehicle to a site in the Lane
  * @param site which site to add the Vehicle to
@@ -65,8 +194,12 @@ bool Lane::hasVehicleInSite(int site) {
  * @return 0 if successful, nonzero otherwise
  */
 int Lane::addVehicle(int site, Vehicle* vehicle_ptr) {
-    // Place the Vehicle in the site
-    this->sites[site].push_back(vehicle_ptr);
+    // Place the Vehicle in the site, behind any Vehicle that is still leaving the site
+    if (this->sparse) {
+        this->occupants.insert(this->findOccupant(site + 1), {site, vehicle_ptr});
+    } else {
+        this->sites[site].push_back(vehicle_ptr);
+    }
 
     // Return with zero errors
     return 0;
@@ -79,12 +212,29 @@ int Lane::addVehicle(int site, Vehicle* vehicle_ptr) {
  */
 int Lane::removeVehicle(int site) {
     // Remove the Vehicle from the site
-    this->sites[site].pop_front();
+    if (this->sparse) {
+        std::vector<Occupant>::iterator it = this->findOccupant(site);
+        if (it != this->occupants.end() && it->site == site) {
+            this->occupants.erase(it);
+        }
+    } else {
+        this->sites[site].pop_front();
+    }
 
     // Return with zero errors
     return 0;
 }
 
+/**
+ * Updates the sites of the occupants of a sparse Lane to the positions of their Vehicles in one pass, once the Vehicles
+ * moved along the Lane. The occupants stay ordered by site, since the Vehicles never pass each other within a Lane.
+ */
+void Lane::updateOccupants() {
+    for (Occupant& occupant : this->occupants) {
+        occupant.site = occupant.vehicle_ptr->getPosition();
+    }
+}
+
 /**
  * Attempts to spawn a Vehicle that has entered the Lane at the first site. Uses a CDF to sample to determine whether
  * or not a Vehicle was spawned.
@@ -102,12 +252,14 @@ int Lane::attemptSpawn(Inputs inputs, std::vector<Vehicle*>* vehicles, int* next
             std::cout << "creating vehicle " << (*next_id_ptr) << " in lane " << this->lane_num << " at site " << 0
                       << std::endl;
 #endif
-            this->sites[0].push_front(new Vehicle(this, *next_id_ptr, 0, inputs));
+            Vehicle* vehicle_ptr = new Vehicle(this, *next_id_ptr, 0, VehicleClass::sampleClass());
+            this->addVehicle(0, vehicle_ptr);
             (*next_id_ptr)++;
-            vehicles->push_back(this->sites[0].front());
+            vehicles->push_back(vehicle_ptr);
 
             // Randomly choose the Vehicles initial speed to be zero bases in slow down probability
-            if (((double) std::rand()) / ((double) RAND_MAX) < inputs.prob_slow_down) {
+            if (randomUniform() <
+                VehicleClass::table[vehicle_ptr->getClassId()].prob_slow_down) {
                 vehicles->back()->setSpeed(0);
             }
 
@@ -132,7 +284,7 @@ int Lane::attemptSpawn(Vehicle* vehicle_ptr, std::vector<Vehicle*>* vehicles) {
         vehicle_ptr->setLanePtr(this);
 
         this->addVehicle(vehicle_ptr->getPosition(), vehicle_ptr);
-        vehicles->push_back(this->sites[vehicle_ptr->getPosition()].front());
+        vehicles->push_back(vehicle_ptr);
         // return with no error
         return 0;
     }
@@ -144,6 +296,40 @@ int Lane::attemptSpawn(Vehicle* vehicle_ptr, std::vector<Vehicle*>* vehicles) {
     return -1;
 }
 
+/**
+ * Sets the detectors of the Lane
+ * @param detectors_ptr pointer to the detectors of the process
+ * @param detector_cells pointer to the detectors of the segment of the Lane, or nullptr if it has none
+ */
+void Lane::setDetectors(Detectors* detectors_ptr, DetectorCells* detector_cells) {
+    this->detectors_ptr = detector_cells != nullptr ? detectors_ptr : nullptr;
+    this->detector_cells = detector_cells;
+}
+
+/**
+ * Sets the range of sites from which the moves of the Vehicles are recorded over the detectors of the Lane, so that
+ * copies of Vehicles that another process owns are not recorded twice
+ * @param first_site first site of the range
+ * @param last_site last site of the range
+ */
+void Lane::setRecordedRange(int first_site, int last_site) {
+    this->record_first = first_site;
+    this->record_last = last_site;
+}
+
+/**
+ * Estimates the memory allocated for the sites of the Lane. An empty std::deque of libstdc++ already allocates its
+ * map of 8 node pointers and a first node of 512 bytes, which dominates the footprint of a dense Lane.
+ * @return number of bytes allocated for the sites
+ */
+long Lane::getMemoryUsage() {
+    if (this->sparse) {
+        return sizeof(Lane) + this->occupants.capacity() * sizeof(Occupant);
+    }
+    long site_bytes = sizeof(std::deque<Vehicle*>) + 8 * sizeof(Vehicle**) + 512;
+    return sizeof(Lane) + this->sites.capacity() * site_bytes;
+}
+
 
 /**
  * Debug function to print the Lane to visualize the sites
@@ -151,17 +337,26 @@ int Lane::attemptSpawn(Vehicle* vehicle_ptr, std::vector<Vehicle*>* vehicles) {
 #ifdef DEBUG
 void Lane::printLane() {
     std::ostringstream lane_string_stream;
-    for (int i = 0; i < (int) this->sites.size(); i++) {
-        if (this->sites[i].empty()) {
+    std::vector<Occupant>::iterator it = this->occupants.begin();
+    for (int i = 0; i < this->length; i++) {
+        Vehicle* vehicle_ptr = nullptr;
+        if (this->sparse) {
+            while (it != this->occupants.end() && it->site < i) {
+                it++;
+            }
+            if (it != this->occupants.end() && it->site == i) {
+                vehicle_ptr = it->vehicle_ptr;
+            }
+        } else if (!this->sites[i].empty()) {
+            vehicle_ptr = this->sites[i].front();
+        }
+
+        if (vehicle_ptr == nullptr) {
             lane_string_stream << "[   ]";
         } else {
-            lane_string_stream << "[" << std::setw(3) << this->sites[i].front()->getId() << "]";
+            lane_string_stream << "[" << std::setw(3) << vehicle_ptr->getId() << "]";
         }
     }
     std::cout << lane_string_stream.str() << std::endl;
 }
 #endif
-
-std::vector<std::deque<Vehicle*>> Lane::getSites(){
-    return this->sites;
-}
\ No newline at end of file
@@ -10,30 +10,69 @@
 
 #include "Inputs.h"
 #include "CDF.h"
+#include "Detectors.h"
 
 // Forward Declarations
 class Vehicle;
 
+/**
+ * Structure for an occupied site of a sparse Lane, which pairs the site number with the Vehicle in it
+ */
+struct Occupant {
+    int site;
+    Vehicle* vehicle_ptr;
+};
+
 /**
  * Class for a lane in the road of the simulation. Each lane contains the "sites" for the vehicles and allows access
- * to all the information about the vehicles on the road through its methods.
+ * to all the information about the vehicles on the road through its methods. A Lane is either dense, where every site
+ * of the road is allocated, or sparse, where only the occupied sites are stored as a list ordered by site number.
  */
 class Lane {
 private:
     std::vector<std::deque<Vehicle*>> sites;
+    std::vector<Occupant> occupants;
+    bool sparse;
+    int length;
     int lane_num;
     int steps_to_spawn;
+    Detectors* detectors_ptr;
+    DetectorCells* detector_cells;
+    int record_first;
+    int record_last;
+    std::vector<Occupant>::iterator findOccupant(int site);
 public:
-    Lane(Inputs inputs, int lane_num);
+    Lane(Inputs inputs, int lane_num, bool sparse);
     int getSize();
     int getLaneNumber();
-    std::vector<std::deque<Vehicle*>> getSites();
+    bool isSparse();
+    int getStepsToSpawn();
+    void setStepsToSpawn(int steps_to_spawn);
+    void setSparse(bool sparse);
     bool hasVehicleInSite(int site);
+    int nextOccupiedSite(int from_site, int to_site);
+    int lastOccupiedSite(int from_site, int to_site);
     int addVehicle(int site, Vehicle* vehicle_ptr);
     int removeVehicle(int site);
+    void updateOccupants();
     int attemptSpawn(Inputs inputs, std::vector<Vehicle*>* vehicles, int* next_id_ptr, CDF* interarrival_time_cdf, std::vector<int> last_vehicles);
     int attemptSpawn(Vehicle* vehicle_ptr, std::vector<Vehicle*>* vehicles);
-    
+    void setDetectors(Detectors* detectors_ptr, DetectorCells* detector_cells);
+    void setRecordedRange(int first_site, int last_site);
+    long getMemoryUsage();
+
+    /**
+     * Records the move of a Vehicle of the Lane over the detectors of the Lane, if it has any and the Vehicle starts the
+     * move in the recorded range of the Lane
+     * @param from position of the Vehicle before the move
+     * @param to position of the Vehicle after the move
+     */
+    inline void recordMove(int from, int to) {
+        if (this->detectors_ptr != nullptr && from >= this->record_first && from <= this->record_last) {
+            this->detectors_ptr->recordMove(*this->detector_cells, this->lane_num, from, to);
+        }
+    }
+
 #ifdef DEBUG
     void printLane();
 #endif
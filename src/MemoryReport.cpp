@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+
+#include "MemoryReport.h"
+
+/**
+ * Formats a number of bytes in the largest unit that keeps it above one
+ * @param bytes the number of bytes
+ * @return the number of bytes, kilobytes, megabytes or gigabytes with two decimals
+ */
+std::string formatBytes(double bytes) {
+    const char* units[] = {"B", "KB", "MB", "GB"};
+    int unit = 0;
+    while (bytes >= 1024.0 && unit < 3) {
+        bytes /= 1024.0;
+        unit++;
+    }
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(2) << bytes << " " << units[unit];
+    return stream.str();
+}
+
+/**
+ * Constructor for the MemoryReport
+ * @param inputs instance of the Inputs class with the number of steps between the reports, zero for reports at the
+ * start and the end only
+ */
+MemoryReport::MemoryReport(Inputs inputs) {
+    this->interval = inputs.memory_interval;
+    this->peak_vehicles = 0;
+}
+
+/**
+ * Checks whether a report is due after a step
+ * @param time number of steps completed
+ * @return true if the interval is set and the step is a multiple of it, false otherwise
+ */
+bool MemoryReport::isDue(int time) {
+    return this->interval > 0 && time % this->interval == 0;
+}
+
+/**
+ * Combines the memory usage over all the processes and prints the report on the first process. Must be called by all
+ * the processes at the same step.
+ * @param stage name of the stage of the simulation of the report
+ * @param usage the memory usage of the current process
+ * @param curr_process pointer to the current process
+ */
+void MemoryReport::report(std::string stage, MemoryUsage usage, Process* curr_process) {
+    this->trackVehicles(usage.live_vehicles);
+    std::vector<double> values = {(double) usage.lanes, (double) usage.vehicles, (double) usage.statistics,
+                                  (double) usage.buffers, (double) curr_process->getPeakResidentBytes(),
+                                  (double) usage.live_vehicles, (double) this->peak_vehicles, (double) usage.cells};
+    std::vector<double> sums = curr_process->reduceSum(values);
+    std::vector<double> maximums = curr_process->reduceMax(values);
+
+    if (curr_process->getRank() != 0) {
+        return;
+    }
+
+    std::vector<std::string> subsystems = {"lanes", "vehicles", "statistics", "message buffers"};
+    double subsystem_bytes = 0.0;
+    std::ostringstream report;
+    report << "--- Memory Report (" << stage << ") ---" << std::endl;
+    for (int i = 0; i < (int) subsystems.size(); i++) {
+        report << "Memory : " << subsystems[i] << ": total " << formatBytes(sums[i]) << ", max "
+               << formatBytes(maximums[i]) << " per process" << std::endl;
+        subsystem_bytes += sums[i];
+    }
+    report << "Memory : peak RSS: total " << formatBytes(sums[4]) << std::endl;
+    report << "Memory : vehicles: live " << (long) sums[5] << " (max " << (long) maximums[5] << " per process), peak "
+           << (long) sums[6] << " (max " << (long) maximums[6] << " per process)" << std::endl;
+    report << "Memory : bytes per cell: subsystems " << subsystem_bytes / sums[7] << ", peak RSS " << sums[4] / sums[7]
+           << " (" << (long) sums[7] << " cells)" << std::endl;
+    std::cout << report.str();
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_MEMORYREPORT_H
+#define CA_TRAFFIC_SIMULATION_MEMORYREPORT_H
+
+#include <string>
+
+#include "Inputs.h"
+#include "Process.h"
+
+std::string formatBytes(double bytes);
+
+/**
+ * Structure for the memory used by the subsystems of a process in bytes, with the number of Vehicles and cells of the
+ * process
+ */
+struct MemoryUsage {
+    long lanes;
+    long vehicles;
+    long statistics;
+    long buffers;
+    long live_vehicles;
+    long cells;
+};
+
+/**
+ * Class for the report of the memory footprint of the simulation, with the bytes of each subsystem, the peak resident
+ * set size, the live and peak number of Vehicles and the bytes per cell, combined over all the processes. The report is
+ * printed at the start, at a configurable interval of steps and at the end of the simulation.
+ */
+class MemoryReport {
+private:
+    int interval;
+    long peak_vehicles;
+public:
+    MemoryReport(Inputs inputs);
+    bool isDue(int time);
+    void report(std::string stage, MemoryUsage usage, Process* curr_process);
+
+    /**
+     * Keeps track of the peak number of Vehicles of the process
+     * @param num_vehicles current number of Vehicles of the process
+     */
+    inline void trackVehicles(long num_vehicles) {
+        if (num_vehicles > this->peak_vehicles) {
+            this->peak_vehicles = num_vehicles;
+        }
+    }
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_MEMORYREPORT_H
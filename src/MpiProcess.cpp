@@ -1,13 +1,71 @@
 #include "MpiProcess.h"
+#include "MpiProfiler.h"
+#include "VehicleClass.h"
 #include <cstddef>
+#include <cstring>
+#include <algorithm>
 
+// Number of messages that the hand-off rings of the communication thread hold
+const int COMM_RING_CAPACITY = 1024;
+
+// Number of values of a Vehicle packed in a message of the communication thread or of the shared memory
+const int PACKED_VEHICLE_SIZE = 5;
+
+// Smallest number of migrating Vehicles that fit in the shared memory or in the inbox of the one-sided transport
+const int MIN_SHARED_MIGRANTS = 64;
+
+// Tag of the bound on the Vehicles behind an idle rank, which replaces its boundaries
+const int FRONT_TAG = 150;
+const int TAIL_TAG = 160;
+
+// Tag of the messages of the ranks that run ahead optimistically
+const int OPTIMISTIC_TAG = 170;
 
-const int NO_RANK = -1;
 
 MpiProcess::MpiProcess(int argc, char **argv){
+    this->comm_thread_ptr = nullptr;
+    this->shared_boundary_ptr = nullptr;
+    this->use_shared_boundary = false;
+    this->rma_boundary_ptr = nullptr;
+    this->use_rma_boundary = false;
+    this->requested_lane_groups = 0;
+    this->cart_comm = MPI_COMM_NULL;
+    this->quiet_exchange = false;
+    this->max_speed = 1;
+    this->idle = false;
+    this->next_idle = false;
+    this->prev_quiet_steps = 0;
+    this->next_quiet_steps = 0;
+    this->prev_front = 0;
+    this->prev_front_age = 0;
+    this->boundary_updates = 0;
+    this->boundary_repeats = 0;
+    this->migrations_sent = 0;
+    this->migrations_skipped = 0;
+    this->idle_steps = 0;
+    bool use_comm_thread = false;
+    bool use_profiler = false;
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "-comm-thread") == 0){
+            use_comm_thread = true;
+        } else if(strcmp(argv[i], "-shm") == 0){
+            this->use_shared_boundary = true;
+        } else if(strcmp(argv[i], "-rma") == 0){
+            this->use_rma_boundary = true;
+        } else if(strcmp(argv[i], "-mpi-profile") == 0){
+            use_profiler = true;
+        } else if(strcmp(argv[i], "-lane-groups") == 0 && i + 1 < argc){
+            this->requested_lane_groups = atoi(argv[++i]);
+        }
+    }
 
-    // Initialize the MPI environment
-    MPI_Init(&argc, &argv);
+    // Initialize the MPI environment, where the communication thread calls MPI alongside the compute thread
+    int provided = MPI_THREAD_SINGLE;
+    if(use_comm_thread){
+        MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+    } else {
+        MPI_Init(&argc, &argv);
+    }
   
     // Get the total number of processes 
     int num_of_processes;
@@ -19,102 +77,194 @@ MpiProcess::MpiProcess(int argc, char **argv){
 
     printf("Hello world from process %d out of %d processors\n", my_rank, num_of_processes);
 
-    this->rank = my_rank;
-    this->num_of_processes = num_of_processes;
-
-    // Set prev rank
-    if(this->rank == 0)
-        this->prev_rank = NO_RANK;
-    else
-        this->prev_rank = this->rank - 1;
-    
-    // Set next rank
-    if(this->rank == num_of_processes - 1)
-        this->next_rank = NO_RANK;
-    else
-        this->next_rank = this->rank + 1;
-
-    this->defineMpiVehicle();
-}
-
-int MpiProcess::getRank(){ return this->rank; }
-
-int MpiProcess::getNextRank(){ return this->next_rank; }
+    this->setRanks(my_rank, num_of_processes);
 
-int MpiProcess::getPrevRank(){ return this->prev_rank; }
-
-int MpiProcess::getNumOfProcesses(){ return this->num_of_processes; }
+    // Record the MPI calls from here on, for the profile printed at the end
+    if(use_profiler){
+        MpiProfiler::start();
+    }
 
-int MpiProcess::getStartPosition(){ return this->road_start; }
-        
-int MpiProcess::getEndPosition(){ return this->road_end; }
+    this->defineMpiVehicle();
 
+    // Start the communication thread if MPI supports calls from several threads
+    if(use_comm_thread){
+        if(provided == MPI_THREAD_MULTIPLE){
+            this->comm_thread_ptr = new CommThread(COMM_RING_CAPACITY);
+        } else if(my_rank == 0){
+            printf("MPI does not support calls from several threads, running without the communication thread\n");
+        }
+    }
+}
 
-MpiProcess::~MpiProcess(){}
+MpiProcess::~MpiProcess(){
+    for(MPI_Request& request : this->optimistic_requests){
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+    }
+    delete this->comm_thread_ptr;
+    delete this->shared_boundary_ptr;
+    delete this->rma_boundary_ptr;
+    if(this->cart_comm != MPI_COMM_NULL){
+        MPI_Comm_free(&this->cart_comm);
+    }
+    MpiProfiler::report();
+    MPI_Finalize();
+}
 
 
-void MpiProcess::divideRoad(int road_length){
-    int temp_start, temp_end, remainder;
+/**
+* Divide the road over a Cartesian grid of segments along its length and groups of its Lanes, where each rank has a
+* group of Lanes of a segment, and set up the transport of the boundaries with the neighbouring ranks. The ranks keep
+* their order, with the groups of Lanes of a segment on consecutive ranks.
+* @param inputs instance of the Inputs class with the simulation Inputs
+*/
+void MpiProcess::divideRoad(Inputs inputs){
+    MpiProfileSite site("divideRoad");
+    int p = this->getNumOfProcesses();
+    int lane_groups = this->requested_lane_groups > 0 ? this->requested_lane_groups : chooseLaneGroups(p, inputs);
+    if(p % lane_groups != 0 || lane_groups > inputs.num_lanes){
+        throw std::runtime_error("The " + std::to_string(lane_groups) + " groups of lanes must divide the "
+                                 + std::to_string(p) + " processes, with a lane in each group");
+    }
 
-    if(this->getRank() == 0){
-        temp_start = 0;
-        remainder = road_length;
-        int p = this->getNumOfProcesses();
-        
-        for(int i = 0; i < p; i++){
-            int batch_size = remainder / (p-i);
-            temp_end = temp_start + batch_size;
-            remainder -= batch_size;
+    int dims[2] = {p / lane_groups, lane_groups};
+    int periods[2] = {0, 0};
+    MPI_Cart_create(MPI_COMM_WORLD, 2, dims, periods, 0, &this->cart_comm);
+    int coords[2];
+    MPI_Cart_coords(this->cart_comm, this->rank, 2, coords);
 
-            MPI_Send(&temp_start, 1, MPI_INT, i, 30, MPI_COMM_WORLD);
-            MPI_Send(&temp_end, 1, MPI_INT, i, 40, MPI_COMM_WORLD);
-            temp_start = temp_end;
+    // The neighbours along the road are in the same group of Lanes, and the neighbours across it in the same segment
+    int ranks[4];
+    MPI_Cart_shift(this->cart_comm, 0, 1, &ranks[0], &ranks[1]);
+    MPI_Cart_shift(this->cart_comm, 1, 1, &ranks[2], &ranks[3]);
+    for(int& neighbour : ranks){
+        if(neighbour == MPI_PROC_NULL){
+            neighbour = -1;
         }
     }
-    MPI_Status status;
-    MPI_Recv(&temp_start, 1, MPI_INT, 0, 30, MPI_COMM_WORLD, &status);
-    MPI_Recv(&temp_end, 1, MPI_INT, 0, 40, MPI_COMM_WORLD, &status);
+    this->prev_rank = ranks[0];
+    this->next_rank = ranks[1];
 
-    this->road_start = temp_start;
-    this->road_end = temp_end - 1;
+    int length = splitRange(inputs.length, dims[0], coords[0], &this->road_start);
+    this->road_end = this->road_start + length - 1;
+    int first_lane;
+    int num_lanes = splitRange(inputs.num_lanes, dims[1], coords[1], &first_lane);
+    this->setLanes(first_lane, first_lane + num_lanes - 1, ranks[2], ranks[3], lane_groups);
+    if(this->rank == 0 && lane_groups > 1){
+        printf("Dividing the road into %d segments of %d groups of lanes\n", dims[0], lane_groups);
+    }
 #ifdef DEBUG
-    printf("Process: %d, my road start: %d, my road end: %d\n", this->getRank(), this->road_start, this->road_end);
+    printf("Process: %d, my road start: %d, my road end: %d, my lanes: %d to %d\n", this->getRank(),
+           this->road_start, this->road_end, this->first_lane, this->last_lane);
 #endif
+
+    // Nothing has been exchanged yet, which is the same as empty boundaries
+    this->last_to_prev.assign(this->num_lanes, -1);
+    this->last_from_next.assign(this->num_lanes, -1);
+    this->first_to_next.assign(this->num_lanes, -1);
+    this->first_from_prev.assign(this->num_lanes, -1);
+
+    // Set up the boundary exchange through shared memory with the neighbours on the same node, or the one-sided one.
+    // At most one Vehicle per site of the last max_speed sites of each lane reaches the next process in a step, with
+    // the fastest class, so the inbox of the one-sided transport never overflows.
+    int max_speed = inputs.max_speed;
+    for(const VehicleClass& vehicle_class : VehicleClass::table){
+        max_speed = std::max(max_speed, vehicle_class.max_speed);
+    }
+    int migrants = std::max(MIN_SHARED_MIGRANTS, 4 * inputs.num_lanes * max_speed);
+    if(this->use_rma_boundary){
+        this->rma_boundary_ptr = new RmaBoundary(this->rank, this->prev_rank, this->next_rank, inputs.num_lanes,
+                                                 migrants * (1 + PACKED_VEHICLE_SIZE));
+    } else if(this->use_shared_boundary){
+        this->shared_boundary_ptr = new SharedBoundary(this->prev_rank, this->next_rank, inputs.num_lanes,
+                                                       migrants * (1 + PACKED_VEHICLE_SIZE));
+    }
 }
 
 void MpiProcess::defineMpiVehicle(){
-     int block_lengths[13] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
-        MPI_Datatype types[13] = {
-            MPI_INT, MPI_INT, MPI_INT, MPI_INT, MPI_INT, MPI_INT, MPI_INT, 
-            MPI_INT, MPI_INT, MPI_INT, MPI_DOUBLE, MPI_DOUBLE, MPI_INT};
+        // Only the state of the Vehicle is sent, the gaps are recomputed by the receiving process and the driving
+        // parameters are looked up from the class of the Vehicle
+        int block_lengths[5] = {1, 1, 1, 1, 1};
+        MPI_Datatype types[5] = {MPI_INT, MPI_INT, MPI_INT, MPI_INT, MPI_UNSIGNED_CHAR};
 
-        MPI_Aint offsets[13];
+        MPI_Aint offsets[5];
         offsets[0] = offsetof(Vehicle, id);
         offsets[1] = offsetof(Vehicle, position);
         offsets[2] = offsetof(Vehicle, speed);
-        offsets[3] = offsetof(Vehicle, max_speed);
-        offsets[4] = offsetof(Vehicle, gap_forward);
-        offsets[5] = offsetof(Vehicle, gap_other_forward);
-        offsets[6] = offsetof(Vehicle, gap_other_backward);
-        offsets[7] = offsetof(Vehicle, look_forward);
-        offsets[8] = offsetof(Vehicle, look_other_forward);
-        offsets[9] = offsetof(Vehicle, look_other_backward);
-        offsets[10] = offsetof(Vehicle, prob_slow_down);
-        offsets[11] = offsetof(Vehicle, prob_change);
-        offsets[12] = offsetof(Vehicle, time_on_road);
-
-        MPI_Type_create_struct(13, block_lengths, offsets, types, &mpi_vehicle);
+        offsets[3] = offsetof(Vehicle, time_on_road);
+        offsets[4] = offsetof(Vehicle, class_id);
+
+        MPI_Type_create_struct(5, block_lengths, offsets, types, &mpi_vehicle);
         MPI_Type_commit(&mpi_vehicle);
+
+        // Stretch the datatype over the whole object, to send arrays of Vehicles
+        MPI_Type_create_resized(mpi_vehicle, 0, sizeof(Vehicle), &mpi_vehicle_array);
+        MPI_Type_commit(&mpi_vehicle_array);
+}
+
+/**
+* Append the state of a Vehicle to a message of the communication thread or of the shared memory, the same state as
+* the MPI Vehicle datatype
+* @param values the contents of the message
+* @param vehicle pointer to the Vehicle
+*/
+void MpiProcess::packVehicle(std::vector<int>& values, Vehicle* vehicle){
+    values.push_back(vehicle->id);
+    values.push_back(vehicle->position);
+    values.push_back(vehicle->speed);
+    values.push_back(vehicle->time_on_road);
+    values.push_back(vehicle->class_id);
+}
+
+/**
+* Create a Vehicle from its state in a message of the communication thread or of the shared memory
+* @param values pointer to the state of the Vehicle in the message
+* @return pointer to the new Vehicle
+*/
+Vehicle* MpiProcess::unpackVehicle(const int* values){
+    Vehicle* vehicle = new Vehicle();
+    vehicle->id = values[0];
+    vehicle->position = values[1];
+    vehicle->speed = values[2];
+    vehicle->time_on_road = values[3];
+    vehicle->class_id = values[4];
+    return vehicle;
 }
 
 // send all the vehicles that are about to cross the thresold
 void MpiProcess::sendVehicle(std::vector<Vehicle *>& vehicles_to_send){
+    MpiProfileSite site("sendVehicle");
     int size = vehicles_to_send.size();
-    MPI_Send(&size, 1, MPI_INT, this->getNextRank(), 50, MPI_COMM_WORLD);
+
+    // No Vehicle can reach the next process in this step, which it knows as well
+    if(this->next_quiet_steps > 0){
+        if(size > 0){
+            throw std::logic_error("A vehicle reached the next process in a step in which none could");
+        }
+        this->next_quiet_steps--;
+        this->migrations_skipped++;
+        return;
+    }
+
+    this->recordBufferBytes(size * (sizeof(int) + sizeof(Vehicle)));
+    std::vector<int> values;
+    values.reserve(size * (1 + PACKED_VEHICLE_SIZE));
     for(auto &vehicle: vehicles_to_send){
-        int lane_number = vehicle->getLanePtr()->getLaneNumber();
-        MPI_Send(&lane_number, 1, MPI_INT, this->getNextRank(), 100, MPI_COMM_WORLD);
-        MPI_Send(vehicle, 1, this->mpi_vehicle, this->getNextRank(), 10, MPI_COMM_WORLD);
+        values.push_back(vehicle->getLanePtr()->getLaneNumber());
+        this->packVehicle(values, vehicle);
+    }
+    if(this->shared_boundary_ptr != nullptr && this->shared_boundary_ptr->put(SLOT_MIGRANTS, values)){
+        return;
+    }
+    if(this->comm_thread_ptr != nullptr){
+        this->comm_thread_ptr->send(this->getNextRank(), 10, std::move(values));
+        return;
+    }
+    MPI_Send(values.data(), values.size(), MPI_INT, this->getNextRank(), 10, MPI_COMM_WORLD);
+    this->migrations_sent++;
+
+    // The Vehicles wake the next process up if it was idle
+    if(size > 0){
+        this->next_idle = false;
     }
 #ifdef DEBUG
     printf("Process: %d, sent %d vehicles to process: %d\n", this->getRank(), size, this->getNextRank());
@@ -126,65 +276,50 @@ void MpiProcess::sendVehicle(std::vector<Vehicle *>& vehicles_to_send){
 
 // receive all the vehicles that are about to cross the theshold
 std::vector<std::vector<Vehicle*>> MpiProcess::receiveVehicle() {
-    int size;
-    MPI_Recv(&size, 1, MPI_INT, this->getPrevRank(), 50, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-    // Create 2 lists for lanes 0 and 1
-    std::vector<std::vector<Vehicle*>> vehicles_to_recv(2);
-
-    if (size > 0) {
-        for (int i = 0; i < size; i++) {
-            int lane_num;
-
-            // Receive the lane number
-            MPI_Recv(&lane_num, 1, MPI_INT, this->getPrevRank(), 100, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MpiProfileSite site("receiveVehicle");
+    // Create a list for each lane
+    std::vector<std::vector<Vehicle*>> vehicles_to_recv(this->num_lanes);
 
-            // Dynamically allocate a Vehicle object
-            Vehicle* vehicle = new Vehicle();
+    // An idle process counts the steps since it last heard of the Vehicles behind it
+    if(this->idle){
+        this->prev_front_age++;
+        this->idle_steps++;
+    }
 
-            // Receive the vehicle data
-            MPI_Recv(vehicle, 1, this->mpi_vehicle, this->getPrevRank(), 10, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    // No Vehicle can reach this process in this step
+    if(this->prev_quiet_steps > 0){
+        this->prev_quiet_steps--;
+        return vehicles_to_recv;
+    }
 
-            // Place the new vehicle in the appropriate list (0 or 1 for lane_num)
-            if (lane_num == 0 || lane_num == 1) {
-                vehicles_to_recv[lane_num].push_back(vehicle);
+    std::vector<int> values;
+    bool shared = this->shared_boundary_ptr != nullptr && this->shared_boundary_ptr->get(SLOT_MIGRANTS, values);
+    if(!shared && this->comm_thread_ptr != nullptr){
+        values = this->comm_thread_ptr->receive(this->getPrevRank(), 10);
+    } else if(!shared){
+        MPI_Status status;
+        int size;
+        MPI_Probe(this->getPrevRank(), 10, MPI_COMM_WORLD, &status);
+        MPI_Get_count(&status, MPI_INT, &size);
+        values.resize(size);
+        MPI_Recv(values.data(), size, MPI_INT, this->getPrevRank(), 10, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    }
+    for(int i = 0; i < (int) values.size(); i += 1 + PACKED_VEHICLE_SIZE){
+        vehicles_to_recv[values[i]].push_back(this->unpackVehicle(&values[i + 1]));
 #ifdef DEBUG
-                printf("Process: %d, received vehicle: %d, speed: %d, position: %d\n", this->getRank(), vehicle->getId(), vehicle->getSpeed(), vehicle->getPosition());
+        printf("Process: %d, received vehicle: %d, position: %d\n", this->getRank(), values[i + 1], values[i + 2]);
 #endif
-            } else {
-                printf("Process: %d Received unexpected lane_num %d\n", this->getRank(),lane_num);
-                delete vehicle; // Clean up the dynamically allocated object
-            }
-        }
     }
-    return vehicles_to_recv;
-}
 
-/**
-* Receive the list of vehicles and check if the new vehicle can be sent without passing
-* over vehicles ahead of it
-* @param vehicles pointer to list of all the Vehicles of curr process
-* @param vehicles_to_send pointer to list of Vehicles to be sent in the next process
-* @param newVehicle pointer to the new vehicle we want to send
-* @return true if the new vehicle can be sent, false otherwise
-*/
-bool MpiProcess::allowSending(std::vector<Vehicle *>& vehicles, std::vector<Vehicle *>& vehicles_to_send, Vehicle *newVehicle){
-    
-    for(int i = 0; i < (int)vehicles.size(); i++){
-        // check for vehicles of the same lane 
-        if(vehicles[i]->getLanePtr()->getLaneNumber() == newVehicle->getLanePtr()->getLaneNumber()){
-            if(vehicles[i]->getPosition() > newVehicle->getPosition() && !vehicles[i]->isInList(vehicles_to_send)){
-#ifdef DEBUG
-               printf("Cannot send %d because %d is ahead of it\n", newVehicle->getId(), vehicles[i]->getId());
-#endif
-               return false;
-            }
-        }
+    // The Vehicles wake this process up if it was idle
+    if(!values.empty()){
+        this->idle = false;
     }
-    return true;
+    return vehicles_to_recv;
 }
 
 Inputs MpiProcess::broadcastConfig(Config &config) {
+    MpiProfileSite site("broadcastConfig");
     Inputs inputs;
     if (this->rank == 0) {
         // Load configuration using the Inputs class
@@ -196,6 +331,7 @@ Inputs MpiProcess::broadcastConfig(Config &config) {
         // Map the loaded inputs to the Config structure
         config.num_lanes           = inputs.num_lanes;
         config.length              = inputs.length;
+        config.percent_full        = inputs.percent_full;
         config.max_speed           = inputs.max_speed;
         config.look_forward        = inputs.look_forward;
         config.look_other_forward  = inputs.look_other_forward;
@@ -205,6 +341,14 @@ Inputs MpiProcess::broadcastConfig(Config &config) {
         config.max_time            = inputs.max_time;
         config.step_size           = inputs.step_size;
         config.warmup_time         = inputs.warmup_time;
+        config.rules               = inputs.rules;
+        config.prob_slow_to_start  = inputs.prob_slow_to_start;
+        config.bin_length          = inputs.bin_length;
+        config.window_length       = inputs.window_length;
+        config.memory_interval     = inputs.memory_interval;
+        config.exchange_interval   = inputs.exchange_interval;
+        config.optimistic_window   = inputs.optimistic_window;
+        config.seed                = inputs.seed;
     }
 
     // Broadcast the configuration to all processes
@@ -214,6 +358,7 @@ Inputs MpiProcess::broadcastConfig(Config &config) {
     if (this->rank != 0) {
         inputs = Inputs(config); 
     }
+    this->num_lanes = inputs.num_lanes;
 
     // Print configuration on all processes
 #ifdef DEBUG
@@ -225,96 +370,696 @@ Inputs MpiProcess::broadcastConfig(Config &config) {
 
 
 /**
-* Receive the last two vehicles (smaller positions) of the next process (one from each lane)
-* @return the vector of index of the last two vehicles
+* Receive the last vehicles (smaller positions) of the next process (one from each lane), which are all -1 while it is
+* idle
+* @return the vector of index of the last vehicles
 */
 std::vector<int> MpiProcess::recvLastVehicles(){
-    
-    std::vector<int> index_last_vehicles(2);
+    MpiProfileSite site("recvLastVehicles");
+    if(this->next_idle){
+        return std::vector<int>(this->num_lanes, -1);
+    }
+    std::vector<int> shared_indices;
+    if(this->shared_boundary_ptr != nullptr && this->shared_boundary_ptr->get(SLOT_LAST_VEHICLES, shared_indices)){
+        return shared_indices;
+    }
+    if(this->comm_thread_ptr != nullptr){
+        return this->comm_thread_ptr->receive(this->getNextRank(), 50);
+    }
+
+    std::vector<int> index_last_vehicles = this->recvChanged(this->last_from_next, this->getNextRank());
 
-    MPI_Recv(index_last_vehicles.data(), 2, MPI_INT, this->getNextRank(), 50, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    // The next process and all the ones beyond it are empty, and stay so until Vehicles reach it
+    if(this->quiet_exchange &&
+       std::count(index_last_vehicles.begin(), index_last_vehicles.end(), -1) == this->num_lanes){
+        this->next_idle = true;
+        this->next_quiet_steps = 0;
+    }
     return index_last_vehicles;
 }
 
 /**
-* Send the last two vehicles to the next process (one from each lane)
-* @param lanes pointer in the two lanes of the road
+* Send the last vehicles to the next process (one from each lane). The process goes idle once they are all -1, and
+* then sends nothing until Vehicles reach it.
+* @param lanes pointer in the lanes of the road
 * @return 
 */
 void MpiProcess::sendLastVehicles(std::vector<Lane*> lanes, std::vector<int> prev_process_indices){
-    std::vector<int> index_last_vehicles = {-1, -1};
-
-    for(int i = 0; i < (int)lanes.size(); i++){
-        std::vector<std::deque<Vehicle *>> sites = lanes[i]->getSites();
-        for(int j = 0; j < (int)sites.size(); j++){
-            if(lanes[i]->hasVehicleInSite(j)){
-                index_last_vehicles[i] = j;
-                break;
-            }
-            // if all the road is crossed and no vehicle is found, 
-            // send the result of the previous process
-            if(j == (int) sites.size() - 1 && prev_process_indices[i] != -1){
-                index_last_vehicles[i] = prev_process_indices[i];
-                break;
-            }
-        }
+    MpiProfileSite site("sendLastVehicles");
+    if(this->idle){
+        return;
+    }
+    std::vector<int> index_last_vehicles = this->findLastVehicles(lanes, prev_process_indices);
+    if(this->shared_boundary_ptr != nullptr && this->shared_boundary_ptr->put(SLOT_LAST_VEHICLES, index_last_vehicles)){
+        return;
+    }
+    if(this->comm_thread_ptr != nullptr){
+        this->comm_thread_ptr->send(this->getPrevRank(), 50, std::move(index_last_vehicles));
+        return;
     }
 
-    MPI_Send(index_last_vehicles.data(), 2, MPI_INT, this->getPrevRank(), 50, MPI_COMM_WORLD);
-#ifdef DEBUG
-    printf("process: %d, my last vehicles are in positions: ", this->getRank());
-    for(int i : index_last_vehicles){
-        printf("%d, ", i);
+    this->sendChanged(index_last_vehicles, this->last_to_prev, this->getPrevRank());
+    if(this->quiet_exchange &&
+       std::count(index_last_vehicles.begin(), index_last_vehicles.end(), -1) == this->num_lanes){
+        this->idle = true;
+        this->prev_quiet_steps = 0;
     }
-    printf("\n");
-#endif
-    return;
 }
 
 /**
-* Receive the first two vehicles (greatest postions) of the prev process (one from each lane)
-* @return the vector of index of the first two vehicles
+* Receive the first vehicles (greatest postions) of the prev process (one from each lane). An idle process only
+* receives a bound on the positions of the Vehicles behind it instead, once the last one has run out.
+* @return the vector of index of the first vehicles, the ones received last while the process is idle
 */
 std::vector<int> MpiProcess::recvFirstVehicles(){
-    
-    std::vector<int> index_first_vehicles(2);
+    MpiProfileSite site("recvFirstVehicles");
+    std::vector<int> shared_indices;
+    if(this->shared_boundary_ptr != nullptr && this->shared_boundary_ptr->get(SLOT_FIRST_VEHICLES, shared_indices)){
+        return shared_indices;
+    }
+    if(this->comm_thread_ptr != nullptr){
+        return this->comm_thread_ptr->receive(this->getPrevRank(), 50);
+    }
+
+    if(this->idle){
+        if(this->prev_quiet_steps == 0){
+            MPI_Recv(&this->prev_front, 1, MPI_INT, this->getPrevRank(), FRONT_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            this->prev_front_age = 0;
+            this->prev_quiet_steps = this->quietSteps(this->prev_front, this->road_start - 1);
+        }
+        return this->first_from_prev;
+    }
 
-    MPI_Recv(index_first_vehicles.data(), 2, MPI_INT, this->getPrevRank(), 50, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    std::vector<int> index_first_vehicles = this->recvChanged(this->first_from_prev, this->getPrevRank());
+    if(this->quiet_exchange){
+        int front = *std::max_element(index_first_vehicles.begin(), index_first_vehicles.end());
+        this->prev_quiet_steps = this->quietSteps(front, this->road_start - 1);
+    }
     return index_first_vehicles;
 }
 
 /**
-* Send the first two vehicles to the next process (one from each lane), or -1 if road is empty
-* @param lanes pointer in the two lanes of the road
+* Send the first vehicles to the next process (one from each lane), or -1 if road is empty. An idle next process only
+* gets a bound on the positions of the Vehicles behind it instead, once the last one has run out.
+* @param lanes pointer in the lanes of the road
 * @return 
 */
 void MpiProcess::sendFirstVehicles(std::vector<Lane*> lanes, std::vector<int> next_process_indices){
-    std::vector<int> index_first_vehicles = {-1, -1};
-
-    for(int i = 0; i < (int)lanes.size(); i++){
-        std::vector<std::deque<Vehicle *>> sites = lanes[i]->getSites();
-        for(int j = (int)sites.size() - 1; j >=0; j--){
-            if(lanes[i]->hasVehicleInSite(j)){
-                index_first_vehicles[i] = j;
-                break;
+    MpiProfileSite site("sendFirstVehicles");
+    std::vector<int> index_first_vehicles = this->findFirstVehicles(lanes, next_process_indices);
+    if(this->shared_boundary_ptr != nullptr && this->shared_boundary_ptr->put(SLOT_FIRST_VEHICLES, index_first_vehicles)){
+        return;
+    }
+    if(this->comm_thread_ptr != nullptr){
+        this->comm_thread_ptr->send(this->getNextRank(), 50, std::move(index_first_vehicles));
+        return;
+    }
+
+    // The first vehicles are the last occupied sites of the Lanes up to the end of this process
+    int front = *std::max_element(index_first_vehicles.begin(), index_first_vehicles.end());
+    if(this->next_idle){
+        if(this->next_quiet_steps > 0){
+            return;
+        }
+
+        // An idle process is empty, so the Vehicles behind it have moved at most max_speed per step since it heard of
+        // them, and have not crossed its start
+        if(this->idle){
+            front = std::min(this->prev_front + this->prev_front_age * this->max_speed, this->road_start - 1);
+        }
+        MPI_Send(&front, 1, MPI_INT, this->getNextRank(), FRONT_TAG, MPI_COMM_WORLD);
+    } else {
+        this->sendChanged(index_first_vehicles, this->first_to_next, this->getNextRank());
+    }
+    if(this->quiet_exchange){
+        this->next_quiet_steps = this->quietSteps(front, this->road_end);
+    }
+}
+
+/**
+* Let the process skip the exchanges that cannot change anything, which are only valid when Vehicles only enter the
+* road at its start. Each migration is skipped when the first vehicles of the previous process are too far behind its
+* end for a Vehicle to cross it in the step, which both processes know. A process goes idle once it and all the ones
+* beyond it are empty. Its previous process then takes its last vehicles as -1 until it sends it Vehicles, and it only
+* receives a bound on the positions of the Vehicles behind it when the last one has run out. Only with boundaries that
+* go through MPI messages.
+* @param max_speed largest number of sites a Vehicle moves in a step
+*/
+void MpiProcess::setQuietExchange(int max_speed){
+    this->quiet_exchange = this->comm_thread_ptr == nullptr && this->shared_boundary_ptr == nullptr &&
+                           this->rma_boundary_ptr == nullptr;
+    this->max_speed = std::max(1, max_speed);
+}
+
+/**
+* Count the steps, starting with the current one, in which no Vehicle can cross the end of a part of the road. A
+* Vehicle crosses it when its position and speed after the move of a step are beyond it, so the Vehicles behind a
+* front need at least two moves to cross.
+* @param front last site of the road that a Vehicle behind the end can be at, or -1 if there are none
+* @param end last site of the part of the road
+* @return number of steps without a Vehicle crossing
+*/
+int MpiProcess::quietSteps(int front, int end){
+    // A Vehicle spawned at the start of the road can be behind any end
+    front = std::max(front, 0);
+    return std::max(0, (end - front) / this->max_speed - 1);
+}
+
+/**
+* Send boundary values to a neighbouring process, or an empty message if they are the ones sent last
+* @param values the values to send
+* @param last_sent the values sent last to the process, updated
+* @param destination rank of the process
+*/
+void MpiProcess::sendChanged(std::vector<int>& values, std::vector<int>& last_sent, int destination){
+    if(values == last_sent){
+        MPI_Send(nullptr, 0, MPI_INT, destination, 50, MPI_COMM_WORLD);
+        this->boundary_repeats++;
+        return;
+    }
+    MPI_Send(values.data(), values.size(), MPI_INT, destination, 50, MPI_COMM_WORLD);
+    last_sent = values;
+    this->boundary_updates++;
+}
+
+/**
+* Receive boundary values from a neighbouring process, where an empty message repeats the ones received last
+* @param last_received the values received last from the process, updated
+* @param source rank of the process
+* @return the values
+*/
+std::vector<int> MpiProcess::recvChanged(std::vector<int>& last_received, int source){
+    MPI_Status status;
+    int size;
+    MPI_Probe(source, 50, MPI_COMM_WORLD, &status);
+    MPI_Get_count(&status, MPI_INT, &size);
+    if(size == 0){
+        MPI_Recv(nullptr, 0, MPI_INT, source, 50, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        return last_received;
+    }
+    last_received.resize(size);
+    MPI_Recv(last_received.data(), size, MPI_INT, source, 50, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    return last_received;
+}
+
+
+
+/**
+* Exchange the entry summaries of the segments of the network with the neighbouring processes
+* @param neighbours ranks of the neighbouring processes
+* @param summaries_to_send the summaries to send to each neighbouring process
+* @param summary_sizes the number of values to receive from each neighbouring process
+* @return the summaries received from each neighbouring process
+*/
+std::map<int, std::vector<int>> MpiProcess::exchangeSegmentSummaries(std::vector<int>& neighbours,
+                                                                     std::map<int, std::vector<int>>& summaries_to_send,
+                                                                     std::map<int, int>& summary_sizes){
+    MpiProfileSite site("exchangeSegmentSummaries");
+    std::map<int, std::vector<int>> summaries_received;
+    std::vector<MPI_Request> requests;
+    long bytes = 0;
+
+    if(this->comm_thread_ptr != nullptr){
+        for(int neighbour : neighbours){
+            bytes += (summaries_to_send[neighbour].size() + summary_sizes[neighbour]) * sizeof(int);
+            this->comm_thread_ptr->send(neighbour, 90, summaries_to_send[neighbour]);
+        }
+        for(int neighbour : neighbours){
+            summaries_received[neighbour] = this->comm_thread_ptr->receive(neighbour, 90);
+            summaries_received[neighbour].resize(summary_sizes[neighbour]);
+        }
+        this->recordBufferBytes(bytes);
+        return summaries_received;
+    }
+
+    for(int neighbour : neighbours){
+        std::vector<int>& received = summaries_received[neighbour];
+        received.resize(summary_sizes[neighbour]);
+        if(!received.empty()){
+            requests.emplace_back();
+            MPI_Irecv(received.data(), received.size(), MPI_INT, neighbour, 90, MPI_COMM_WORLD, &requests.back());
+        }
+    }
+    for(int neighbour : neighbours){
+        std::vector<int>& to_send = summaries_to_send[neighbour];
+        bytes += (to_send.size() + summary_sizes[neighbour]) * sizeof(int);
+        if(!to_send.empty()){
+            requests.emplace_back();
+            MPI_Isend(to_send.data(), to_send.size(), MPI_INT, neighbour, 90, MPI_COMM_WORLD, &requests.back());
+        }
+    }
+
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    this->recordBufferBytes(bytes);
+    return summaries_received;
+}
+
+/**
+* Send the Vehicles crossing junctions into segments of other processes, and receive the Vehicles crossing junctions
+* into the segments of this process. Every neighbouring process gets a count, even if it is zero, followed by the
+* segment and lane of each Vehicle and then the Vehicles themselves.
+* @param neighbours ranks of the neighbouring processes
+* @param transfers the Vehicles to send to each neighbouring process, which are deleted once sent
+* @return the Vehicles received from all the neighbouring processes
+*/
+std::vector<JunctionTransfer> MpiProcess::exchangeJunctionVehicles(std::vector<int>& neighbours,
+                                                                   std::map<int, std::vector<JunctionTransfer>>& transfers){
+    MpiProfileSite site("exchangeJunctionVehicles");
+    if(this->comm_thread_ptr != nullptr){
+        long bytes = 0;
+        for(int neighbour : neighbours){
+            std::vector<int> values;
+            values.reserve(transfers[neighbour].size() * (2 + PACKED_VEHICLE_SIZE));
+            for(JunctionTransfer& transfer : transfers[neighbour]){
+                values.push_back(transfer.segment);
+                values.push_back(transfer.lane);
+                this->packVehicle(values, transfer.vehicle_ptr);
+                delete transfer.vehicle_ptr;
             }
-            // if all the road is crossed and no vehicle is found, 
-            // send the result of the next process
-            if(j == (int) sites.size() - 1 && next_process_indices[i] != -1){
-                index_first_vehicles[i] = next_process_indices[i];
-                break;
+            bytes += values.size() * sizeof(int);
+            this->comm_thread_ptr->send(neighbour, 60, std::move(values));
+        }
+
+        std::vector<JunctionTransfer> received;
+        for(int neighbour : neighbours){
+            std::vector<int> values = this->comm_thread_ptr->receive(neighbour, 60);
+            for(int i = 0; i < (int) values.size(); i += 2 + PACKED_VEHICLE_SIZE){
+                received.push_back({values[i], values[i + 1], this->unpackVehicle(&values[i + 2])});
             }
+            bytes += values.size() * sizeof(int);
+        }
+        this->recordBufferBytes(bytes);
+        transfers.clear();
+        return received;
+    }
+
+    std::vector<MPI_Request> requests;
+    std::map<int, int> counts;
+    std::map<int, std::vector<int>> headers;
+    std::map<int, std::vector<Vehicle>> vehicles;
+
+    // Pack and post the sends to every neighbour
+    for(int neighbour : neighbours){
+        std::vector<JunctionTransfer>& to_send = transfers[neighbour];
+        counts[neighbour] = to_send.size();
+        for(JunctionTransfer& transfer : to_send){
+            headers[neighbour].push_back(transfer.segment);
+            headers[neighbour].push_back(transfer.lane);
+            vehicles[neighbour].push_back(*transfer.vehicle_ptr);
+            delete transfer.vehicle_ptr;
+        }
+
+        requests.emplace_back();
+        MPI_Isend(&counts[neighbour], 1, MPI_INT, neighbour, 60, MPI_COMM_WORLD, &requests.back());
+        if(counts[neighbour] > 0){
+            requests.emplace_back();
+            MPI_Isend(headers[neighbour].data(), 2 * counts[neighbour], MPI_INT, neighbour, 70, MPI_COMM_WORLD,
+                      &requests.back());
+            requests.emplace_back();
+            MPI_Isend(vehicles[neighbour].data(), counts[neighbour], this->mpi_vehicle_array, neighbour, 80,
+                      MPI_COMM_WORLD, &requests.back());
+        }
+    }
+
+    long bytes = 0;
+    for(int neighbour : neighbours){
+        bytes += counts[neighbour] * (2 * sizeof(int) + sizeof(Vehicle));
+    }
+
+    // Receive from every neighbour
+    std::vector<JunctionTransfer> received;
+    for(int neighbour : neighbours){
+        int size;
+        MPI_Recv(&size, 1, MPI_INT, neighbour, 60, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if(size == 0){
+            continue;
+        }
+
+        std::vector<int> header(2 * size);
+        std::vector<Vehicle> vehicles_received(size);
+        MPI_Recv(header.data(), 2 * size, MPI_INT, neighbour, 70, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        MPI_Recv(vehicles_received.data(), size, this->mpi_vehicle_array, neighbour, 80, MPI_COMM_WORLD,
+                 MPI_STATUS_IGNORE);
+        for(int i = 0; i < size; i++){
+            received.push_back({header[2 * i], header[2 * i + 1], new Vehicle(vehicles_received[i])});
+        }
+        bytes += size * (2 * sizeof(int) + sizeof(Vehicle));
+#ifdef DEBUG
+        printf("Process: %d, received %d vehicles from process: %d\n", this->getRank(), size, neighbour);
+#endif
+    }
+
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    this->recordBufferBytes(bytes);
+    transfers.clear();
+    return received;
+}
+
+/**
+* Send copies of Vehicles to the neighbouring processes, and receive the copies of their Vehicles
+* @param to_prev the Vehicles to copy to the previous process
+* @param to_next the Vehicles to copy to the next process
+* @return the copies of the Vehicles of the neighbouring processes, in a list for each Lane
+*/
+std::vector<std::vector<Vehicle *>> MpiProcess::exchangeHalo(std::vector<Vehicle *>& to_prev,
+                                                             std::vector<Vehicle *>& to_next){
+    MpiProfileSite site("exchangeHalo");
+    int neighbours[2] = {this->prev_rank, this->next_rank};
+    std::vector<Vehicle *>* to_send[2] = {&to_prev, &to_next};
+    return this->exchangeVehicles(neighbours, to_send, 120);
+}
+
+/**
+* Exchange the Vehicles that change into a Lane of a neighbouring group of Lanes of the same segment
+* @param to_right the Vehicles that change into the group of the lower Lanes, already removed from the lanes
+* @param to_left the Vehicles that change into the group of the higher Lanes, already removed from the lanes
+* @return the Vehicles that changed into the group of Lanes of the process, in a list for each Lane
+*/
+std::vector<std::vector<Vehicle *>> MpiProcess::exchangeLaneChanges(std::vector<Vehicle *>& to_right,
+                                                                    std::vector<Vehicle *>& to_left){
+    MpiProfileSite site("exchangeLaneChanges");
+    int neighbours[2] = {this->right_rank, this->left_rank};
+    std::vector<Vehicle *>* to_send[2] = {&to_right, &to_left};
+    return this->exchangeVehicles(neighbours, to_send, 130);
+}
+
+/**
+* Exchange the positions of the Vehicles of the edge Lanes of the group of Lanes of the process, with their first and
+* last Vehicles in the neighbouring segments, with the processes of the neighbouring groups of Lanes
+* @param to_right the values for the process with the group of the lower Lanes
+* @param to_left the values for the process with the group of the higher Lanes
+* @return the values from the process to the right and from the process to the left, empty if there is none
+*/
+std::vector<std::vector<int>> MpiProcess::exchangeEdgeLanes(std::vector<int>& to_right, std::vector<int>& to_left){
+    MpiProfileSite site("exchangeEdgeLanes");
+    int neighbours[2] = {this->right_rank, this->left_rank};
+    std::vector<int>* to_send[2] = {&to_right, &to_left};
+    std::vector<MPI_Request> requests;
+    long bytes = 0;
+    for(int i = 0; i < 2; i++){
+        if(neighbours[i] < 0){
+            continue;
+        }
+        bytes += to_send[i]->size() * sizeof(int);
+        requests.emplace_back();
+        MPI_Isend(to_send[i]->data(), to_send[i]->size(), MPI_INT, neighbours[i], 140, MPI_COMM_WORLD,
+                  &requests.back());
+    }
+
+    std::vector<std::vector<int>> received(2);
+    for(int i = 0; i < 2; i++){
+        if(neighbours[i] < 0){
+            continue;
+        }
+        MPI_Status status;
+        int size;
+        MPI_Probe(neighbours[i], 140, MPI_COMM_WORLD, &status);
+        MPI_Get_count(&status, MPI_INT, &size);
+        received[i].resize(size);
+        MPI_Recv(received[i].data(), size, MPI_INT, neighbours[i], 140, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        bytes += size * sizeof(int);
+    }
+
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    this->recordBufferBytes(bytes);
+    return received;
+}
+
+/**
+* Exchange copies of Vehicles with two neighbouring processes, packed with their Lanes
+* @param neighbours ranks of the neighbouring processes, or -1
+* @param to_send the Vehicles for each neighbouring process
+* @param tag tag of the messages
+* @return the Vehicles received from the neighbouring processes, in a list for each Lane
+*/
+std::vector<std::vector<Vehicle *>> MpiProcess::exchangeVehicles(int neighbours[2], std::vector<Vehicle *>* to_send[2],
+                                                                 int tag){
+    std::vector<int> packed[2];
+    std::vector<MPI_Request> requests;
+    long bytes = 0;
+
+    for(int i = 0; i < 2; i++){
+        if(neighbours[i] < 0){
+            continue;
+        }
+        for(Vehicle* vehicle : *to_send[i]){
+            packed[i].push_back(vehicle->getLanePtr()->getLaneNumber());
+            this->packVehicle(packed[i], vehicle);
+        }
+        bytes += packed[i].size() * sizeof(int);
+        requests.emplace_back();
+        MPI_Isend(packed[i].data(), packed[i].size(), MPI_INT, neighbours[i], tag, MPI_COMM_WORLD, &requests.back());
+    }
+
+    std::vector<std::vector<Vehicle*>> vehicles_to_recv(this->num_lanes);
+    for(int n = 0; n < 2; n++){
+        int neighbour = neighbours[n];
+        if(neighbour < 0){
+            continue;
+        }
+        MPI_Status status;
+        int size;
+        MPI_Probe(neighbour, tag, MPI_COMM_WORLD, &status);
+        MPI_Get_count(&status, MPI_INT, &size);
+        std::vector<int> values(size);
+        MPI_Recv(values.data(), size, MPI_INT, neighbour, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        for(int i = 0; i < size; i += 1 + PACKED_VEHICLE_SIZE){
+            vehicles_to_recv[values[i]].push_back(this->unpackVehicle(&values[i + 1]));
+        }
+        bytes += size * sizeof(int);
+    }
+
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    this->recordBufferBytes(bytes);
+    return vehicles_to_recv;
+}
+
+/**
+* Send the tails of the Lanes of this process to the next process, and receive the tails of the previous process
+* @param tails a value for each Lane of the road, for the next process
+* @return the values of the previous process, or none if this is the first process
+*/
+std::vector<int> MpiProcess::exchangeTails(std::vector<int>& tails){
+    MpiProfileSite site("exchangeTails");
+    MPI_Request request = MPI_REQUEST_NULL;
+    if(this->getNextRank() != -1){
+        MPI_Isend(tails.data(), tails.size(), MPI_INT, this->getNextRank(), TAIL_TAG, MPI_COMM_WORLD, &request);
+    }
+    std::vector<int> prev_tails;
+    if(this->getPrevRank() != -1){
+        prev_tails.resize(tails.size());
+        MPI_Recv(prev_tails.data(), prev_tails.size(), MPI_INT, this->getPrevRank(), TAIL_TAG, MPI_COMM_WORLD,
+                 MPI_STATUS_IGNORE);
+    }
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+    this->recordBufferBytes((tails.size() + prev_tails.size()) * sizeof(int));
+    return prev_tails;
+}
+
+/**
+* Send the data of a step to a neighbouring process that runs ahead optimistically, without waiting for it to be
+* received. The buffers are kept until the sends complete.
+* @param destination rank of the neighbouring process
+* @param message the message
+*/
+void MpiProcess::sendOptimistic(int destination, OptimisticMessage& message){
+    MpiProfileSite site("sendOptimistic");
+    while(!this->optimistic_requests.empty()){
+        int done;
+        MPI_Test(&this->optimistic_requests.front(), &done, MPI_STATUS_IGNORE);
+        if(!done){
+            break;
         }
+        this->optimistic_requests.pop_front();
+        this->optimistic_buffers.pop_front();
+    }
+
+    std::vector<int> values = {message.step, (int) message.boundary.size()};
+    values.reserve(values.size() + message.boundary.size() + message.migrants.size() * (1 + PACKED_VEHICLE_SIZE));
+    values.insert(values.end(), message.boundary.begin(), message.boundary.end());
+    for(int i = 0; i < (int) message.migrants.size(); i++){
+        values.push_back(message.migrant_lanes[i]);
+        this->packVehicle(values, &message.migrants[i]);
+    }
+    this->recordBufferBytes(values.size() * sizeof(int));
+
+    this->optimistic_buffers.push_back(std::move(values));
+    this->optimistic_requests.push_back(MPI_REQUEST_NULL);
+    std::vector<int>& buffer = this->optimistic_buffers.back();
+    MPI_Isend(buffer.data(), buffer.size(), MPI_INT, destination, OPTIMISTIC_TAG, MPI_COMM_WORLD,
+              &this->optimistic_requests.back());
+}
+
+/**
+* Receive the next message of a neighbouring process that runs ahead optimistically, from either neighbour, if one has
+* arrived
+* @param message the message to fill
+* @return true if a message was received, false otherwise
+*/
+bool MpiProcess::receiveOptimistic(OptimisticMessage& message){
+    MpiProfileSite site("receiveOptimistic");
+    MPI_Status status;
+    int arrived;
+    MPI_Iprobe(MPI_ANY_SOURCE, OPTIMISTIC_TAG, MPI_COMM_WORLD, &arrived, &status);
+    if(!arrived){
+        return false;
+    }
+    int size;
+    MPI_Get_count(&status, MPI_INT, &size);
+    std::vector<int> values(size);
+    MPI_Recv(values.data(), size, MPI_INT, status.MPI_SOURCE, OPTIMISTIC_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    this->recordBufferBytes(size * sizeof(int));
+
+    message.source = status.MPI_SOURCE;
+    message.step = values[0];
+    int num_boundary = values[1];
+    message.boundary.assign(values.begin() + 2, values.begin() + 2 + num_boundary);
+    message.migrant_lanes.clear();
+    message.migrants.clear();
+    for(int i = 2 + num_boundary; i < size; i += 1 + PACKED_VEHICLE_SIZE){
+        message.migrant_lanes.push_back(values[i]);
+        Vehicle* vehicle = this->unpackVehicle(&values[i + 1]);
+        message.migrants.push_back(*vehicle);
+        delete vehicle;
+    }
+    return true;
+}
+
+/**
+* Sum values over all the processes
+* @param values the values of this process
+* @return the sums of the values of all processes, valid only on process 0
+*/
+std::vector<double> MpiProcess::reduceSum(std::vector<double> values){
+    MpiProfileSite site("reduceSum");
+    this->recordBufferBytes(2 * values.size() * sizeof(double));
+    std::vector<double> sums(values.size(), 0.0);
+    MPI_Reduce(values.data(), sums.data(), values.size(), MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    return sums;
+}
+
+/**
+* Take the maximum of values over all the processes
+* @param values the values of this process
+* @return the maximums of the values of all processes, valid only on process 0
+*/
+std::vector<double> MpiProcess::reduceMax(std::vector<double> values){
+    MpiProfileSite site("reduceMax");
+    std::vector<double> maximums(values.size(), 0.0);
+    MPI_Reduce(values.data(), maximums.data(), values.size(), MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    return maximums;
+}
+
+/**
+* Sum values over all the processes, on all the processes
+* @param values the values of this process
+* @return the sums of the values of all processes
+*/
+std::vector<double> MpiProcess::allReduceSum(std::vector<double> values){
+    MpiProfileSite site("allReduceSum");
+    std::vector<double> sums(values.size(), 0.0);
+    MPI_Allreduce(values.data(), sums.data(), values.size(), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    return sums;
+}
+
+/**
+* Take the maximum of values over all the processes, on all the processes
+* @param values the values of this process
+* @return the maximums of the values of all processes
+*/
+std::vector<double> MpiProcess::allReduceMax(std::vector<double> values){
+    MpiProfileSite site("allReduceMax");
+    std::vector<double> maximums(values.size(), 0.0);
+    MPI_Allreduce(values.data(), maximums.data(), values.size(), MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    return maximums;
+}
+
+/**
+* Gather values of different lengths from all the processes
+* @param values the values of this process
+* @return the values of all processes one after the other, in the order of the ranks, valid only on process 0
+*/
+std::vector<double> MpiProcess::gather(std::vector<double> values){
+    MpiProfileSite site("gather");
+    int length = values.size();
+    std::vector<int> lengths(this->rank == 0 ? this->num_of_processes : 0);
+    MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    std::vector<int> offsets(lengths.size(), 0);
+    for(int i = 1; i < (int) lengths.size(); i++){
+        offsets[i] = offsets[i - 1] + lengths[i - 1];
     }
+    std::vector<double> all_values(this->rank == 0 ? offsets.back() + lengths.back() : 0);
+    MPI_Gatherv(values.data(), length, MPI_DOUBLE, all_values.data(), lengths.data(), offsets.data(), MPI_DOUBLE, 0,
+                MPI_COMM_WORLD);
+    this->recordBufferBytes((values.size() + all_values.size()) * sizeof(double));
+    return all_values;
+}
 
-    MPI_Send(index_first_vehicles.data(), 2, MPI_INT, this->getNextRank(), 50, MPI_COMM_WORLD);
-#ifdef DEBUG    
-    printf("process: %d, my first vehicles are in positions: ", this->getRank());
-    for(int i : index_first_vehicles){
-        printf("%d, ", i);
+/**
+* Write the metrics of the communication thread to the performance report, if there is one, and the boundaries and
+* migrations that were sent and skipped
+* @param report the performance report
+*/
+void MpiProcess::reportCommunication(std::ostream& report){
+    if(this->comm_thread_ptr != nullptr){
+        this->comm_thread_ptr->report(report, this->rank);
+    }
+    if(this->boundary_updates + this->boundary_repeats + this->migrations_sent + this->migrations_skipped > 0){
+        report << "Process : " << this->rank << " boundary messages: " << this->boundary_updates << " changed, "
+               << this->boundary_repeats << " unchanged, migrations: " << this->migrations_sent << " sent, "
+               << this->migrations_skipped << " skipped, idle steps: " << this->idle_steps << std::endl;
     }
-    printf("\n");
-#endif    
-    return;
 }
 
+/**
+* Check whether the boundaries and the migrating Vehicles of a road go through the one-sided transport
+* @return true with "-rma" on the command line, false otherwise
+*/
+bool MpiProcess::isOneSided(){
+    return this->rma_boundary_ptr != nullptr;
+}
+
+/**
+* Exchange the boundaries and the migrating Vehicles of a road with the neighbouring processes through the one-sided
+* transport. The boundaries deposited for the previous process do not have the Vehicles that it sends in the same
+* step, so it adds them to the last vehicles itself. An empty lane gives the boundary of the last step instead of the
+* one of the process beyond it.
+* @param lanes pointer in the lanes of the road
+* @param migrants the Vehicles that move to the next process, already removed from the lanes
+* @param first_vehicles the first vehicles of the previous process, replaced with the ones of this step
+* @param last_vehicles the last vehicles of the next process, replaced with the ones of this step
+* @return the Vehicles that moved from the previous process, in a list for each Lane
+*/
+std::vector<std::vector<Vehicle *>> MpiProcess::exchangeOneSided(std::vector<Lane*> lanes, std::vector<Vehicle*>& migrants,
+                                                                 std::vector<int>& first_vehicles,
+                                                                 std::vector<int>& last_vehicles){
+    MpiProfileSite site("exchangeOneSided");
+    std::vector<int> first_to_next = this->findFirstVehicles(lanes, first_vehicles);
+    std::vector<int> last_to_prev = this->findLastVehicles(lanes, last_vehicles);
+    std::vector<int> migrants_to_next;
+    for(Vehicle* vehicle : migrants){
+        migrants_to_next.push_back(vehicle->getLanePtr()->getLaneNumber());
+        this->packVehicle(migrants_to_next, vehicle);
+    }
+    this->recordBufferBytes((2 * this->num_lanes + migrants_to_next.size()) * sizeof(int));
+
+    std::vector<int> migrants_from_prev;
+    this->rma_boundary_ptr->exchange(first_to_next, last_to_prev, migrants_to_next, first_vehicles, last_vehicles,
+                                     migrants_from_prev);
+
+    // The Vehicles sent in this step are the last vehicles of the next process where they are behind its own
+    if(this->next_rank >= 0){
+        for(Vehicle* vehicle : migrants){
+            int lane_num = vehicle->getLanePtr()->getLaneNumber();
+            if(last_vehicles[lane_num] == -1 || vehicle->getPosition() < last_vehicles[lane_num]){
+                last_vehicles[lane_num] = vehicle->getPosition();
+            }
+        }
+    }
+
+    std::vector<std::vector<Vehicle*>> vehicles_to_recv(this->num_lanes);
+    for(int i = 0; i < (int) migrants_from_prev.size(); i += 1 + PACKED_VEHICLE_SIZE){
+        vehicles_to_recv[migrants_from_prev[i]].push_back(this->unpackVehicle(&migrants_from_prev[i + 1]));
+    }
+    return vehicles_to_recv;
+}
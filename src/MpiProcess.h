@@ -3,45 +3,108 @@
 
 #include <mpi.h>
 #include <stdio.h>
+#include <map>
+#include <deque>
 
 #include "Inputs.h"
 #include "Vehicle.h"
+#include "Process.h"
+#include "CommThread.h"
+#include "SharedBoundary.h"
+#include "RmaBoundary.h"
 
 using namespace std;
 
-class MpiProcess{
+/**
+ * Process of the simulation that is an MPI rank and exchanges the boundary data with messages. With "-comm-thread" on
+ * the command line, the messages with the neighbouring ranks go through a CommThread instead of blocking calls. With
+ * "-shm", the boundaries and the migrating Vehicles of a road go through a SharedBoundary between ranks on a node. With
+ * "-rma", they go through the one-sided transport of a RmaBoundary instead. With "-mpi-profile", the MPI calls are
+ * recorded by the MpiProfiler, with the method that made them as the call site. A single road is divided over a
+ * Cartesian grid of segments and groups of Lanes, with the number of groups given with "-lane-groups N" or chosen from
+ * the shape of the road otherwise. The boundaries are only sent when they change, and the migrating Vehicles only in
+ * the steps in which a Vehicle can reach the next rank.
+ */
+class MpiProcess : public Process {
     private:
-        int rank;
-        int next_rank;
-        int prev_rank;
-        int num_of_processes;
+        CommThread* comm_thread_ptr;
+        SharedBoundary* shared_boundary_ptr;
+        bool use_shared_boundary;
+        RmaBoundary* rma_boundary_ptr;
+        bool use_rma_boundary;
+        int requested_lane_groups;
+        MPI_Comm cart_comm;
 
-        int road_start;
-        int road_end;
+        // State of the exchanges that are skipped when nothing can change, see setQuietExchange
+        bool quiet_exchange;
+        int max_speed;
+        bool idle;
+        bool next_idle;
+        int prev_quiet_steps;
+        int next_quiet_steps;
+        int prev_front;
+        int prev_front_age;
+        std::vector<int> last_to_prev;
+        std::vector<int> last_from_next;
+        std::vector<int> first_to_next;
+        std::vector<int> first_from_prev;
+        long boundary_updates;
+        long boundary_repeats;
+        long migrations_sent;
+        long migrations_skipped;
+        long idle_steps;
 
+        // Buffers of the optimistic messages that are still being sent, see sendOptimistic
+        std::deque<std::vector<int>> optimistic_buffers;
+        std::deque<MPI_Request> optimistic_requests;
 
+        void packVehicle(std::vector<int>& values, Vehicle* vehicle);
+        Vehicle* unpackVehicle(const int* values);
+        int quietSteps(int front, int end);
+        void sendChanged(std::vector<int>& values, std::vector<int>& last_sent, int destination);
+        std::vector<int> recvChanged(std::vector<int>& last_received, int source);
+        std::vector<std::vector<Vehicle *>> exchangeVehicles(int neighbours[2], std::vector<Vehicle *>* to_send[2],
+                                                             int tag);
     public:
         MpiProcess(int argc, char** argv);
         ~MpiProcess();
 
         MPI_Datatype mpi_vehicle;
-        int getRank();
-        int getNextRank();
-        int getPrevRank();
-        int getNumOfProcesses();
-        int getStartPosition();
-        int getEndPosition();
+        MPI_Datatype mpi_vehicle_array;
 
         void defineMpiVehicle();
-        Inputs broadcastConfig(Config &config);
-        void divideRoad(int road_length);
-        void sendVehicle(std::vector<Vehicle *>& vehicles);
-        std::vector<std::vector<Vehicle *>> receiveVehicle();
-        bool allowSending(std::vector<Vehicle *>& vehicles, std::vector<Vehicle *>& vehicles_to_send, Vehicle *newVehicle);
-        std::vector<int> recvLastVehicles();
-        void sendLastVehicles(std::vector<Lane*> lanes, std::vector<int> prev_process_indices);
-        std::vector<int> recvFirstVehicles();
-        void sendFirstVehicles(std::vector<Lane*> lanes, std::vector<int> next_process_indices);
+        Inputs broadcastConfig(Config &config) override;
+        void divideRoad(Inputs inputs) override;
+        void sendVehicle(std::vector<Vehicle *>& vehicles) override;
+        std::vector<std::vector<Vehicle *>> receiveVehicle() override;
+        std::vector<int> recvLastVehicles() override;
+        void sendLastVehicles(std::vector<Lane*> lanes, std::vector<int> prev_process_indices) override;
+        std::vector<int> recvFirstVehicles() override;
+        void sendFirstVehicles(std::vector<Lane*> lanes, std::vector<int> next_process_indices) override;
+        std::map<int, std::vector<int>> exchangeSegmentSummaries(std::vector<int>& neighbours,
+                                                                 std::map<int, std::vector<int>>& summaries_to_send,
+                                                                 std::map<int, int>& summary_sizes) override;
+        std::vector<JunctionTransfer> exchangeJunctionVehicles(std::vector<int>& neighbours,
+                                                               std::map<int, std::vector<JunctionTransfer>>& transfers) override;
+        std::vector<std::vector<Vehicle *>> exchangeHalo(std::vector<Vehicle *>& to_prev,
+                                                         std::vector<Vehicle *>& to_next) override;
+        std::vector<std::vector<int>> exchangeEdgeLanes(std::vector<int>& to_right, std::vector<int>& to_left) override;
+        std::vector<std::vector<Vehicle *>> exchangeLaneChanges(std::vector<Vehicle *>& to_right,
+                                                                std::vector<Vehicle *>& to_left) override;
+        std::vector<int> exchangeTails(std::vector<int>& tails) override;
+        std::vector<double> reduceSum(std::vector<double> values) override;
+        std::vector<double> reduceMax(std::vector<double> values) override;
+        std::vector<double> allReduceSum(std::vector<double> values) override;
+        std::vector<double> allReduceMax(std::vector<double> values) override;
+        std::vector<double> gather(std::vector<double> values) override;
+        void sendOptimistic(int destination, OptimisticMessage& message) override;
+        bool receiveOptimistic(OptimisticMessage& message) override;
+        void reportCommunication(std::ostream& report) override;
+        void setQuietExchange(int max_speed) override;
+        bool isOneSided() override;
+        std::vector<std::vector<Vehicle *>> exchangeOneSided(std::vector<Lane*> lanes, std::vector<Vehicle*>& migrants,
+                                                             std::vector<int>& first_vehicles,
+                                                             std::vector<int>& last_vehicles) override;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,396 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+#include "MpiProfiler.h"
+#include "MemoryReport.h"
+
+/**
+ * Structure for the figures of a call site, call and tag
+ */
+struct ProfileEntry {
+    long calls = 0;
+    long bytes = 0;
+    double seconds = 0.0;
+    double max_seconds = 0.0;
+};
+
+// Figures of each call site, call and tag
+typedef std::map<std::tuple<std::string, std::string, int>, ProfileEntry> ProfileTable;
+
+// Whether the calls are recorded, and since when
+static std::atomic<bool> profiler_running(false);
+static std::chrono::steady_clock::time_point profiler_start;
+
+// Tables of all the threads that made MPI calls, which outlive their threads until the report
+static std::mutex tables_mutex;
+static std::vector<ProfileTable*> thread_tables;
+
+// Table and call site of the current thread
+static thread_local ProfileTable* thread_table = nullptr;
+static thread_local const char* thread_site = "other";
+
+/**
+ * Records an MPI call of the current thread
+ * @param call name of the MPI call
+ * @param tag tag of the message, or -1 if the call has none
+ * @param bytes number of bytes of the message
+ * @param begin time at which the call was made
+ */
+static void recordCall(const char* call, int tag, long bytes, std::chrono::steady_clock::time_point begin) {
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    if (thread_table == nullptr) {
+        std::lock_guard<std::mutex> lock(tables_mutex);
+        thread_table = new ProfileTable();
+        thread_tables.push_back(thread_table);
+    }
+    ProfileEntry& entry = (*thread_table)[std::make_tuple(std::string(thread_site), std::string(call), tag)];
+    entry.calls++;
+    entry.bytes += bytes;
+    entry.seconds += seconds;
+}
+
+/**
+ * Computes the number of bytes of a message
+ * @param count number of elements of the message
+ * @param datatype datatype of the elements
+ * @return the number of bytes
+ */
+static long messageBytes(int count, MPI_Datatype datatype) {
+    int size;
+    PMPI_Type_size(datatype, &size);
+    return (long) count * size;
+}
+
+/**
+ * Starts recording the MPI calls of all the threads
+ */
+void MpiProfiler::start() {
+    profiler_start = std::chrono::steady_clock::now();
+    profiler_running = true;
+}
+
+/**
+ * Writes a table of figures, ordered by the time spent in the calls
+ * @param report the stream to write to
+ * @param table the table
+ * @param elapsed time over which the calls were recorded, for the share of each row
+ * @param with_max whether to write the longest time of a rank for each row
+ */
+static void writeTable(std::ostream& report, ProfileTable& table, double elapsed, bool with_max) {
+    std::vector<ProfileTable::iterator> rows;
+    for (ProfileTable::iterator it = table.begin(); it != table.end(); it++) {
+        rows.push_back(it);
+    }
+    std::sort(rows.begin(), rows.end(), [](ProfileTable::iterator a, ProfileTable::iterator b) {
+        return a->second.seconds > b->second.seconds;
+    });
+
+    report << std::left << std::setw(26) << "site" << std::setw(18) << "call" << std::right << std::setw(5) << "tag"
+           << std::setw(12) << "calls" << std::setw(14) << "bytes" << std::setw(12) << "time [s]" << std::setw(9)
+           << "share";
+    if (with_max) {
+        report << std::setw(12) << "max [s]";
+    }
+    report << std::endl;
+    for (ProfileTable::iterator row : rows) {
+        int tag = std::get<2>(row->first);
+        report << std::left << std::setw(26) << std::get<0>(row->first) << std::setw(18) << std::get<1>(row->first)
+               << std::right << std::setw(5) << (tag < 0 ? "-" : std::to_string(tag)) << std::setw(12)
+               << row->second.calls << std::setw(14) << formatBytes(row->second.bytes) << std::setw(12) << std::fixed
+               << std::setprecision(6) << row->second.seconds << std::setw(8) << std::setprecision(1)
+               << 100.0 * row->second.seconds / elapsed << "%";
+        if (with_max) {
+            report << std::setw(12) << std::setprecision(6) << row->second.max_seconds;
+        }
+        report << std::defaultfloat << std::setprecision(6) << std::endl;
+    }
+}
+
+/**
+ * Stops recording, gathers the tables of all the ranks on rank 0, and prints the table of each rank and the totals
+ * over the ranks, with the time of each row as a share of the recorded time of its rank. Must be called by all the
+ * ranks, once the threads that make MPI calls have finished.
+ */
+void MpiProfiler::report() {
+    if (!profiler_running) {
+        return;
+    }
+    profiler_running = false;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - profiler_start).count();
+
+    // Combine the tables of the threads of the rank, and write them out to gather them
+    ProfileTable merged;
+    for (ProfileTable* table : thread_tables) {
+        for (auto& row : *table) {
+            ProfileEntry& entry = merged[row.first];
+            entry.calls += row.second.calls;
+            entry.bytes += row.second.bytes;
+            entry.seconds += row.second.seconds;
+        }
+        delete table;
+    }
+    thread_tables.clear();
+    thread_table = nullptr;
+
+    std::ostringstream rows;
+    rows << elapsed << "\n";
+    for (auto& row : merged) {
+        rows << std::get<0>(row.first) << "\t" << std::get<1>(row.first) << "\t" << std::get<2>(row.first) << "\t"
+             << row.second.calls << "\t" << row.second.bytes << "\t" << row.second.seconds << "\n";
+    }
+    std::string text = rows.str();
+
+    int rank, num_ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+    int length = text.size();
+    std::vector<int> lengths(num_ranks);
+    MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    std::vector<int> offsets(num_ranks, 0);
+    for (int i = 1; i < num_ranks; i++) {
+        offsets[i] = offsets[i - 1] + lengths[i - 1];
+    }
+    std::vector<char> all_text(rank == 0 ? offsets.back() + lengths.back() : 0);
+    MPI_Gatherv(text.data(), length, MPI_CHAR, all_text.data(), lengths.data(), offsets.data(), MPI_CHAR, 0,
+                MPI_COMM_WORLD);
+    if (rank != 0) {
+        return;
+    }
+
+    // Print the table of each rank, and add it to the totals
+    std::ostringstream report;
+    ProfileTable totals;
+    double total_elapsed = 0.0;
+    report << "--- MPI Profile ---" << std::endl;
+    for (int i = 0; i < num_ranks; i++) {
+        std::istringstream stream(std::string(all_text.data() + offsets[i], lengths[i]));
+        double rank_elapsed;
+        stream >> rank_elapsed;
+        stream.ignore();
+        total_elapsed += rank_elapsed;
+
+        ProfileTable table;
+        double rank_seconds = 0.0;
+        std::string site, call, tag, calls, bytes, seconds;
+        while (std::getline(stream, site, '\t') && std::getline(stream, call, '\t') &&
+               std::getline(stream, tag, '\t') && std::getline(stream, calls, '\t') &&
+               std::getline(stream, bytes, '\t') && std::getline(stream, seconds)) {
+            auto key = std::make_tuple(site, call, std::stoi(tag));
+            ProfileEntry& entry = table[key];
+            entry.calls = std::stol(calls);
+            entry.bytes = std::stol(bytes);
+            entry.seconds = std::stod(seconds);
+            rank_seconds += entry.seconds;
+
+            ProfileEntry& total = totals[key];
+            total.calls += entry.calls;
+            total.bytes += entry.bytes;
+            total.seconds += entry.seconds;
+            total.max_seconds = std::max(total.max_seconds, entry.seconds);
+        }
+
+        report << "Process : " << i << " time in MPI: " << rank_seconds << " [s] of " << rank_elapsed << " [s]"
+               << std::endl;
+        writeTable(report, table, rank_elapsed, false);
+    }
+    report << "All processes:" << std::endl;
+    writeTable(report, totals, total_elapsed, true);
+    std::cout << report.str();
+}
+
+/**
+ * Constructor for the MpiProfileSite, which names the call site of the current thread
+ * @param site name of the call site
+ */
+MpiProfileSite::MpiProfileSite(const char* site) {
+    this->previous = thread_site;
+    thread_site = site;
+}
+
+/**
+ * Destructor for the MpiProfileSite, which restores the call site of the enclosing scope
+ */
+MpiProfileSite::~MpiProfileSite() {
+    thread_site = this->previous;
+}
+
+// Interposed MPI calls, which forward to the PMPI interface and record the call if the profiler is running
+
+int MPI_Send(const void* buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm) {
+    if (!profiler_running) {
+        return PMPI_Send(buf, count, datatype, dest, tag, comm);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Send(buf, count, datatype, dest, tag, comm);
+    recordCall("MPI_Send", tag, messageBytes(count, datatype), begin);
+    return result;
+}
+
+int MPI_Recv(void* buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm, MPI_Status* status) {
+    if (!profiler_running) {
+        return PMPI_Recv(buf, count, datatype, source, tag, comm, status);
+    }
+    MPI_Status own_status;
+    if (status == MPI_STATUS_IGNORE) {
+        status = &own_status;
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Recv(buf, count, datatype, source, tag, comm, status);
+    int received;
+    PMPI_Get_count(status, datatype, &received);
+    recordCall("MPI_Recv", status->MPI_TAG, messageBytes(received, datatype), begin);
+    return result;
+}
+
+int MPI_Isend(const void* buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm,
+              MPI_Request* request) {
+    if (!profiler_running) {
+        return PMPI_Isend(buf, count, datatype, dest, tag, comm, request);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Isend(buf, count, datatype, dest, tag, comm, request);
+    recordCall("MPI_Isend", tag, messageBytes(count, datatype), begin);
+    return result;
+}
+
+int MPI_Irecv(void* buf, int count, MPI_Datatype datatype, int source, int tag, MPI_Comm comm,
+              MPI_Request* request) {
+    if (!profiler_running) {
+        return PMPI_Irecv(buf, count, datatype, source, tag, comm, request);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Irecv(buf, count, datatype, source, tag, comm, request);
+    recordCall("MPI_Irecv", tag, messageBytes(count, datatype), begin);
+    return result;
+}
+
+int MPI_Probe(int source, int tag, MPI_Comm comm, MPI_Status* status) {
+    if (!profiler_running) {
+        return PMPI_Probe(source, tag, comm, status);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Probe(source, tag, comm, status);
+    recordCall("MPI_Probe", tag, 0, begin);
+    return result;
+}
+
+int MPI_Wait(MPI_Request* request, MPI_Status* status) {
+    if (!profiler_running) {
+        return PMPI_Wait(request, status);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Wait(request, status);
+    recordCall("MPI_Wait", -1, 0, begin);
+    return result;
+}
+
+int MPI_Waitall(int count, MPI_Request array_of_requests[], MPI_Status array_of_statuses[]) {
+    if (!profiler_running) {
+        return PMPI_Waitall(count, array_of_requests, array_of_statuses);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Waitall(count, array_of_requests, array_of_statuses);
+    recordCall("MPI_Waitall", -1, 0, begin);
+    return result;
+}
+
+int MPI_Bcast(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm) {
+    if (!profiler_running) {
+        return PMPI_Bcast(buffer, count, datatype, root, comm);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Bcast(buffer, count, datatype, root, comm);
+    recordCall("MPI_Bcast", -1, messageBytes(count, datatype), begin);
+    return result;
+}
+
+int MPI_Reduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root,
+               MPI_Comm comm) {
+    if (!profiler_running) {
+        return PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm);
+    recordCall("MPI_Reduce", -1, messageBytes(count, datatype), begin);
+    return result;
+}
+
+int MPI_Barrier(MPI_Comm comm) {
+    if (!profiler_running) {
+        return PMPI_Barrier(comm);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Barrier(comm);
+    recordCall("MPI_Barrier", -1, 0, begin);
+    return result;
+}
+
+int MPI_Put(const void* origin_addr, int origin_count, MPI_Datatype origin_datatype, int target_rank,
+            MPI_Aint target_disp, int target_count, MPI_Datatype target_datatype, MPI_Win win) {
+    if (!profiler_running) {
+        return PMPI_Put(origin_addr, origin_count, origin_datatype, target_rank, target_disp, target_count,
+                        target_datatype, win);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Put(origin_addr, origin_count, origin_datatype, target_rank, target_disp, target_count,
+                          target_datatype, win);
+    recordCall("MPI_Put", -1, messageBytes(origin_count, origin_datatype), begin);
+    return result;
+}
+
+int MPI_Accumulate(const void* origin_addr, int origin_count, MPI_Datatype origin_datatype, int target_rank,
+                   MPI_Aint target_disp, int target_count, MPI_Datatype target_datatype, MPI_Op op, MPI_Win win) {
+    if (!profiler_running) {
+        return PMPI_Accumulate(origin_addr, origin_count, origin_datatype, target_rank, target_disp, target_count,
+                               target_datatype, op, win);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Accumulate(origin_addr, origin_count, origin_datatype, target_rank, target_disp, target_count,
+                                 target_datatype, op, win);
+    recordCall("MPI_Accumulate", -1, messageBytes(origin_count, origin_datatype), begin);
+    return result;
+}
+
+int MPI_Fetch_and_op(const void* origin_addr, void* result_addr, MPI_Datatype datatype, int target_rank,
+                     MPI_Aint target_disp, MPI_Op op, MPI_Win win) {
+    if (!profiler_running) {
+        return PMPI_Fetch_and_op(origin_addr, result_addr, datatype, target_rank, target_disp, op, win);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Fetch_and_op(origin_addr, result_addr, datatype, target_rank, target_disp, op, win);
+    recordCall("MPI_Fetch_and_op", -1, messageBytes(1, datatype), begin);
+    return result;
+}
+
+int MPI_Win_flush(int rank, MPI_Win win) {
+    if (!profiler_running) {
+        return PMPI_Win_flush(rank, win);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Win_flush(rank, win);
+    recordCall("MPI_Win_flush", -1, 0, begin);
+    return result;
+}
+
+int MPI_Win_flush_all(MPI_Win win) {
+    if (!profiler_running) {
+        return PMPI_Win_flush_all(win);
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    int result = PMPI_Win_flush_all(win);
+    recordCall("MPI_Win_flush_all", -1, 0, begin);
+    return result;
+}
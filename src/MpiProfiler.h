@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_MPIPROFILER_H
+#define CA_TRAFFIC_SIMULATION_MPIPROFILER_H
+
+#include <mpi.h>
+
+/**
+ * Class for the profiler of the MPI communication of cats. The profiler interposes the point-to-point, collective and
+ * one-sided calls of MPI through the PMPI interface, and records the number of calls, the bytes and the time spent in
+ * the calls for each call site, call and tag, separately for each thread. The call site is the method of the process
+ * that is running, set with an MpiProfileSite. The tables of all the ranks are printed at the end, with their totals.
+ */
+class MpiProfiler {
+public:
+    static void start();
+    static void report();
+};
+
+/**
+ * Structure that names the call site of the MPI calls of the current thread while it is in scope
+ */
+struct MpiProfileSite {
+    const char* previous;
+    MpiProfileSite(const char* site);
+    ~MpiProfileSite();
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_MPIPROFILER_H
@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <stdexcept>
+
+#include "Network.h"
+#include "Partitioner.h"
+#include "Random.h"
+
+// Allowed fraction by which the number of cells of a process can exceed the average
+const double PARTITION_IMBALANCE = 0.05;
+
+/**
+ * Reads the network from a comma delimited text file. Each line is either a segment, given as
+ * "segment,<id>,<length>", or a junction from one segment to another, given as "junction,<from id>,<to id>,<probability>"
+ * where the probability is the fraction of the Vehicles leaving the first segment that turn into the second. Segments
+ * without upstream junctions are sources where Vehicles spawn, and segments without downstream junctions are sinks.
+ * The lengths must be positive and the ids unique, and the probabilities out of a segment must not be negative and
+ * must not all be zero.
+ * @param file_name path and name of the file to read
+ * @return 0 if successful, 1 if the file does not exist, 2 if the file is malformed
+ */
+int Network::loadFromFile(std::string file_name) {
+    // Open the file containing the network, which is optional
+    std::ifstream file(file_name);
+    if (!file) {
+        return 1;
+    }
+
+    // Read each line into the segments and junctions of the network
+    std::vector<std::vector<double>> junctions;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::vector<std::string> fields;
+        std::stringstream line_stream(line);
+        std::string field;
+        while (std::getline(line_stream, field, ',')) {
+            fields.push_back(field);
+        }
+
+        // A field that is not a number, a length that is not positive or a negative probability makes the line
+        // malformed
+        bool valid = false;
+        try {
+            if (fields[0] == "segment" && fields.size() == 3) {
+                Segment segment;
+                segment.id = std::stoi(fields[1]);
+                segment.length = std::stoi(fields[2]);
+                valid = segment.length > 0;
+                if (valid && this->findSegment(segment.id) != -1) {
+                    std::cout << "error: duplicate segment " << segment.id << " in " << file_name << " file!"
+                              << std::endl;
+                    return 2;
+                }
+                if (valid) {
+                    this->segments.push_back(segment);
+                }
+            } else if (fields[0] == "junction" && fields.size() == 4) {
+                junctions.push_back({(double) std::stoi(fields[1]), (double) std::stoi(fields[2]),
+                                     std::stod(fields[3])});
+                valid = junctions.back()[2] >= 0.0 && std::isfinite(junctions.back()[2]);
+            }
+        } catch (const std::logic_error&) {
+            valid = false;
+        }
+        if (!valid) {
+            std::cout << "error: malformed line \"" << line << "\" in " << file_name << " file!" << std::endl;
+            return 2;
+        }
+    }
+
+    // Connect the segments with the junctions
+    for (std::vector<double>& junction : junctions) {
+        int from = this->findSegment((int) junction[0]);
+        int to = this->findSegment((int) junction[1]);
+        if (from == -1 || to == -1) {
+            std::cout << "error: junction to unknown segment in " << file_name << " file!" << std::endl;
+            return 2;
+        }
+        this->segments[from].downstream.push_back(to);
+        this->segments[from].turn_probabilities.push_back(junction[2]);
+        this->segments[to].upstream.push_back(from);
+    }
+
+    // Normalize the turning probabilities of each segment into a cumulative distribution
+    for (Segment& segment : this->segments) {
+        double sum = 0.0;
+        for (double p : segment.turn_probabilities) {
+            sum += p;
+        }
+        if (!segment.downstream.empty() && !(sum > 0.0)) {
+            std::cout << "error: junctions out of segment " << segment.id << " with no probability in " << file_name
+                      << " file!" << std::endl;
+            return 2;
+        }
+        double cumulative = 0.0;
+        for (double& p : segment.turn_probabilities) {
+            cumulative += p / sum;
+            p = cumulative;
+        }
+    }
+
+    // Close the file
+    file.close();
+
+    // Return with no errors
+    return 0;
+}
+
+/**
+ * Finds the index of a segment from its id
+ * @param id the id of the segment in the network file
+ * @return index of the segment, or -1 if there is none with the id
+ */
+int Network::findSegment(int id) {
+    for (int s = 0; s < (int) this->segments.size(); s++) {
+        if (this->segments[s].id == id) {
+            return s;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Assigns each segment to a process, balancing the number of cells per process and minimizing the number of junctions
+ * between segments of different processes
+ * @param num_of_processes number of processes to divide the network between
+ * @param num_lanes number of lanes of each segment
+ */
+void Network::partition(int num_of_processes, int num_lanes) {
+    std::vector<int> weights;
+    std::vector<std::pair<int, int>> edges;
+    for (int s = 0; s < (int) this->segments.size(); s++) {
+        weights.push_back(this->segments[s].length * num_lanes);
+        for (int d : this->segments[s].downstream) {
+            edges.push_back({s, d});
+        }
+    }
+
+    Partitioner partitioner(weights, edges, PARTITION_IMBALANCE);
+    this->owners = partitioner.partition(num_of_processes);
+    this->cut_edges = partitioner.getCutEdges(this->owners);
+}
+
+/**
+ * Getter method for the number of segments in the network
+ * @return number of segments
+ */
+int Network::getNumSegments() {
+    return this->segments.size();
+}
+
+/**
+ * Getter method for a segment of the network
+ * @param s index of the segment
+ * @return reference to the segment
+ */
+Segment& Network::getSegment(int s) {
+    return this->segments[s];
+}
+
+/**
+ * Getter method for the process that owns a segment
+ * @param s index of the segment
+ * @return rank of the process that simulates the segment
+ */
+int Network::getOwner(int s) {
+    return this->owners[s];
+}
+
+/**
+ * Getter method for the number of junctions between segments of different processes
+ * @return number of cut junctions
+ */
+int Network::getCutEdges() {
+    return this->cut_edges;
+}
+
+/**
+ * Lists the segments owned by a process
+ * @param rank rank of the process
+ * @return indices of the segments of the process in ascending order
+ */
+std::vector<int> Network::getOwnedSegments(int rank) {
+    std::vector<int> owned;
+    for (int s = 0; s < (int) this->segments.size(); s++) {
+        if (this->owners[s] == rank) {
+            owned.push_back(s);
+        }
+    }
+    return owned;
+}
+
+/**
+ * Lists the processes that own a segment connected by a junction to a segment of a process
+ * @param rank rank of the process
+ * @return ranks of the neighbouring processes in ascending order
+ */
+std::vector<int> Network::getNeighbourRanks(int rank) {
+    std::vector<int> neighbours;
+    for (int s : this->getOwnedSegments(rank)) {
+        for (std::vector<int>* connected : {&this->segments[s].upstream, &this->segments[s].downstream}) {
+            for (int c : *connected) {
+                if (this->owners[c] != rank &&
+                    std::find(neighbours.begin(), neighbours.end(), this->owners[c]) == neighbours.end()) {
+                    neighbours.push_back(this->owners[c]);
+                }
+            }
+        }
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+    return neighbours;
+}
+
+/**
+ * Lists the segments of a process whose entry summaries are needed by another process, which are the segments that
+ * have an upstream segment owned by the other process
+ * @param sender rank of the process that owns the segments
+ * @param receiver rank of the process that owns the upstream segments
+ * @return indices of the segments in ascending order
+ */
+std::vector<int> Network::getSummarySegments(int sender, int receiver) {
+    std::vector<int> summary_segments;
+    for (int s : this->getOwnedSegments(sender)) {
+        for (int u : this->segments[s].upstream) {
+            if (this->owners[u] == receiver) {
+                summary_segments.push_back(s);
+                break;
+            }
+        }
+    }
+    return summary_segments;
+}
+
+/**
+ * Randomly chooses the segment that a Vehicle leaving a segment turns into, based on the turning probabilities
+ * @param s index of the segment the Vehicle is leaving
+ * @return index of the downstream segment, or -1 if the segment is a sink
+ */
+int Network::chooseDownstream(int s) {
+    Segment& segment = this->segments[s];
+    if (segment.downstream.empty()) {
+        return -1;
+    }
+
+    double u = randomUniform();
+    for (int i = 0; i < (int) segment.downstream.size(); i++) {
+        if (segment.turn_probabilities[i] >= u) {
+            return segment.downstream[i];
+        }
+    }
+    return segment.downstream.back();
+}
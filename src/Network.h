@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_NETWORK_H
+#define CA_TRAFFIC_SIMULATION_NETWORK_H
+
+#include <vector>
+#include <string>
+
+/**
+ * Structure for a straight road segment of the network, with the junctions that connect it to other segments
+ */
+struct Segment {
+    int id;
+    int length;
+    std::vector<int> upstream;
+    std::vector<int> downstream;
+    std::vector<double> turn_probabilities;
+};
+
+/**
+ * Class for a network of road segments connected by junctions, which merge several segments into one or diverge one
+ * segment into several. Has methods to load the network from a file and to partition the segments across processes.
+ */
+class Network {
+private:
+    std::vector<Segment> segments;
+    std::vector<int> owners;
+    int cut_edges;
+    int findSegment(int id);
+public:
+    int loadFromFile(std::string file_name);
+    void partition(int num_of_processes, int num_lanes);
+    int getNumSegments();
+    Segment& getSegment(int s);
+    int getOwner(int s);
+    int getCutEdges();
+    std::vector<int> getOwnedSegments(int rank);
+    std::vector<int> getNeighbourRanks(int rank);
+    std::vector<int> getSummarySegments(int sender, int receiver);
+    int chooseDownstream(int s);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_NETWORK_H
@@ -0,0 +1,404 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <chrono>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <climits>
+
+#include "NetworkSimulation.h"
+#include "Vehicle.h"
+#include "RulePolicies.h"
+#include "Tracer.h"
+#include "PhaseCounters.h"
+
+/**
+ * Constructor for the NetworkSimulation, which creates a Road for each segment of the network owned by the process
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param network_ptr pointer to the partitioned network
+ * @param detectors_ptr pointer to the detectors of the process
+ * @param curr_proccess pointer to the current process
+ */
+NetworkSimulation::NetworkSimulation(Inputs inputs, Network* network_ptr, Detectors* detectors_ptr,
+                                     Process *curr_proccess) {
+    this->network_ptr = network_ptr;
+    this->detectors_ptr = detectors_ptr;
+    this->inputs = inputs;
+
+    // Create the Road of each owned segment, with the length of the segment
+    for (int s : network_ptr->getOwnedSegments(curr_proccess->getRank())) {
+        Inputs segment_inputs = inputs;
+        segment_inputs.length = network_ptr->getSegment(s).length;
+
+        SegmentState& segment = this->segments[s];
+        segment.index = s;
+        segment.length = segment_inputs.length;
+        segment.road_ptr = new Road(segment_inputs);
+        segment.road_ptr->setDetectors(detectors_ptr, s);
+        segment.entry_queues.resize(inputs.num_lanes);
+        segment.last_vehicles.assign(inputs.num_lanes, -1);
+    }
+
+    this->neighbours = network_ptr->getNeighbourRanks(curr_proccess->getRank());
+
+    // Give each process its own range of Vehicle ids, since Vehicles spawn on every process with a source segment
+    this->next_id = curr_proccess->getRank() * (INT_MAX / curr_proccess->getNumOfProcesses());
+
+    // Initialize Statistic for travel time
+    this->travel_time = new Statistic();
+
+    // Initialize the observables of all the segments of the network
+    std::vector<int> segment_lengths;
+    for (int s = 0; s < network_ptr->getNumSegments(); s++) {
+        segment_lengths.push_back(network_ptr->getSegment(s).length);
+    }
+    this->observables = new Observables(inputs, segment_lengths);
+
+    // Initialize the memory report
+    this->memory_report = new MemoryReport(inputs);
+}
+
+/**
+ * Destructor for the NetworkSimulation
+ */
+NetworkSimulation::~NetworkSimulation() {
+    for (std::pair<const int, SegmentState>& entry : this->segments) {
+        SegmentState& segment = entry.second;
+        for (Vehicle* vehicle_ptr : segment.vehicles) {
+            delete vehicle_ptr;
+        }
+        for (std::deque<Vehicle*>& queue : segment.entry_queues) {
+            for (Vehicle* vehicle_ptr : queue) {
+                delete vehicle_ptr;
+            }
+        }
+        delete segment.road_ptr;
+    }
+    delete this->travel_time;
+    delete this->observables;
+    delete this->memory_report;
+}
+
+/**
+ * Executes the simulation of the segments of the network owned by the current process
+ * @param curr_proccess pointer to the current process
+ * @return 0 if successful, nonzero otherwise
+ */
+int NetworkSimulation::run_simulation(Process *curr_proccess) {
+    // Select the rule policy once, and run the loop specialized for it
+    return dispatchRules(this->inputs, [&](auto rule_set) {
+        return this->run_loop<decltype(rule_set)>(curr_proccess);
+    });
+}
+
+/**
+ * Executes the simulation loop with the update kernel specialized for a rule policy
+ * @param curr_proccess pointer to the current process
+ * @return 0 if successful, nonzero otherwise
+ */
+template <class RuleSet>
+int NetworkSimulation::run_loop(Process *curr_proccess) {
+    // Report the share of the network of this process
+    int num_cells = 0;
+    for (std::pair<const int, SegmentState>& entry : this->segments) {
+        num_cells += entry.second.length * this->inputs.num_lanes;
+    }
+    std::cout << "Process : " << curr_proccess->getRank() << " segments: " << this->segments.size() << ", cells: "
+              << num_cells << ", neighbouring processes: " << this->neighbours.size() << std::endl;
+    if (curr_proccess->getRank() == 0) {
+        std::cout << "Network : " << this->network_ptr->getNumSegments() << " segments, "
+                  << this->network_ptr->getCutEdges() << " junctions between processes" << std::endl;
+    }
+    this->memory_report->report("start", this->getMemoryUsage(curr_proccess), curr_proccess);
+
+    // Obtain the start time
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    // Set the simulation time to zero
+    this->time = 0;
+
+    std::vector<int> no_vehicles(this->inputs.num_lanes, -1);
+
+    while (this->time < this->inputs.max_time) {
+        TraceScope step_trace("step");
+
+        // Obtain the first Vehicles of the downstream segments for the gaps at the end of each segment
+        PhaseScope phase_trace("exchangeSegmentSummaries");
+        this->exchangeSummaries(curr_proccess);
+
+        // Perform the lane switch step for all vehicles
+        phase_trace.next("lane changes");
+        for (std::pair<const int, SegmentState>& entry : this->segments) {
+            SegmentState& segment = entry.second;
+            for (Vehicle* vehicle_ptr : segment.vehicles) {
+                vehicle_ptr->updateGaps<RuleSet>(segment.road_ptr, 0, segment.length - 1, no_vehicles,
+                                                 segment.last_vehicles, this->time);
+            }
+            for (Vehicle* vehicle_ptr : segment.vehicles) {
+                vehicle_ptr->performLaneSwitch<RuleSet>(segment.road_ptr, this->time);
+            }
+        }
+
+        // Perform the independent lane updates, handing the Vehicles that leave a segment to the next segment
+        phase_trace.next("lane moves");
+        std::map<int, std::vector<JunctionTransfer>> transfers;
+        std::vector<JunctionTransfer> arrivals;
+        for (std::pair<const int, SegmentState>& entry : this->segments) {
+            SegmentState& segment = entry.second;
+            for (Vehicle* vehicle_ptr : segment.vehicles) {
+                vehicle_ptr->updateGaps<RuleSet>(segment.road_ptr, 0, segment.length - 1, no_vehicles,
+                                                 segment.last_vehicles, this->time);
+            }
+
+            std::vector<Vehicle*> remaining;
+            for (Vehicle* vehicle_ptr : segment.vehicles) {
+                if (vehicle_ptr->performLaneMove<RuleSet>() == 0) {
+                    remaining.push_back(vehicle_ptr);
+                    continue;
+                }
+
+                int next_segment = this->network_ptr->chooseDownstream(segment.index);
+                if (next_segment == -1) {
+                    // The Vehicle left the network through a sink
+                    if (this->time + 1 > this->inputs.warmup_time) {
+                        this->travel_time->addValue(vehicle_ptr->getTravelTime(this->inputs));
+                    }
+                    delete vehicle_ptr;
+                    continue;
+                }
+
+                // Carry the distance travelled beyond the end of the segment into the next segment
+                vehicle_ptr->setPosition(vehicle_ptr->getPosition() + vehicle_ptr->getSpeed() - segment.length);
+                JunctionTransfer transfer = {next_segment, vehicle_ptr->getLanePtr()->getLaneNumber(), vehicle_ptr};
+                int owner = this->network_ptr->getOwner(next_segment);
+                if (owner == curr_proccess->getRank()) {
+                    arrivals.push_back(transfer);
+                } else {
+                    transfers[owner].push_back(transfer);
+                }
+            }
+            segment.vehicles = remaining;
+            this->observables->addVehicles(segment.index, segment.vehicles);
+        }
+
+        // End of iteration steps
+        // Increment time
+        this->time++;
+        phase_trace.next("observables");
+        this->observables->endStep(this->time, curr_proccess);
+        this->detectors_ptr->endStep(this->time, this->inputs.max_time, curr_proccess);
+
+        // Exchange the Vehicles crossing junctions between processes
+        phase_trace.next("exchangeJunctionVehicles");
+        std::vector<JunctionTransfer> received = curr_proccess->exchangeJunctionVehicles(this->neighbours, transfers);
+        arrivals.insert(arrivals.end(), received.begin(), received.end());
+
+        // Queue the arriving Vehicles at the entry of their segment, the furthest travelled first
+        std::stable_sort(arrivals.begin(), arrivals.end(), [](const JunctionTransfer& a, const JunctionTransfer& b) {
+            return a.vehicle_ptr->getPosition() > b.vehicle_ptr->getPosition();
+        });
+        for (JunctionTransfer& arrival : arrivals) {
+            this->segments[arrival.segment].entry_queues[arrival.lane].push_back(arrival.vehicle_ptr);
+        }
+
+        // Admit the queued Vehicles and spawn new Vehicles at the sources of the network
+        phase_trace.next("spawn");
+        for (std::pair<const int, SegmentState>& entry : this->segments) {
+            SegmentState& segment = entry.second;
+            if (this->time % ENGINE_CHECK_INTERVAL == 0) {
+                int num_sites = segment.length * this->inputs.num_lanes;
+                segment.road_ptr->updateStorage((double) segment.vehicles.size() / (double) num_sites);
+            }
+            this->admitQueuedVehicles(segment);
+            if (this->network_ptr->getSegment(segment.index).upstream.empty()) {
+                segment.road_ptr->attemptSpawn(this->inputs, &(segment.vehicles), &(this->next_id), no_vehicles, 0,
+                                               this->inputs.num_lanes - 1);
+            }
+        }
+
+        phase_trace.next("memory report");
+        long num_vehicles = this->countVehicles();
+        this->memory_report->trackVehicles(num_vehicles);
+        PhaseCounters::addVehicleUpdates(num_vehicles);
+        if (this->memory_report->isDue(this->time)) {
+            this->memory_report->report("step " + std::to_string(this->time), this->getMemoryUsage(curr_proccess),
+                                        curr_proccess);
+        }
+    }
+
+    // Print the total run time and average iterations per second and seconds per iteration
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    auto time_elapsed = (std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()) /1000000.0;
+    // Write the report in one piece, so that it is not interleaved with the reports of processes that are threads
+    std::ostringstream report;
+    report << "--- Simulation Performance ---" << std::endl;
+    report << "Process : " << curr_proccess->getRank() << " total computation time: " << time_elapsed << " [s]" << std::endl;
+    report << "Process : " << curr_proccess->getRank() << " average time per iteration: " << time_elapsed / inputs.max_time << " [s]" << std::endl;
+    report << "Process : " << curr_proccess->getRank() << " average iterating frequency: " << inputs.max_time / time_elapsed << " [iter/s]" << std::endl;
+    curr_proccess->reportCommunication(report);
+    PhaseCounters::report(report, curr_proccess->getRank());
+    std::cout << report.str();
+
+    // Combine the travel times of the sinks of all processes on process 0
+    std::vector<double> values = this->travel_time->getValues();
+    double sum = 0.0;
+    double sum_squares = 0.0;
+    for (double value : values) {
+        sum += value;
+        sum_squares += value * value;
+    }
+    std::vector<double> totals = curr_proccess->reduceSum({sum, sum_squares, (double) values.size()});
+
+    if (curr_proccess->getRank() == 0) {
+        double n = totals[2];
+        double avg = totals[0] / n;
+        double variance = (totals[1] - n * avg * avg) / (n - 1.0);
+        std::cout << "--- Simulation Results ---" << std::endl;
+        std::cout << "Network : time on road: avg=" << avg << ", std=" << pow(variance, 0.5) << ", N=" << (int) n
+                  << std::endl;
+    }
+
+    this->memory_report->report("end", this->getMemoryUsage(curr_proccess), curr_proccess);
+
+    // Return with no errors
+    return 0;
+}
+
+/**
+ * Computes the entry summary of a segment, which is the first occupied site of each Lane, or zero for a Lane with
+ * Vehicles waiting at the junction to enter it
+ * @param segment the segment to summarize
+ * @return the first occupied site of each Lane, or -1 for empty Lanes
+ */
+std::vector<int> NetworkSimulation::getEntrySummary(SegmentState& segment) {
+    std::vector<int> summary;
+    std::vector<Lane*> lanes = segment.road_ptr->getLanes();
+    for (int i = 0; i < (int) lanes.size(); i++) {
+        if (!segment.entry_queues[i].empty()) {
+            summary.push_back(0);
+        } else {
+            summary.push_back(lanes[i]->nextOccupiedSite(0, segment.length - 1));
+        }
+    }
+    return summary;
+}
+
+/**
+ * Exchanges the entry summaries of the segments with the neighbouring processes, and sets the last Vehicles of each
+ * owned segment to the nearest first Vehicle of its downstream segments, in the coordinates of the owned segment
+ * @param curr_proccess pointer to the current process
+ */
+void NetworkSimulation::exchangeSummaries(Process *curr_proccess) {
+    int rank = curr_proccess->getRank();
+    int num_lanes = this->inputs.num_lanes;
+
+    // Summarize the owned segments, and pack the summaries needed by each neighbouring process
+    std::map<int, std::vector<int>> entry_summaries;
+    for (std::pair<const int, SegmentState>& entry : this->segments) {
+        entry_summaries[entry.first] = this->getEntrySummary(entry.second);
+    }
+
+    std::map<int, std::vector<int>> summaries_to_send;
+    std::map<int, int> summary_sizes;
+    for (int neighbour : this->neighbours) {
+        for (int s : this->network_ptr->getSummarySegments(rank, neighbour)) {
+            std::vector<int>& summary = entry_summaries[s];
+            summaries_to_send[neighbour].insert(summaries_to_send[neighbour].end(), summary.begin(), summary.end());
+        }
+        summary_sizes[neighbour] = this->network_ptr->getSummarySegments(neighbour, rank).size() * num_lanes;
+    }
+
+    // Unpack the summaries of the segments of the neighbouring processes
+    std::map<int, std::vector<int>> received = curr_proccess->exchangeSegmentSummaries(this->neighbours,
+                                                                                       summaries_to_send, summary_sizes);
+    for (int neighbour : this->neighbours) {
+        std::vector<int> summary_segments = this->network_ptr->getSummarySegments(neighbour, rank);
+        for (int k = 0; k < (int) summary_segments.size(); k++) {
+            entry_summaries[summary_segments[k]] = std::vector<int>(received[neighbour].begin() + k * num_lanes,
+                                                                    received[neighbour].begin() + (k + 1) * num_lanes);
+        }
+    }
+
+    // Take the nearest first Vehicle over the downstream segments of each owned segment
+    for (std::pair<const int, SegmentState>& entry : this->segments) {
+        SegmentState& segment = entry.second;
+        segment.last_vehicles.assign(num_lanes, -1);
+        for (int d : this->network_ptr->getSegment(segment.index).downstream) {
+            std::vector<int>& summary = entry_summaries[d];
+            for (int i = 0; i < num_lanes; i++) {
+                if (summary[i] != -1 &&
+                    (segment.last_vehicles[i] == -1 || summary[i] + segment.length < segment.last_vehicles[i])) {
+                    segment.last_vehicles[i] = summary[i] + segment.length;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Places the Vehicles waiting at the junction into the Lanes of a segment, each at the site it would have reached or
+ * right behind the first Vehicle of the Lane. Vehicles that do not fit keep waiting stopped at the junction.
+ * @param segment the segment that the Vehicles enter
+ */
+void NetworkSimulation::admitQueuedVehicles(SegmentState& segment) {
+    std::vector<Lane*> lanes = segment.road_ptr->getLanes();
+    for (int i = 0; i < (int) lanes.size(); i++) {
+        std::deque<Vehicle*>& queue = segment.entry_queues[i];
+        while (!queue.empty()) {
+            Vehicle* vehicle_ptr = queue.front();
+            int site = std::min(vehicle_ptr->getPosition(), segment.length - 1);
+            int first_site = lanes[i]->nextOccupiedSite(0, segment.length - 1);
+            if (first_site != -1) {
+                site = std::min(site, first_site - 1);
+            }
+            if (site < 0) {
+                // Stop the queued Vehicles until the entry of the Lane clears
+                for (Vehicle* waiting_ptr : queue) {
+                    waiting_ptr->setSpeed(0);
+                }
+                break;
+            }
+
+            vehicle_ptr->setPosition(site);
+            segment.road_ptr->attemptSpawn(i, vehicle_ptr, &(segment.vehicles));
+            queue.pop_front();
+        }
+    }
+}
+
+/**
+ * Counts the Vehicles of the segments of the current process, including the Vehicles waiting at their entries
+ * @return number of Vehicles of the current process
+ */
+long NetworkSimulation::countVehicles() {
+    long num_vehicles = 0;
+    for (std::pair<const int, SegmentState>& entry : this->segments) {
+        num_vehicles += entry.second.vehicles.size();
+        for (std::deque<Vehicle*>& queue : entry.second.entry_queues) {
+            num_vehicles += queue.size();
+        }
+    }
+    return num_vehicles;
+}
+
+/**
+ * Measures the memory used by the subsystems of the current process
+ * @param curr_proccess pointer to the current process
+ * @return the memory usage of the current process
+ */
+MemoryUsage NetworkSimulation::getMemoryUsage(Process *curr_proccess) {
+    MemoryUsage usage = {0, 0, 0, 0, 0, 0};
+    for (std::pair<const int, SegmentState>& entry : this->segments) {
+        SegmentState& segment = entry.second;
+        usage.lanes += segment.road_ptr->getMemoryUsage();
+        usage.vehicles += segment.vehicles.capacity() * sizeof(Vehicle*);
+        usage.cells += (long) segment.length * this->inputs.num_lanes;
+    }
+    usage.live_vehicles = this->countVehicles();
+    usage.vehicles += usage.live_vehicles * sizeof(Vehicle);
+    usage.statistics = this->travel_time->getMemoryUsage();
+    usage.buffers = curr_proccess->getPeakBufferBytes();
+    return usage;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_NETWORKSIMULATION_H
+#define CA_TRAFFIC_SIMULATION_NETWORKSIMULATION_H
+
+#include <vector>
+#include <deque>
+#include <map>
+
+#include "Road.h"
+#include "Inputs.h"
+#include "Statistic.h"
+#include "Observables.h"
+#include "Detectors.h"
+#include "MemoryReport.h"
+#include "Network.h"
+#include "Process.h"
+
+/**
+ * Structure for a segment of the network simulated by the current process, with its Road, its Vehicles and the
+ * Vehicles waiting at the junction to enter each of its Lanes
+ */
+struct SegmentState {
+    int index;
+    int length;
+    Road* road_ptr;
+    std::vector<Vehicle*> vehicles;
+    std::vector<std::deque<Vehicle*>> entry_queues;
+    std::vector<int> last_vehicles;
+};
+
+/**
+ * Class for the simulation of a network of road segments, where each process simulates the segments assigned to it by
+ * the partition of the network and exchanges the Vehicles crossing junctions with the processes of the connected
+ * segments. Has a method for running the simulation.
+ */
+class NetworkSimulation {
+private:
+    Network* network_ptr;
+    std::map<int, SegmentState> segments;
+    std::vector<int> neighbours;
+    int time;
+    Inputs inputs;
+    int next_id;
+    Statistic* travel_time;
+    Observables* observables;
+    Detectors* detectors_ptr;
+    MemoryReport* memory_report;
+    std::vector<int> getEntrySummary(SegmentState& segment);
+    void exchangeSummaries(Process *curr_proccess);
+    void admitQueuedVehicles(SegmentState& segment);
+    long countVehicles();
+    MemoryUsage getMemoryUsage(Process *curr_proccess);
+    template <class RuleSet>
+    int run_loop(Process *curr_proccess);
+
+public:
+    NetworkSimulation(Inputs inputs, Network* network_ptr, Detectors* detectors_ptr, Process *curr_proccess);
+    ~NetworkSimulation();
+    int run_simulation(Process *curr_proccess);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_NETWORKSIMULATION_H
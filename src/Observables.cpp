@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <cmath>
+#include <algorithm>
+
+#include "Observables.h"
+#include "Vehicle.h"
+
+/**
+ * Constructor for the Observables
+ * @param inputs instance of the Inputs class with the bin length and the window length, which disable the
+ * observables if either is zero
+ * @param segment_lengths length of each road segment, a single segment for a road without a network
+ */
+Observables::Observables(Inputs inputs, std::vector<int> segment_lengths) {
+    this->bin_length = inputs.bin_length;
+    this->window_length = inputs.window_length;
+    this->num_lanes = inputs.num_lanes;
+    this->segment_lengths = segment_lengths;
+
+    if (!this->isEnabled()) {
+        return;
+    }
+
+    // Number the bins of all the segments one after another
+    int num_bins = 0;
+    for (int length : segment_lengths) {
+        this->bin_offsets.push_back(num_bins);
+        num_bins += (length + this->bin_length - 1) / this->bin_length;
+    }
+    this->time_spent.assign(num_bins, 0.0);
+    this->distance_travelled.assign(num_bins, 0.0);
+}
+
+/**
+ * Checks whether the observables are computed
+ * @return true if the bin length and the window length are set, false otherwise
+ */
+bool Observables::isEnabled() {
+    return this->bin_length > 0 && this->window_length > 0;
+}
+
+/**
+ * Adds the time spent and the distance travelled in the current step by the Vehicles of a segment to their bins
+ * @param segment index of the segment of the Vehicles
+ * @param vehicles the Vehicles on the segment, with their positions in the coordinates of the segment
+ */
+void Observables::addVehicles(int segment, std::vector<Vehicle*>& vehicles) {
+    if (!this->isEnabled()) {
+        return;
+    }
+
+    int offset = this->bin_offsets[segment];
+    int length = this->segment_lengths[segment];
+    for (Vehicle* vehicle_ptr : vehicles) {
+        int position = vehicle_ptr->getPosition();
+        if (position < 0 || position >= length) {
+            continue;
+        }
+        int bin = offset + position / this->bin_length;
+        this->time_spent[bin] += 1.0;
+        this->distance_travelled[bin] += vehicle_ptr->getSpeed();
+    }
+}
+
+/**
+ * Ends a step of the simulation, and at the end of a window reduces the sums of the bins over all the processes,
+ * writes the observables of the window on the first process, and restarts the sums
+ * @param time number of steps completed
+ * @param curr_process pointer to the current process
+ */
+void Observables::endStep(int time, Process* curr_process) {
+    if (!this->isEnabled() || time % this->window_length != 0) {
+        return;
+    }
+
+    std::vector<double> values = this->time_spent;
+    values.insert(values.end(), this->distance_travelled.begin(), this->distance_travelled.end());
+    std::vector<double> sums = curr_process->reduceSum(values);
+    if (curr_process->getRank() == 0) {
+        this->writeWindow(time, sums);
+    }
+
+    std::fill(this->time_spent.begin(), this->time_spent.end(), 0.0);
+    std::fill(this->distance_travelled.begin(), this->distance_travelled.end(), 0.0);
+}
+
+/**
+ * Writes the observables of each bin for a window to the time series file, with the density in Vehicles per cell
+ * and lane, the flow in Vehicles per step and lane, and the space-mean speed in cells per step, which is not a number
+ * for bins without Vehicles
+ * @param time number of steps completed at the end of the window
+ * @param sums the time spent in each bin followed by the distance travelled in each bin, over all the processes
+ */
+void Observables::writeWindow(int time, std::vector<double>& sums) {
+    if (!this->output.is_open()) {
+        this->output.open("observables.csv");
+        this->output << "time,segment,position,density,flow,speed" << "\n";
+    }
+
+    int num_bins = this->time_spent.size();
+    for (int s = 0; s < (int) this->segment_lengths.size(); s++) {
+        int length = this->segment_lengths[s];
+        for (int start = 0; start < length; start += this->bin_length) {
+            int bin = this->bin_offsets[s] + start / this->bin_length;
+            double area = (double) this->window_length * std::min(this->bin_length, length - start) * this->num_lanes;
+            double total_time = sums[bin];
+            double total_distance = sums[num_bins + bin];
+
+            this->output << time << "," << s << "," << start << "," << total_time / area << ","
+                         << total_distance / area << "," << (total_time > 0 ? total_distance / total_time : NAN)
+                         << "\n";
+        }
+    }
+    this->output.flush();
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_OBSERVABLES_H
+#define CA_TRAFFIC_SIMULATION_OBSERVABLES_H
+
+#include <vector>
+#include <fstream>
+
+#include "Inputs.h"
+#include "Process.h"
+
+// Forward Declarations
+class Vehicle;
+
+/**
+ * Class for the macroscopic observables of the simulation, which are the density, the flow and the space-mean speed
+ * of the Vehicles on spatial bins of the road segments, averaged over time windows. The observables use the
+ * generalized definitions of Edie: every step each process adds the time spent and the distance travelled by its
+ * Vehicles to the bin they are in, and the sums are only reduced over the processes at the end of each window and
+ * written to a time series by the first process.
+ */
+class Observables {
+private:
+    int bin_length;
+    int window_length;
+    int num_lanes;
+    std::vector<int> segment_lengths;
+    std::vector<int> bin_offsets;
+    std::vector<double> time_spent;
+    std::vector<double> distance_travelled;
+    std::ofstream output;
+    void writeWindow(int time, std::vector<double>& sums);
+public:
+    Observables(Inputs inputs, std::vector<int> segment_lengths);
+    bool isEnabled();
+    void addVehicles(int segment, std::vector<Vehicle*>& vehicles);
+    void endStep(int time, Process* curr_process);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_OBSERVABLES_H
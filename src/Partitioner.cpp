@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "Partitioner.h"
+
+// Maximum number of refinement passes over the vertices of the graph
+const int MAX_REFINE_PASSES = 10;
+
+/**
+ * Constructor for the Partitioner
+ * @param weights weight of each vertex of the graph
+ * @param edges undirected edges of the graph as pairs of vertex indices
+ * @param imbalance allowed fraction by which the weight of a part can exceed the average part weight
+ */
+Partitioner::Partitioner(std::vector<int> weights, std::vector<std::pair<int, int>> edges, double imbalance) {
+    this->weights = weights;
+    this->imbalance = imbalance;
+
+    // Build the adjacency lists of the graph, skipping self loops
+    this->adjacency.resize(weights.size());
+    for (std::pair<int, int>& edge : edges) {
+        if (edge.first != edge.second) {
+            this->adjacency[edge.first].push_back(edge.second);
+            this->adjacency[edge.second].push_back(edge.first);
+        }
+    }
+}
+
+/**
+ * Divides the vertices of the graph into parts
+ * @param num_parts number of parts to divide the graph into
+ * @return the part of each vertex
+ */
+std::vector<int> Partitioner::partition(int num_parts) {
+    std::vector<int> parts(this->weights.size(), -1);
+    this->growParts(num_parts, parts);
+    this->balanceParts(num_parts, parts);
+    this->refineParts(num_parts, parts);
+    return parts;
+}
+
+/**
+ * Gets the largest weight allowed for a part, the average part weight with the allowed imbalance, or the weight of the
+ * heaviest vertex if that is more
+ * @param num_parts number of parts to divide the graph into
+ * @return the largest weight of a part
+ */
+double Partitioner::getMaxWeight(int num_parts) {
+    long total_weight = 0;
+    int max_vertex_weight = 0;
+    for (int w : this->weights) {
+        total_weight += w;
+        max_vertex_weight = std::max(max_vertex_weight, w);
+    }
+    return std::max((double) max_vertex_weight, std::ceil((double) total_weight / num_parts * (1.0 + this->imbalance)));
+}
+
+/**
+ * Grows each part from a peripheral seed vertex, adding the neighbouring vertex most connected to the part until the
+ * part reaches its share of the remaining weight
+ * @param num_parts number of parts to divide the graph into
+ * @param parts the part of each vertex, filled by this method
+ */
+void Partitioner::growParts(int num_parts, std::vector<int>& parts) {
+    int num_vertices = this->weights.size();
+    long remaining_weight = 0;
+    for (int w : this->weights) {
+        remaining_weight += w;
+    }
+
+    for (int k = 0; k < num_parts; k++) {
+        // The last part takes all the vertices that are left
+        if (k == num_parts - 1) {
+            for (int v = 0; v < num_vertices; v++) {
+                if (parts[v] == -1) {
+                    parts[v] = k;
+                }
+            }
+            break;
+        }
+
+        double target = (double) remaining_weight / (double) (num_parts - k);
+        long part_weight = 0;
+        std::vector<int> connections(num_vertices, 0);
+
+        while (part_weight < target) {
+            // Pick the unassigned vertex most connected to the part, or a new peripheral seed if there is none
+            int best = -1;
+            for (int v = 0; v < num_vertices; v++) {
+                if (parts[v] == -1 && connections[v] > 0 && (best == -1 || connections[v] > connections[best])) {
+                    best = v;
+                }
+            }
+            if (best == -1) {
+                int fewest_free = 0;
+                for (int v = 0; v < num_vertices; v++) {
+                    if (parts[v] != -1) {
+                        continue;
+                    }
+                    int free_neighbours = 0;
+                    for (int u : this->adjacency[v]) {
+                        free_neighbours += parts[u] == -1;
+                    }
+                    if (best == -1 || free_neighbours < fewest_free) {
+                        best = v;
+                        fewest_free = free_neighbours;
+                    }
+                }
+            }
+
+            // Stop if the graph is exhausted or the vertex overshoots the target by more than it leaves missing
+            if (best == -1 || (part_weight > 0 && part_weight + this->weights[best] - target > target - part_weight)) {
+                break;
+            }
+
+            parts[best] = k;
+            part_weight += this->weights[best];
+            for (int u : this->adjacency[best]) {
+                connections[u]++;
+            }
+        }
+
+        remaining_weight -= part_weight;
+    }
+}
+
+/**
+ * Moves vertices out of the parts that are heavier than the allowed imbalance into parts that stay within it, even when
+ * that adds cut edges, until no part is too heavy or no vertex can move. Each move takes the vertex and part that cut
+ * the fewest edges, preferring the lighter part on ties.
+ * @param num_parts number of parts the graph is divided into
+ * @param parts the part of each vertex, updated by this method
+ */
+void Partitioner::balanceParts(int num_parts, std::vector<int>& parts) {
+    int num_vertices = this->weights.size();
+    std::vector<int> part_weights = this->getPartWeights(num_parts, parts);
+    double max_weight = this->getMaxWeight(num_parts);
+
+    while (true) {
+        int best_vertex = -1;
+        int best_part = -1;
+        int best_gain = 0;
+        for (int v = 0; v < num_vertices; v++) {
+            int a = parts[v];
+            int w = this->weights[v];
+            if (part_weights[a] <= max_weight || part_weights[a] == w) {
+                continue;
+            }
+
+            // Count the edges from the vertex into each part
+            std::vector<int> connections(num_parts, 0);
+            for (int u : this->adjacency[v]) {
+                connections[parts[u]]++;
+            }
+            for (int b = 0; b < num_parts; b++) {
+                if (b == a || part_weights[b] + w > max_weight) {
+                    continue;
+                }
+                int gain = connections[b] - connections[a];
+                if (best_vertex == -1 || gain > best_gain ||
+                    (gain == best_gain && part_weights[b] < part_weights[best_part])) {
+                    best_vertex = v;
+                    best_part = b;
+                    best_gain = gain;
+                }
+            }
+        }
+        if (best_vertex == -1) {
+            break;
+        }
+
+        part_weights[parts[best_vertex]] -= this->weights[best_vertex];
+        part_weights[best_part] += this->weights[best_vertex];
+        parts[best_vertex] = best_part;
+    }
+}
+
+/**
+ * Moves vertices on the boundaries between parts to the neighbouring part when that reduces the number of cut edges
+ * without exceeding the allowed imbalance, or improves the balance without adding cut edges
+ * @param num_parts number of parts the graph is divided into
+ * @param parts the part of each vertex, updated by this method
+ */
+void Partitioner::refineParts(int num_parts, std::vector<int>& parts) {
+    int num_vertices = this->weights.size();
+    std::vector<int> part_weights = this->getPartWeights(num_parts, parts);
+    std::vector<int> part_sizes(num_parts, 0);
+    for (int v = 0; v < num_vertices; v++) {
+        part_sizes[parts[v]]++;
+    }
+    double max_weight = this->getMaxWeight(num_parts);
+
+    for (int pass = 0; pass < MAX_REFINE_PASSES; pass++) {
+        bool moved = false;
+        for (int v = 0; v < num_vertices; v++) {
+            int a = parts[v];
+            if (part_sizes[a] == 1) {
+                continue;
+            }
+
+            // Count the edges from the vertex into each part
+            std::vector<int> connections(num_parts, 0);
+            for (int u : this->adjacency[v]) {
+                connections[parts[u]]++;
+            }
+
+            // Find the neighbouring part with the largest gain, preferring the lighter part on ties
+            int best = -1;
+            for (int u : this->adjacency[v]) {
+                int b = parts[u];
+                if (b == a) {
+                    continue;
+                }
+                if (best == -1 || connections[b] > connections[best] ||
+                    (connections[b] == connections[best] && part_weights[b] < part_weights[best])) {
+                    best = b;
+                }
+            }
+            if (best == -1) {
+                continue;
+            }
+
+            int gain = connections[best] - connections[a];
+            int w = this->weights[v];
+            if ((gain > 0 && part_weights[best] + w <= max_weight) ||
+                (gain == 0 && part_weights[a] > part_weights[best] + w)) {
+                parts[v] = best;
+                part_weights[a] -= w;
+                part_weights[best] += w;
+                part_sizes[a]--;
+                part_sizes[best]++;
+                moved = true;
+            }
+        }
+        if (!moved) {
+            break;
+        }
+    }
+}
+
+/**
+ * Counts the edges of the graph whose vertices are in different parts
+ * @param parts the part of each vertex
+ * @return number of cut edges
+ */
+int Partitioner::getCutEdges(std::vector<int>& parts) {
+    int cut_edges = 0;
+    for (int v = 0; v < (int) this->adjacency.size(); v++) {
+        for (int u : this->adjacency[v]) {
+            cut_edges += parts[v] != parts[u];
+        }
+    }
+    return cut_edges / 2;
+}
+
+/**
+ * Sums the weights of the vertices in each part
+ * @param num_parts number of parts the graph is divided into
+ * @param parts the part of each vertex
+ * @return the weight of each part
+ */
+std::vector<int> Partitioner::getPartWeights(int num_parts, std::vector<int>& parts) {
+    std::vector<int> part_weights(num_parts, 0);
+    for (int v = 0; v < (int) this->weights.size(); v++) {
+        part_weights[parts[v]] += this->weights[v];
+    }
+    return part_weights;
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_PARTITIONER_H
+#define CA_TRAFFIC_SIMULATION_PARTITIONER_H
+
+#include <vector>
+
+/**
+ * Class for a graph partitioner that divides weighted vertices into parts of balanced weight while keeping the number
+ * of edges cut between the parts small. Uses greedy graph growing, then moves vertices out of the parts that are too
+ * heavy, followed by boundary refinement passes.
+ */
+class Partitioner {
+private:
+    std::vector<int> weights;
+    std::vector<std::vector<int>> adjacency;
+    double imbalance;
+    double getMaxWeight(int num_parts);
+    void growParts(int num_parts, std::vector<int>& parts);
+    void balanceParts(int num_parts, std::vector<int>& parts);
+    void refineParts(int num_parts, std::vector<int>& parts);
+public:
+    Partitioner(std::vector<int> weights, std::vector<std::pair<int, int>> edges, double imbalance);
+    std::vector<int> partition(int num_parts);
+    int getCutEdges(std::vector<int>& parts);
+    std::vector<int> getPartWeights(int num_parts, std::vector<int>& parts);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_PARTITIONER_H
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <algorithm>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "PhaseCounters.h"
+
+// Hardware events that are counted for each phase
+const int NUM_COUNTER_EVENTS = 4;
+static const char* const EVENT_NAMES[NUM_COUNTER_EVENTS] = {"cycles", "instructions", "cache misses",
+                                                            "branch misses"};
+
+/**
+ * Structure for the totals of a phase over all its steps
+ */
+struct PhaseTotals {
+    const char* name;
+    long long nanoseconds;
+    double events[NUM_COUNTER_EVENTS];
+};
+
+/**
+ * Structure for the counters of a thread, with the phase that is running and the readings at its start
+ */
+struct CounterGroup {
+    int fds[NUM_COUNTER_EVENTS];
+    int slots[NUM_COUNTER_EVENTS];
+    int num_open;
+    std::string status;
+    std::vector<PhaseTotals> phases;
+    int current;
+    std::chrono::steady_clock::time_point begin;
+    uint64_t begin_values[NUM_COUNTER_EVENTS];
+    uint64_t begin_enabled;
+    uint64_t begin_running;
+    long vehicle_updates;
+
+    ~CounterGroup() {
+#ifdef __linux__
+        for (int i = 0; i < NUM_COUNTER_EVENTS; i++) {
+            if (this->fds[i] != -1) {
+                close(this->fds[i]);
+            }
+        }
+#endif
+    }
+};
+
+// Counters of the current thread, or nullptr if it is not registered
+static thread_local std::unique_ptr<CounterGroup> thread_counters;
+
+/**
+ * Starts counting the phases of the threads that register
+ */
+void PhaseCounters::start() {
+    counting = true;
+}
+
+/**
+ * Opens a group of hardware counters for the current thread, in user space only, led by the first event. The events
+ * that the machine does not have are left out of the group.
+ * @param counters the counters of the thread
+ */
+static void openCounters(CounterGroup* counters) {
+#ifdef __linux__
+    static const uint64_t configs[NUM_COUNTER_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                         PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (int i = 0; i < NUM_COUNTER_EVENTS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.disabled = i == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : counters->fds[0], 0);
+        if (fd == -1 && i == 0) {
+            counters->status = std::string("no hardware counters, ") + strerror(errno);
+            return;
+        }
+        counters->fds[i] = fd;
+        if (fd != -1) {
+            counters->slots[i] = counters->num_open++;
+        }
+    }
+    ioctl(counters->fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(counters->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+    counters->status = "no hardware counters on this platform";
+#endif
+}
+
+/**
+ * Registers the current thread, which opens its hardware counters if it can. The phases of threads that did not
+ * register are not counted.
+ */
+void PhaseCounters::registerThread() {
+    if (!counting) {
+        return;
+    }
+    CounterGroup* counters = new CounterGroup();
+    for (int i = 0; i < NUM_COUNTER_EVENTS; i++) {
+        counters->fds[i] = -1;
+        counters->slots[i] = -1;
+    }
+    counters->num_open = 0;
+    counters->current = -1;
+    counters->vehicle_updates = 0;
+    openCounters(counters);
+    thread_counters.reset(counters);
+}
+
+/**
+ * Reads the hardware counters of the current thread, with the times they were enabled and running for
+ * @param counters the counters of the thread
+ * @param values the values of the events, in the order of the events
+ * @param enabled time the group was enabled for
+ * @param running time the group was running for, less than the time it was enabled for when it was multiplexed
+ */
+static void readCounters(CounterGroup* counters, uint64_t* values, uint64_t& enabled, uint64_t& running) {
+    enabled = 0;
+    running = 0;
+    if (counters->num_open == 0) {
+        return;
+    }
+#ifdef __linux__
+    uint64_t buffer[3 + NUM_COUNTER_EVENTS];
+    if (read(counters->fds[0], buffer, sizeof(buffer)) < (ssize_t) (3 * sizeof(uint64_t))) {
+        return;
+    }
+    enabled = buffer[1];
+    running = buffer[2];
+    for (int i = 0; i < NUM_COUNTER_EVENTS; i++) {
+        values[i] = counters->slots[i] == -1 ? 0 : buffer[3 + counters->slots[i]];
+    }
+#endif
+}
+
+/**
+ * Adds the counts since the start of the phase that is running to its totals
+ * @param counters the counters of the thread
+ * @param now the end of the phase
+ * @param values the values of the events at the end of the phase
+ * @param enabled time the group was enabled for at the end of the phase
+ * @param running time the group was running for at the end of the phase
+ */
+static void addCounts(CounterGroup* counters, std::chrono::steady_clock::time_point now, const uint64_t* values,
+                      uint64_t enabled, uint64_t running) {
+    PhaseTotals& phase = counters->phases[counters->current];
+    phase.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(now - counters->begin).count();
+    uint64_t running_delta = running - counters->begin_running;
+    if (running_delta == 0) {
+        return;
+    }
+
+    // Scale up the counts of a phase in which the group was multiplexed with the counters of other programs
+    double scale = (double) (enabled - counters->begin_enabled) / running_delta;
+    for (int i = 0; i < NUM_COUNTER_EVENTS; i++) {
+        phase.events[i] += (values[i] - counters->begin_values[i]) * scale;
+    }
+}
+
+/**
+ * Ends the phase of the current thread that is running, if any, and starts a new one
+ * @param name name of the phase, which must outlive the counters
+ */
+void PhaseCounters::begin(const char* name) {
+    CounterGroup* counters = thread_counters.get();
+    if (counters == nullptr) {
+        return;
+    }
+    uint64_t values[NUM_COUNTER_EVENTS] = {0, 0, 0, 0};
+    uint64_t enabled, running;
+    readCounters(counters, values, enabled, running);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (counters->current != -1) {
+        addCounts(counters, now, values, enabled, running);
+    }
+
+    // The phases are few, and the names of a phase are the same literal
+    int index = 0;
+    while (index < (int) counters->phases.size() && counters->phases[index].name != name &&
+           strcmp(counters->phases[index].name, name) != 0) {
+        index++;
+    }
+    if (index == (int) counters->phases.size()) {
+        counters->phases.push_back({name, 0, {0.0, 0.0, 0.0, 0.0}});
+    }
+    counters->current = index;
+    counters->begin = now;
+    std::copy(values, values + NUM_COUNTER_EVENTS, counters->begin_values);
+    counters->begin_enabled = enabled;
+    counters->begin_running = running;
+}
+
+/**
+ * Ends the phase of the current thread that is running
+ */
+void PhaseCounters::end() {
+    CounterGroup* counters = thread_counters.get();
+    if (counters == nullptr || counters->current == -1) {
+        return;
+    }
+    uint64_t values[NUM_COUNTER_EVENTS] = {0, 0, 0, 0};
+    uint64_t enabled, running;
+    readCounters(counters, values, enabled, running);
+    addCounts(counters, std::chrono::steady_clock::now(), values, enabled, running);
+    counters->current = -1;
+}
+
+/**
+ * Adds the Vehicles updated in a step of the current thread, which the costs of the phases are divided by
+ * @param num_updates number of Vehicles updated in the step
+ */
+void PhaseCounters::addVehicleUpdates(long num_updates) {
+    CounterGroup* counters = thread_counters.get();
+    if (counters != nullptr) {
+        counters->vehicle_updates += num_updates;
+    }
+}
+
+/**
+ * Writes the totals of the phases of the current thread and their costs per Vehicle update, and the totals over all
+ * the phases
+ * @param report the stream to write to
+ * @param rank rank of the process of the thread
+ */
+void PhaseCounters::report(std::ostream& report, int rank) {
+    CounterGroup* counters = thread_counters.get();
+    if (counters == nullptr) {
+        return;
+    }
+    double updates = std::max(1L, counters->vehicle_updates);
+    report << "Process : " << rank << " phase counters over " << counters->vehicle_updates << " vehicle updates";
+    if (counters->num_open == 0) {
+        report << " (" << counters->status << ", timers only)";
+    }
+    report << std::endl;
+
+    PhaseTotals total = {"total", 0, {0.0, 0.0, 0.0, 0.0}};
+    std::vector<PhaseTotals> rows = counters->phases;
+    for (PhaseTotals& phase : counters->phases) {
+        total.nanoseconds += phase.nanoseconds;
+        for (int i = 0; i < NUM_COUNTER_EVENTS; i++) {
+            total.events[i] += phase.events[i];
+        }
+    }
+    rows.push_back(total);
+
+    for (PhaseTotals& phase : rows) {
+        report << "Process : " << rank << "   " << phase.name << ": " << phase.nanoseconds / 1e9 << " [s], "
+               << phase.nanoseconds / updates << " [ns/update]";
+        for (int i = 0; i < NUM_COUNTER_EVENTS; i++) {
+            if (counters->slots[i] != -1) {
+                report << ", " << (long long) phase.events[i] << " " << EVENT_NAMES[i] << " ("
+                       << phase.events[i] / updates << "/update)";
+            }
+        }
+        if (counters->slots[0] != -1 && counters->slots[1] != -1 && phase.events[0] > 0.0) {
+            report << ", IPC " << phase.events[1] / phase.events[0];
+        }
+        report << std::endl;
+    }
+}
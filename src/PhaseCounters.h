@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_PHASECOUNTERS_H
+#define CA_TRAFFIC_SIMULATION_PHASECOUNTERS_H
+
+#include <atomic>
+#include <ostream>
+
+#include "Tracer.h"
+
+// Whether the phases of the steps are counted
+inline std::atomic<bool> counting(false);
+
+/**
+ * Class for the counters of the phases of the steps of the simulation. Each thread that registers opens a group of
+ * hardware counters for itself with perf_event_open, for the cycles, instructions, cache misses and branch misses, and
+ * reads them at the start and end of each phase. Where the counters cannot be opened, as in most containers, the
+ * phases are only timed. Each process reports the totals of its phases and their cost per Vehicle update.
+ */
+class PhaseCounters {
+public:
+    static void start();
+    static void registerThread();
+    static void begin(const char* name);
+    static void end();
+    static void addVehicleUpdates(long num_updates);
+    static void report(std::ostream& report, int rank);
+};
+
+/**
+ * Class for a phase of a step that lasts while it is in scope, which is traced and counted. A phase can be followed
+ * directly by the next one, like a TraceScope.
+ */
+class PhaseScope {
+private:
+    TraceScope trace;
+public:
+    /**
+     * Constructor for the PhaseScope, which starts the phase
+     * @param name name of the phase, which must outlive the counters
+     */
+    inline PhaseScope(const char* name) : trace(name) {
+        if (counting.load(std::memory_order_relaxed)) {
+            PhaseCounters::begin(name);
+        }
+    }
+
+    /**
+     * Ends the current phase and starts the next one
+     * @param name name of the next phase, which must outlive the counters
+     */
+    inline void next(const char* name) {
+        this->trace.next(name);
+        if (counting.load(std::memory_order_relaxed)) {
+            PhaseCounters::begin(name);
+        }
+    }
+
+    /**
+     * Destructor for the PhaseScope, which ends the phase
+     */
+    inline ~PhaseScope() {
+        if (counting.load(std::memory_order_relaxed)) {
+            PhaseCounters::end();
+        }
+    }
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_PHASECOUNTERS_H
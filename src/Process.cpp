@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <sys/resource.h>
+#include <algorithm>
+#include <stdexcept>
+#include <climits>
+
+#include "Process.h"
+#include "Lane.h"
+
+
+const int NO_RANK = -1;
+
+// Cost of a message in the model of the communication of a decomposition, in the values that could be sent instead
+const double MESSAGE_COST = 256.0;
+
+// Occupancy assumed by the model of the communication of a decomposition when the expected one is unknown
+const double DEFAULT_OCCUPANCY = 0.1;
+
+/**
+* Set the rank of the process and the ranks of its neighbours along the road
+* @param rank rank of the process
+* @param num_of_processes total number of processes
+*/
+void Process::setRanks(int rank, int num_of_processes){
+    this->rank = rank;
+    this->num_of_processes = num_of_processes;
+
+    // Set prev rank
+    if(this->rank == 0)
+        this->prev_rank = NO_RANK;
+    else
+        this->prev_rank = this->rank - 1;
+
+    // Set next rank
+    if(this->rank == num_of_processes - 1)
+        this->next_rank = NO_RANK;
+    else
+        this->next_rank = this->rank + 1;
+
+    this->peak_buffer_bytes = 0;
+    this->first_lane = 0;
+    this->last_lane = -1;
+    this->right_rank = NO_RANK;
+    this->left_rank = NO_RANK;
+    this->num_lane_groups = 1;
+}
+
+/**
+* Set the group of Lanes of the part of the road of the process, and the ranks of the processes with the groups of the
+* neighbouring Lanes of the same segment of the road
+* @param first_lane first Lane of the group
+* @param last_lane last Lane of the group
+* @param right_rank rank of the process with the group of the lower Lanes, or -1
+* @param left_rank rank of the process with the group of the higher Lanes, or -1
+* @param num_lane_groups number of groups of Lanes of the road
+*/
+void Process::setLanes(int first_lane, int last_lane, int right_rank, int left_rank, int num_lane_groups){
+    this->first_lane = first_lane;
+    this->last_lane = last_lane;
+    this->right_rank = right_rank;
+    this->left_rank = left_rank;
+    this->num_lane_groups = num_lane_groups;
+}
+
+/**
+* Choose the number of groups of Lanes of a decomposition of a single road into groups of Lanes and segments, from a
+* model of the values and messages that a process exchanges in a step. Each segment boundary exchanges a few values per
+* Lane of the group, while each group boundary exchanges the Vehicles of a Lane over the length of the segment, so the
+* Lanes are only split when the segments would otherwise be too short for the Vehicles to cross one per step, or when
+* the road is much wider than its segments are long.
+* @param num_of_processes total number of processes
+* @param inputs instance of the Inputs class with the simulation Inputs
+* @return number of groups of Lanes, which divides the number of processes
+*/
+int Process::chooseLaneGroups(int num_of_processes, Inputs& inputs){
+    double occupancy = inputs.percent_full > 0.0 ? inputs.percent_full / 100.0 : DEFAULT_OCCUPANCY;
+    int min_segment = inputs.max_speed + 1;
+    int best_groups = 1;
+    double best_cost = 0.0;
+    for(int groups = 1; groups <= std::min(num_of_processes, inputs.num_lanes); groups++){
+        if(num_of_processes % groups != 0){
+            continue;
+        }
+        int segments = num_of_processes / groups;
+        double lanes = (double) inputs.num_lanes / groups;
+        double segment_length = (double) inputs.length / segments;
+
+        // The boundaries of the segment exchange the first and last Vehicles and the migrants of each Lane
+        double cost = 0.0;
+        if(segments > 1){
+            cost += 2.0 * (3.0 * MESSAGE_COST + 2.0 * lanes);
+        }
+
+        // The boundaries of the group exchange the Vehicles of their edge Lanes and the lane changes across them
+        if(groups > 1){
+            cost += 2.0 * (2.0 * MESSAGE_COST + 2.0 * occupancy * segment_length);
+        }
+
+        // Segments that a Vehicle could skip in a step are not allowed
+        if(segment_length < min_segment){
+            cost += (double) INT_MAX * (min_segment - segment_length);
+        }
+        if(groups == 1 || cost < best_cost){
+            best_groups = groups;
+            best_cost = cost;
+        }
+    }
+    return best_groups;
+}
+
+/**
+* Split a range into contiguous parts of nearly equal size
+* @param size size of the range
+* @param num_parts number of parts
+* @param part index of the part
+* @param first pointer to the first index of the part in the range
+* @return size of the part
+*/
+int Process::splitRange(int size, int num_parts, int part, int* first){
+    int start = 0;
+    int remainder = size;
+    int part_size = 0;
+    for(int i = 0; i <= part; i++){
+        part_size = remainder / (num_parts - i);
+        *first = start;
+        remainder -= part_size;
+        start += part_size;
+    }
+    return part_size;
+}
+
+/**
+* Record the size of the message buffers packed for an exchange, to keep the largest one
+* @param bytes number of bytes of the message buffers
+*/
+void Process::recordBufferBytes(long bytes){
+    this->peak_buffer_bytes = std::max(this->peak_buffer_bytes, bytes);
+}
+
+/**
+* Get the size of the largest message buffers packed by the process for an exchange
+* @return number of bytes of the largest message buffers
+*/
+long Process::getPeakBufferBytes(){ return this->peak_buffer_bytes; }
+
+/**
+* Get the peak resident set size of the process
+* @return the peak resident set size in bytes
+*/
+long Process::getPeakResidentBytes(){
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss * 1024L;
+}
+
+/**
+* Exchange the boundaries and the migrating Vehicles of a road with the neighbouring processes in a single step, for
+* the processes with a one-sided transport. Only called when isOneSided is true.
+* @param lanes pointer in the lanes of the road
+* @param migrants the Vehicles that move to the next process, already removed from the lanes
+* @param first_vehicles the first vehicles of the previous process, replaced with the ones of this step
+* @param last_vehicles the last vehicles of the next process, replaced with the ones of this step
+* @return the Vehicles that moved from the previous process, in a list for each Lane
+*/
+std::vector<std::vector<Vehicle *>> Process::exchangeOneSided(std::vector<Lane*> lanes, std::vector<Vehicle*>& migrants,
+                                                              std::vector<int>& first_vehicles,
+                                                              std::vector<int>& last_vehicles){
+    throw std::logic_error("The process has no one-sided transport");
+}
+
+/**
+* Exchange the Vehicles of the edge Lanes of the group of Lanes of the process with the processes of the neighbouring
+* groups of Lanes of the same segment. Only called when the Lanes of the road are split between processes.
+* @param to_right the values for the process with the group of the lower Lanes
+* @param to_left the values for the process with the group of the higher Lanes
+* @return the values from the process to the right and from the process to the left, empty if there is none
+*/
+std::vector<std::vector<int>> Process::exchangeEdgeLanes(std::vector<int>& to_right, std::vector<int>& to_left){
+    throw std::logic_error("The process does not split the lanes of the road");
+}
+
+/**
+* Exchange the Vehicles that change into a Lane of a neighbouring group of Lanes of the same segment. Only called when
+* the Lanes of the road are split between processes.
+* @param to_right the Vehicles that change into the group of the lower Lanes, already removed from the lanes
+* @param to_left the Vehicles that change into the group of the higher Lanes, already removed from the lanes
+* @return the Vehicles that changed into the group of Lanes of the process, in a list for each Lane
+*/
+std::vector<std::vector<Vehicle *>> Process::exchangeLaneChanges(std::vector<Vehicle *>& to_right,
+                                                                 std::vector<Vehicle *>& to_left){
+    throw std::logic_error("The process does not split the lanes of the road");
+}
+
+int Process::getRank(){ return this->rank; }
+
+int Process::getNextRank(){ return this->next_rank; }
+
+int Process::getPrevRank(){ return this->prev_rank; }
+
+int Process::getNumOfProcesses(){ return this->num_of_processes; }
+
+int Process::getStartPosition(){ return this->road_start; }
+
+int Process::getEndPosition(){ return this->road_end; }
+
+int Process::getFirstLane(){ return this->first_lane; }
+
+int Process::getLastLane(){ return this->last_lane; }
+
+int Process::getRightRank(){ return this->right_rank; }
+
+int Process::getLeftRank(){ return this->left_rank; }
+
+int Process::getNumLaneGroups(){ return this->num_lane_groups; }
+
+/**
+* Receive the list of vehicles and check if the new vehicle can be sent without passing
+* over vehicles ahead of it
+* @param vehicles pointer to list of all the Vehicles of curr process
+* @param vehicles_to_send pointer to list of Vehicles to be sent in the next process
+* @param newVehicle pointer to the new vehicle we want to send
+* @return true if the new vehicle can be sent, false otherwise
+*/
+bool Process::allowSending(std::vector<Vehicle *>& vehicles, std::vector<Vehicle *>& vehicles_to_send, Vehicle *newVehicle){
+
+    for(int i = 0; i < (int)vehicles.size(); i++){
+        // check for vehicles of the same lane
+        if(vehicles[i]->getLanePtr()->getLaneNumber() == newVehicle->getLanePtr()->getLaneNumber()){
+            if(vehicles[i]->getPosition() > newVehicle->getPosition() && !vehicles[i]->isInList(vehicles_to_send)){
+#ifdef DEBUG
+               printf("Cannot send %d because %d is ahead of it\n", newVehicle->getId(), vehicles[i]->getId());
+#endif
+               return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+* Find the last vehicles (smaller positions) of the process (one from each lane)
+* @param lanes pointer in the lanes of the road
+* @param prev_process_indices the last vehicles received from the next process, used for empty lanes
+* @return the vector of index of the last vehicles
+*/
+std::vector<int> Process::findLastVehicles(std::vector<Lane*>& lanes, std::vector<int>& prev_process_indices){
+    std::vector<int> index_last_vehicles(this->num_lanes, -1);
+
+    for(int i = 0; i < (int)lanes.size(); i++){
+        index_last_vehicles[i] = lanes[i]->nextOccupiedSite(0, lanes[i]->getSize() - 1);
+
+        // if all the road is crossed and no vehicle is found,
+        // send the result of the previous process
+        if(index_last_vehicles[i] == -1){
+            index_last_vehicles[i] = prev_process_indices[i];
+        }
+    }
+#ifdef DEBUG
+    printf("process: %d, my last vehicles are in positions: ", this->getRank());
+    for(int i : index_last_vehicles){
+        printf("%d, ", i);
+    }
+    printf("\n");
+#endif
+    return index_last_vehicles;
+}
+
+/**
+* Find the first vehicles (greatest positions) of the process (one from each lane)
+* @param lanes pointer in the lanes of the road
+* @param next_process_indices the first vehicles received from the previous process, used for empty lanes
+* @return the vector of index of the first vehicles
+*/
+std::vector<int> Process::findFirstVehicles(std::vector<Lane*>& lanes, std::vector<int>& next_process_indices){
+    std::vector<int> index_first_vehicles(this->num_lanes, -1);
+
+    for(int i = 0; i < (int)lanes.size(); i++){
+        index_first_vehicles[i] = lanes[i]->lastOccupiedSite(0, lanes[i]->getSize() - 1);
+
+        // if all the road is crossed and no vehicle is found,
+        // send the result of the next process
+        if(index_first_vehicles[i] == -1){
+            index_first_vehicles[i] = next_process_indices[i];
+        }
+    }
+#ifdef DEBUG
+    printf("process: %d, my first vehicles are in positions: ", this->getRank());
+    for(int i : index_first_vehicles){
+        printf("%d, ", i);
+    }
+    printf("\n");
+#endif
+    return index_first_vehicles;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_PROCESS_H
+#define CA_TRAFFIC_SIMULATION_PROCESS_H
+
+#include <vector>
+#include <map>
+#include <ostream>
+
+#include "Inputs.h"
+#include "Vehicle.h"
+
+/**
+ * Structure for a Vehicle crossing a junction of the network into a segment, with the Lane that it enters
+ */
+struct JunctionTransfer {
+    int segment;
+    int lane;
+    Vehicle* vehicle_ptr;
+};
+
+/**
+ * Structure for the data of a step that a process sends to a neighbour when it runs ahead optimistically, see
+ * TimeWarp. To the previous process, the boundary is its last vehicles, and to the next process, its first vehicles
+ * along with the Vehicles that move there.
+ */
+struct OptimisticMessage {
+    int source;
+    int step;
+    std::vector<int> boundary;
+    std::vector<int> migrant_lanes;
+    std::vector<Vehicle> migrants;
+};
+
+/**
+ * Interface for the communication between the processes of the simulation, each of which simulates a part of the road
+ * or of the network. Implemented by MpiProcess, where the processes are MPI ranks, and by ThreadProcess, where the
+ * processes are threads of a single program that exchange the boundary data through shared memory. A part of a single
+ * road is a segment of its length, and may be only a group of its Lanes, with the groups of the other Lanes of the
+ * segment on the processes to its right (lower Lanes) and to its left (higher Lanes).
+ */
+class Process {
+protected:
+    int rank;
+    int next_rank;
+    int prev_rank;
+    int num_of_processes;
+    int num_lanes;
+
+    int road_start;
+    int road_end;
+    int first_lane;
+    int last_lane;
+    int right_rank;
+    int left_rank;
+    int num_lane_groups;
+    long peak_buffer_bytes;
+
+    void setRanks(int rank, int num_of_processes);
+    void setLanes(int first_lane, int last_lane, int right_rank, int left_rank, int num_lane_groups);
+    static int chooseLaneGroups(int num_of_processes, Inputs& inputs);
+    static int splitRange(int size, int num_parts, int part, int* first);
+    void recordBufferBytes(long bytes);
+
+public:
+    virtual ~Process() {}
+
+    int getRank();
+    int getNextRank();
+    int getPrevRank();
+    int getNumOfProcesses();
+    int getStartPosition();
+    int getEndPosition();
+    int getFirstLane();
+    int getLastLane();
+    int getRightRank();
+    int getLeftRank();
+    int getNumLaneGroups();
+    bool allowSending(std::vector<Vehicle *>& vehicles, std::vector<Vehicle *>& vehicles_to_send, Vehicle *newVehicle);
+    long getPeakBufferBytes();
+    std::vector<int> findLastVehicles(std::vector<Lane*>& lanes, std::vector<int>& prev_process_indices);
+    std::vector<int> findFirstVehicles(std::vector<Lane*>& lanes, std::vector<int>& next_process_indices);
+    virtual long getPeakResidentBytes();
+    virtual void reportCommunication(std::ostream& report) {}
+    virtual void setQuietExchange(int max_speed) {}
+    virtual bool isOneSided() { return false; }
+    virtual std::vector<std::vector<Vehicle *>> exchangeOneSided(std::vector<Lane*> lanes,
+                                                                 std::vector<Vehicle*>& migrants,
+                                                                 std::vector<int>& first_vehicles,
+                                                                 std::vector<int>& last_vehicles);
+    virtual std::vector<std::vector<int>> exchangeEdgeLanes(std::vector<int>& to_right, std::vector<int>& to_left);
+    virtual std::vector<std::vector<Vehicle *>> exchangeLaneChanges(std::vector<Vehicle *>& to_right,
+                                                                    std::vector<Vehicle *>& to_left);
+
+    virtual Inputs broadcastConfig(Config &config) = 0;
+    virtual void divideRoad(Inputs inputs) = 0;
+    virtual void sendVehicle(std::vector<Vehicle *>& vehicles) = 0;
+    virtual std::vector<std::vector<Vehicle *>> receiveVehicle() = 0;
+    virtual std::vector<int> recvLastVehicles() = 0;
+    virtual void sendLastVehicles(std::vector<Lane*> lanes, std::vector<int> prev_process_indices) = 0;
+    virtual std::vector<int> recvFirstVehicles() = 0;
+    virtual void sendFirstVehicles(std::vector<Lane*> lanes, std::vector<int> next_process_indices) = 0;
+    virtual std::map<int, std::vector<int>> exchangeSegmentSummaries(std::vector<int>& neighbours,
+                                                                     std::map<int, std::vector<int>>& summaries_to_send,
+                                                                     std::map<int, int>& summary_sizes) = 0;
+    virtual std::vector<JunctionTransfer> exchangeJunctionVehicles(std::vector<int>& neighbours,
+                                                                   std::map<int, std::vector<JunctionTransfer>>& transfers) = 0;
+    virtual std::vector<std::vector<Vehicle *>> exchangeHalo(std::vector<Vehicle *>& to_prev,
+                                                             std::vector<Vehicle *>& to_next) = 0;
+    virtual std::vector<int> exchangeTails(std::vector<int>& tails) = 0;
+    virtual std::vector<double> reduceSum(std::vector<double> values) = 0;
+    virtual std::vector<double> reduceMax(std::vector<double> values) = 0;
+    virtual std::vector<double> allReduceSum(std::vector<double> values) = 0;
+    virtual std::vector<double> allReduceMax(std::vector<double> values) = 0;
+    virtual std::vector<double> gather(std::vector<double> values) = 0;
+    virtual void sendOptimistic(int destination, OptimisticMessage& message) = 0;
+    virtual bool receiveOptimistic(OptimisticMessage& message) = 0;
+};
+
+#endif //CA_TRAFFIC_SIMULATION_PROCESS_H
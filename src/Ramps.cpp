@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <climits>
+#include <stdexcept>
+
+#include "Ramps.h"
+#include "Road.h"
+#include "Vehicle.h"
+#include "VehicleClass.h"
+#include "Random.h"
+#include "Process.h"
+
+/**
+ * Destructor for the Ramps
+ */
+Ramps::~Ramps() {
+    for (Ramp& ramp : this->ramps) {
+        delete ramp.interarrival_time_cdf;
+    }
+}
+
+/**
+ * Loads the ramps of the road from a file, with one ramp per line given as "on,<position>,<lane>,<cdf file>" for an
+ * on-ramp, with the file of the CDF of its interarrival times, or as "off,<position>,<lane>,<probability>" for an
+ * off-ramp, with the probability that a Vehicle passing over it leaves the road. The file is optional.
+ * @param file_name name of the file
+ * @param inputs instance of the Inputs class with the simulation Inputs
+ * @return 0 if successful, 1 if there is no file, 2 if the file is malformed
+ */
+int Ramps::loadFromFile(std::string file_name, Inputs inputs) {
+    // Open the file containing the ramps, which is optional
+    std::ifstream file(file_name);
+    if (!file) {
+        return 1;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::vector<std::string> fields;
+        std::stringstream line_stream(line);
+        std::string field;
+        while (std::getline(line_stream, field, ',')) {
+            fields.push_back(field);
+        }
+
+        bool valid = fields.size() == 4 && (fields[0] == "on" || fields[0] == "off");
+        Ramp ramp = {false, 0, 0, nullptr, 0.0, 0, 0, 0};
+        // A field that is not a number makes the line malformed
+        try {
+            if (valid) {
+                ramp.on_ramp = fields[0] == "on";
+                ramp.position = std::stoi(fields[1]);
+                ramp.lane = std::stoi(fields[2]);
+                valid = ramp.position >= 0 && ramp.position < inputs.length && ramp.lane >= 0 &&
+                        ramp.lane < inputs.num_lanes;
+            }
+            if (valid && !ramp.on_ramp) {
+                ramp.prob_exit = std::stod(fields[3]);
+                valid = ramp.prob_exit >= 0.0 && ramp.prob_exit <= 1.0;
+            }
+        } catch (const std::logic_error&) {
+            valid = false;
+        }
+        if (!valid) {
+            std::cout << "error: malformed line \"" << line << "\" in " << file_name << " file!" << std::endl;
+            return 2;
+        }
+        if (ramp.on_ramp) {
+            ramp.interarrival_time_cdf = new CDF();
+            if (ramp.interarrival_time_cdf->read_cdf(fields[3]) != 0) {
+                delete ramp.interarrival_time_cdf;
+                return 2;
+            }
+        }
+        this->ramps.push_back(ramp);
+    }
+
+    // Give the Vehicles of each on-ramp a range of ids of its own, above the ids of the Vehicles spawned at the start
+    int id_range = this->getSpawnIdRange();
+    int n = 0;
+    for (Ramp& ramp : this->ramps) {
+        if (ramp.on_ramp) {
+            ramp.next_id = (++n) * id_range;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Gets the size of the range of ids of the Vehicles spawned at the start of the road, and of each on-ramp above it
+ * @return number of ids of the range
+ */
+int Ramps::getSpawnIdRange() {
+    int num_on_ramps = 0;
+    for (Ramp& ramp : this->ramps) {
+        num_on_ramps += ramp.on_ramp;
+    }
+    return INT_MAX / (num_on_ramps + 1);
+}
+
+/**
+ * Checks if the road has no ramps
+ * @return whether the road has no ramps
+ */
+bool Ramps::isEmpty() {
+    return this->ramps.empty();
+}
+
+/**
+ * Checks if the road has any on-ramp
+ * @return whether the road has an on-ramp
+ */
+bool Ramps::hasOnRamps() {
+    for (Ramp& ramp : this->ramps) {
+        if (ramp.on_ramp) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Attempts to spawn Vehicles at the on-ramps in the part of the road of the current process. As at the start of the
+ * road, a Vehicle that is due waits until the cell of the on-ramp is free.
+ * @param road_ptr pointer to the Road
+ * @param vehicles pointer to the list of Vehicles to add the spawned Vehicles to
+ * @param start_position first site of the part of the road of the current process
+ * @param end_position last site of the part of the road of the current process
+ * @param first_lane first Lane of the part of the road of the current process
+ * @param last_lane last Lane of the part of the road of the current process
+ * @param step_size time of a step, in the units of the interarrival times
+ * @return number of spawned Vehicles
+ */
+int Ramps::attemptSpawn(Road* road_ptr, std::vector<Vehicle*>* vehicles, int start_position, int end_position,
+                        int first_lane, int last_lane, double step_size) {
+    int num_spawned = 0;
+    for (Ramp& ramp : this->ramps) {
+        if (!ramp.on_ramp || ramp.position < start_position || ramp.position > end_position ||
+            ramp.lane < first_lane || ramp.lane > last_lane) {
+            continue;
+        }
+        if (ramp.steps_to_spawn > 0) {
+            ramp.steps_to_spawn--;
+            continue;
+        }
+        Lane* lane_ptr = road_ptr->getLane(ramp.lane);
+        if (lane_ptr->hasVehicleInSite(ramp.position)) {
+            continue;
+        }
+
+#ifdef DEBUG
+        std::cout << "creating vehicle " << ramp.next_id << " in lane " << ramp.lane << " at on-ramp site "
+                  << ramp.position << std::endl;
+#endif
+        int id = ramp.next_id++;
+        Vehicle* vehicle_ptr = new Vehicle(lane_ptr, id, ramp.position,
+                                           VehicleClass::sampleClass(vehicleUniform(id, 0, STREAM_RAMP_CLASS)));
+        lane_ptr->addVehicle(ramp.position, vehicle_ptr);
+        vehicles->push_back(vehicle_ptr);
+        if (vehicleUniform(id, 0, STREAM_RAMP_ENTRY) < VehicleClass::table[vehicle_ptr->getClassId()].prob_slow_down) {
+            vehicle_ptr->setSpeed(0);
+        }
+        ramp.steps_to_spawn = (int) (ramp.interarrival_time_cdf->query(vehicleUniform(id, 0, STREAM_RAMP_ARRIVAL))
+                                     / step_size);
+        ramp.count++;
+        num_spawned++;
+    }
+    return num_spawned;
+}
+
+/**
+ * Checks if a Vehicle leaves the road at an off-ramp of its Lane that it passes over in its move, and counts it for
+ * the off-ramp if it does. A Vehicle draws once for each off-ramp.
+ * @param vehicle_ptr pointer to the Vehicle, before its move
+ * @param new_position position of the Vehicle after its move
+ * @param start_position first site of the part of the road of the current process, whose Vehicles are counted
+ * @param end_position last site of the part of the road of the current process
+ * @return whether the Vehicle leaves the road
+ */
+bool Ramps::takesExit(Vehicle* vehicle_ptr, int new_position, int start_position, int end_position) {
+    int position = vehicle_ptr->getPosition();
+    int lane = vehicle_ptr->getLanePtr()->getLaneNumber();
+    for (int r = 0; r < (int) this->ramps.size(); r++) {
+        Ramp& ramp = this->ramps[r];
+        if (ramp.on_ramp || ramp.lane != lane || ramp.position <= position || ramp.position > new_position) {
+            continue;
+        }
+        if (vehicleUniform(vehicle_ptr->getId(), r, STREAM_RAMP_EXIT) < ramp.prob_exit) {
+#ifdef DEBUG
+            std::cout << "vehicle " << vehicle_ptr->getId() << " left at off-ramp site " << ramp.position << std::endl;
+#endif
+            if (position >= start_position && position <= end_position) {
+                ramp.count++;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Prints the number of Vehicles that entered at each on-ramp and left at each off-ramp, summed over the processes
+ * @param curr_process pointer to the current process
+ */
+void Ramps::report(Process* curr_process) {
+    if (this->ramps.empty()) {
+        return;
+    }
+    std::vector<double> counts;
+    for (Ramp& ramp : this->ramps) {
+        counts.push_back(ramp.count);
+    }
+    std::vector<double> sums = curr_process->reduceSum(counts);
+    if (curr_process->getRank() != 0) {
+        return;
+    }
+    std::ostringstream report;
+    report << "--- Ramps ---" << std::endl;
+    for (int r = 0; r < (int) this->ramps.size(); r++) {
+        Ramp& ramp = this->ramps[r];
+        report << (ramp.on_ramp ? "on-ramp" : "off-ramp") << " at site " << ramp.position << " of lane " << ramp.lane
+               << ": " << (long) sums[r] << " vehicles " << (ramp.on_ramp ? "entered" : "left") << std::endl;
+    }
+    std::cout << report.str();
+}
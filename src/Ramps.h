@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_RAMPS_H
+#define CA_TRAFFIC_SIMULATION_RAMPS_H
+
+#include <vector>
+#include <string>
+
+#include "Inputs.h"
+#include "CDF.h"
+
+// Forward Declarations
+class Road;
+class Vehicle;
+class Process;
+
+/**
+ * Structure for a ramp of the road at a cell of a Lane. An on-ramp spawns Vehicles into its cell with the interarrival
+ * times of its own CDF, and an off-ramp takes the Vehicles that pass over its cell off the road with its exit
+ * probability.
+ */
+struct Ramp {
+    bool on_ramp;
+    int position;
+    int lane;
+    CDF* interarrival_time_cdf;
+    double prob_exit;
+    int next_id;
+    int steps_to_spawn;
+    long count;
+};
+
+/**
+ * Class for the on-ramps and off-ramps of a single road. Every process knows all the ramps, and handles the ramps in
+ * its own part of the road: it spawns the Vehicles of its on-ramps and takes its Vehicles off at the off-ramps. The
+ * random draws of a ramp are keyed by the ids of its Vehicles, and the ids of the Vehicles of each on-ramp are a range
+ * of their own, so that the results do not depend on the process that handles a ramp.
+ */
+class Ramps {
+private:
+    std::vector<Ramp> ramps;
+public:
+    ~Ramps();
+    int loadFromFile(std::string file_name, Inputs inputs);
+    bool isEmpty();
+    bool hasOnRamps();
+    int getSpawnIdRange();
+    int attemptSpawn(Road* road_ptr, std::vector<Vehicle*>* vehicles, int start_position, int end_position,
+                     int first_lane, int last_lane, double step_size);
+    bool takesExit(Vehicle* vehicle_ptr, int new_position, int start_position, int end_position);
+    void report(Process* curr_process);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_RAMPS_H
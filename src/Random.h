@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_RANDOM_H
+#define CA_TRAFFIC_SIMULATION_RANDOM_H
+
+#include <cstdlib>
+
+// Seed of the random number generator of the current thread. Each thread has its own state, so that the processes of
+// the threaded backend do not contend on the shared state of std::rand.
+inline thread_local unsigned int random_seed = 1;
+
+/**
+ * Seeds the random number generator of the current thread
+ * @param seed the seed
+ */
+inline void seedRandom(unsigned int seed) {
+    random_seed = seed;
+}
+
+/**
+ * Draws a random number from the random number generator of the current thread
+ * @return a uniformly distributed number in [0, 1]
+ */
+inline double randomUniform() {
+    return ((double) rand_r(&random_seed)) / ((double) RAND_MAX);
+}
+
+// Streams of the random draws of a Vehicle in a step
+const int STREAM_LANE_CHANGE = 0;
+const int STREAM_SLOW_DOWN = 1;
+
+// Streams of the random draws of the ramps for a Vehicle, which are drawn once for each Vehicle and ramp
+const int STREAM_RAMP_ARRIVAL = 2;
+const int STREAM_RAMP_ENTRY = 3;
+const int STREAM_RAMP_EXIT = 4;
+const int STREAM_RAMP_CLASS = 5;
+
+// Seed of the random draws of the Vehicles, the same on every process
+inline unsigned long long vehicle_seed = 0;
+
+/**
+ * Seeds the random draws of the Vehicles
+ * @param seed the seed, which must be the same on every process
+ */
+inline void seedVehicles(unsigned int seed) {
+    vehicle_seed = seed;
+}
+
+/**
+ * Draws a random number for a Vehicle from a counter-based generator, which hashes the id of the Vehicle, its time on
+ * the road and the stream of the draw. A Vehicle gets the same draws whichever process updates it and in whatever
+ * order, so that processes can update copies of the Vehicles of their neighbours and agree on the result.
+ * @param id id of the Vehicle
+ * @param time_on_road time of the Vehicle on the road
+ * @param stream stream of the draw
+ * @return a uniformly distributed number in [0, 1)
+ */
+inline double vehicleUniform(int id, int time_on_road, int stream) {
+    // Finalizer of splitmix64, applied to the key
+    unsigned long long x = vehicle_seed + 0x9e3779b97f4a7c15ULL * (((unsigned long long) (unsigned int) id << 32) |
+                                                                   (unsigned int) time_on_road)
+                           + 0xd1b54a32d192ed03ULL * (unsigned long long) (stream + 1);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x = x ^ (x >> 31);
+    return (double) (x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+#endif //CA_TRAFFIC_SIMULATION_RANDOM_H
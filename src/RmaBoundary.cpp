@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include "RmaBoundary.h"
+
+// Offsets in the inbox of the number of steps for which the previous and the next rank completed their deposits
+const int PREV_ARRIVED_OFFSET = 0;
+const int NEXT_ARRIVED_OFFSET = 1;
+
+// Number of counters at the start of the inbox
+const int NUM_COUNTERS = 2;
+
+/**
+ * Constructor for the RmaBoundary, which allocates the inbox windows and opens the passive target epoch. Must be
+ * called by all the ranks.
+ * @param rank rank of the process
+ * @param prev_rank rank of the previous process, or a negative number if there is none
+ * @param next_rank rank of the next process, or a negative number if there is none
+ * @param num_lanes number of lanes of the road, which is the size of the boundaries
+ * @param migrant_capacity number of values of the migrating Vehicles that fit in the inbox, which must hold all the
+ * Vehicles that can reach the next rank in a step
+ */
+RmaBoundary::RmaBoundary(int rank, int prev_rank, int next_rank, int num_lanes, int migrant_capacity) {
+    this->rank = rank;
+    this->prev_rank = prev_rank;
+    this->next_rank = next_rank;
+    this->num_lanes = num_lanes;
+    this->migrant_capacity = migrant_capacity;
+    this->num_steps = 0;
+
+    // The counters, then a buffer for even and one for odd steps, with the halos, the number of migrants and migrants
+    this->block_size = 2 * num_lanes + 1 + migrant_capacity;
+    int size = NUM_COUNTERS + 2 * this->block_size;
+    MPI_Win_allocate(size * sizeof(int), sizeof(int), MPI_INFO_NULL, MPI_COMM_WORLD, &this->inbox, &this->window);
+    for (int i = 0; i < size; i++) {
+        this->inbox[i] = 0;
+    }
+
+    MPI_Win_lock_all(0, this->window);
+    MPI_Win_sync(this->window);
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+/**
+ * Destructor for the RmaBoundary, which closes the epoch and frees the inbox windows. Must be called by all the ranks.
+ */
+RmaBoundary::~RmaBoundary() {
+    MPI_Win_unlock_all(this->window);
+    MPI_Win_free(&this->window);
+}
+
+int RmaBoundary::getFirstOffset(int buffer) { return NUM_COUNTERS + buffer * this->block_size; }
+
+int RmaBoundary::getLastOffset(int buffer) { return this->getFirstOffset(buffer) + this->num_lanes; }
+
+int RmaBoundary::getCountOffset(int buffer) { return this->getLastOffset(buffer) + this->num_lanes; }
+
+int RmaBoundary::getMigrantsOffset(int buffer) { return this->getCountOffset(buffer) + 1; }
+
+/**
+ * Deposits the boundaries of this rank and its migrants into the inboxes of its neighbours, notifies them, waits for
+ * the notifications of the neighbours, and takes their deposits out of the inbox of this rank. Each neighbour has its
+ * own counter, so that a neighbour that is a step ahead does not stand in for the other one. A neighbour deposits into
+ * a buffer again two steps later, after this rank has notified it once more, so that this rank has taken the deposits
+ * out of the buffer by then.
+ * @param first_to_next the first Vehicles of this rank, for the next rank
+ * @param last_to_prev the last Vehicles of this rank, for the previous rank
+ * @param migrants_to_next the packed Vehicles that move to the next rank
+ * @param first_from_prev where to take the first Vehicles of the previous rank, left as is if there is none
+ * @param last_from_next where to take the last Vehicles of the next rank, left as is if there is none
+ * @param migrants_from_prev where to take the packed Vehicles that move from the previous rank
+ */
+void RmaBoundary::exchange(std::vector<int>& first_to_next, std::vector<int>& last_to_prev,
+                           std::vector<int>& migrants_to_next, std::vector<int>& first_from_prev,
+                           std::vector<int>& last_from_next, std::vector<int>& migrants_from_prev) {
+    int buffer = this->num_steps % 2;
+
+    // Deposit into the inboxes of the neighbours
+    if (this->next_rank >= 0) {
+        int count = migrants_to_next.size();
+        MPI_Put(first_to_next.data(), this->num_lanes, MPI_INT, this->next_rank, this->getFirstOffset(buffer),
+                this->num_lanes, MPI_INT, this->window);
+        if (count > 0) {
+            MPI_Put(migrants_to_next.data(), count, MPI_INT, this->next_rank, this->getMigrantsOffset(buffer), count,
+                    MPI_INT, this->window);
+        }
+        MPI_Accumulate(&count, 1, MPI_INT, this->next_rank, this->getCountOffset(buffer), 1, MPI_INT, MPI_SUM,
+                       this->window);
+    }
+    if (this->prev_rank >= 0) {
+        MPI_Put(last_to_prev.data(), this->num_lanes, MPI_INT, this->prev_rank, this->getLastOffset(buffer),
+                this->num_lanes, MPI_INT, this->window);
+    }
+    MPI_Win_flush_all(this->window);
+
+    // Notify the neighbours, once the deposits are complete at the targets, this rank is the next rank of the previous
+    // one and the previous rank of the next one
+    int one = 1;
+    if (this->prev_rank >= 0) {
+        MPI_Accumulate(&one, 1, MPI_INT, this->prev_rank, NEXT_ARRIVED_OFFSET, 1, MPI_INT, MPI_SUM, this->window);
+    }
+    if (this->next_rank >= 0) {
+        MPI_Accumulate(&one, 1, MPI_INT, this->next_rank, PREV_ARRIVED_OFFSET, 1, MPI_INT, MPI_SUM, this->window);
+    }
+    MPI_Win_flush_all(this->window);
+
+    // Wait for the notifications of the neighbours for this step, which is the synchronisation point of the step
+    this->num_steps++;
+    int counters[2][2] = {{this->prev_rank, PREV_ARRIVED_OFFSET}, {this->next_rank, NEXT_ARRIVED_OFFSET}};
+    for (int* counter : counters) {
+        int arrived = counter[0] >= 0 ? 0 : this->num_steps;
+        while (arrived < this->num_steps) {
+            MPI_Fetch_and_op(nullptr, &arrived, MPI_INT, this->rank, counter[1], MPI_NO_OP, this->window);
+            MPI_Win_flush(this->rank, this->window);
+        }
+    }
+    MPI_Win_sync(this->window);
+
+    // Take the deposits out of the inbox
+    if (this->prev_rank >= 0) {
+        int* first = this->inbox + this->getFirstOffset(buffer);
+        first_from_prev.assign(first, first + this->num_lanes);
+
+        int* count = this->inbox + this->getCountOffset(buffer);
+        int* migrants = this->inbox + this->getMigrantsOffset(buffer);
+        migrants_from_prev.assign(migrants, migrants + *count);
+        *count = 0;
+    }
+    if (this->next_rank >= 0) {
+        int* last = this->inbox + this->getLastOffset(buffer);
+        last_from_next.assign(last, last + this->num_lanes);
+    }
+    MPI_Win_sync(this->window);
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_RMABOUNDARY_H
+#define CA_TRAFFIC_SIMULATION_RMABOUNDARY_H
+
+#include <mpi.h>
+#include <vector>
+
+/**
+ * Class for the one-sided exchange of the boundaries and the migrating Vehicles of a road between neighbouring ranks.
+ * Each rank exposes an inbox window, with a halo of the boundaries of its neighbours and the migrants of the previous
+ * rank, into which the neighbours deposit with MPI_Put, and MPI_Accumulate for the number of migrants, inside a
+ * passive target epoch that lasts the whole simulation. The inbox is double-buffered by step, so that the only
+ * synchronisation of a step is the notification of each neighbour, on a counter of its own, that its deposit is
+ * complete.
+ */
+class RmaBoundary {
+private:
+    MPI_Win window;
+    int* inbox;
+    int rank;
+    int prev_rank;
+    int next_rank;
+    int num_lanes;
+    int migrant_capacity;
+    int block_size;
+    int num_steps;
+
+    int getFirstOffset(int buffer);
+    int getLastOffset(int buffer);
+    int getCountOffset(int buffer);
+    int getMigrantsOffset(int buffer);
+public:
+    RmaBoundary(int rank, int prev_rank, int next_rank, int num_lanes, int migrant_capacity);
+    ~RmaBoundary();
+    void exchange(std::vector<int>& first_to_next, std::vector<int>& last_to_prev, std::vector<int>& migrants_to_next,
+                  std::vector<int>& first_from_prev, std::vector<int>& last_from_next,
+                  std::vector<int>& migrants_from_prev);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_RMABOUNDARY_H
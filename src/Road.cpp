@@ -5,18 +5,24 @@
 #include "Road.h"
 #include "Inputs.h"
 #include "Vehicle.h"
+#include "ArrivalTrace.h"
+
+// Fraction of occupied sites below which the Road stores only the occupied sites, and above which it stores all sites
+const double SPARSE_ENTER_DENSITY = 0.05;
+const double SPARSE_EXIT_DENSITY = 0.10;
 
 /**
- * Constructor for the Road
+ * Constructor for the Road, with sparse Lanes unless the Road is expected to be dense
  * @param inputs instance of the Inputs class with simulation inputs
  */
 Road::Road(Inputs inputs) {
+    bool sparse = inputs.percent_full < 100.0 * SPARSE_EXIT_DENSITY;
 #ifdef DEBUG
     std::cout << "creating new road with " << inputs.num_lanes << " lanes..." << std::endl;
 #endif
     // Create the Lane objects for the Road
     for (int i = 0; i < inputs.num_lanes; i++) {
-        this->lanes.push_back(new Lane(inputs, i));
+        this->lanes.push_back(new Lane(inputs, i, sparse));
     }
 #ifdef DEBUG
     std::cout << "done creating road" << std::endl;
@@ -27,6 +33,9 @@ Road::Road(Inputs inputs) {
     if (status != 0) {
         throw std::exception();
     }
+
+    // Vehicles arrive with the interarrival times unless a trace of arrivals is set
+    this->arrival_trace_ptr = nullptr;
 }
 
 /**
@@ -48,14 +57,117 @@ std::vector<Lane*> Road::getLanes() {
 }
 
 /**
- * Attempts to spawn Vehicles on each Lane of the Road
+ * Getter for a single Lane of the road, without copying the list of Lanes
+ * @param lane_num the number of the Lane
+ * @return pointer to the Lane
+ */
+Lane* Road::getLane(int lane_num) {
+    return this->lanes[lane_num];
+}
+
+/**
+ * Getter for the number of Lanes of the road
+ * @return number of Lanes
+ */
+int Road::getNumLanes() {
+    return this->lanes.size();
+}
+
+/**
+ * Getter for the storage mode of the Lanes of the Road
+ * @return whether the Lanes only store their occupied sites
+ */
+bool Road::isSparse() {
+    return this->lanes[0]->isSparse();
+}
+
+/**
+ * Switches all the Lanes of the Road between the dense and the sparse storage
+ * @param sparse whether the Lanes should only store their occupied sites
+ */
+void Road::setSparse(bool sparse) {
+    for (int i = 0; i < (int) this->lanes.size(); i++) {
+        this->lanes[i]->setSparse(sparse);
+    }
+}
+
+/**
+ * Selects the storage of the Lanes from the observed density of the Road, with a hysteresis between the two thresholds
+ * to avoid switching back and forth
+ * @param density fraction of the sites of the Road that are occupied
+ * @return whether the storage of the Lanes was switched
+ */
+bool Road::updateStorage(double density) {
+    if (this->isSparse() && density > SPARSE_EXIT_DENSITY) {
+        this->setSparse(false);
+        return true;
+    }
+    if (!this->isSparse() && density < SPARSE_ENTER_DENSITY) {
+        this->setSparse(true);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Sets the detectors of the Lanes of the Road
+ * @param detectors_ptr pointer to the detectors of the process
+ * @param segment index of the segment of the Road
+ */
+void Road::setDetectors(Detectors* detectors_ptr, int segment) {
+    for (int i = 0; i < (int) this->lanes.size(); i++) {
+        this->lanes[i]->setDetectors(detectors_ptr, detectors_ptr->getCells(segment));
+    }
+}
+
+/**
+ * Sets the range of sites from which the moves of the Vehicles are recorded over the detectors of the Lanes
+ * @param first_site first site of the range
+ * @param last_site last site of the range
+ */
+void Road::setRecordedRange(int first_site, int last_site) {
+    for (int i = 0; i < (int) this->lanes.size(); i++) {
+        this->lanes[i]->setRecordedRange(first_site, last_site);
+    }
+}
+
+/**
+ * Estimates the memory allocated for the sites of the Lanes of the Road
+ * @return number of bytes allocated for the Lanes
+ */
+long Road::getMemoryUsage() {
+    long bytes = sizeof(Road);
+    for (int i = 0; i < (int) this->lanes.size(); i++) {
+        bytes += this->lanes[i]->getMemoryUsage();
+    }
+    return bytes;
+}
+
+/**
+ * Sets the trace of recorded arrivals that replaces the interarrival times at the start of the Road
+ * @param arrival_trace_ptr pointer to the trace of arrivals of the process
+ */
+void Road::setArrivalTrace(ArrivalTrace* arrival_trace_ptr) {
+    this->arrival_trace_ptr = arrival_trace_ptr;
+}
+
+/**
+ * Attempts to spawn Vehicles on each Lane of a group of Lanes of the Road, from the trace of arrivals if there is one
  * @param inputs instance of the Inputs class with the simulation Inputs
  * @param vehicles pointer to the array of Vehicles that exist
  * @param next_id_ptr pointer to the id of the next spawned Vehicle
+ * @param first_lane first Lane of the group
+ * @param last_lane last Lane of the group
  * @return 0 if successful, nonzero otherwise
  */
-int Road::attemptSpawn(Inputs inputs, std::vector<Vehicle*>* vehicles, int* next_id_ptr, std::vector<int> last_vehicles) {
-    for (int i = 0; i < (int) this->lanes.size(); i++) {
+int Road::attemptSpawn(Inputs inputs, std::vector<Vehicle*>* vehicles, int* next_id_ptr, std::vector<int> last_vehicles,
+                       int first_lane, int last_lane) {
+    if (this->arrival_trace_ptr != nullptr) {
+        this->arrival_trace_ptr->attemptSpawn(this, vehicles, next_id_ptr, last_vehicles, first_lane, last_lane,
+                                              inputs.step_size);
+        return 0;
+    }
+    for (int i = first_lane; i <= last_lane; i++) {
         this->lanes[i]->attemptSpawn(inputs, vehicles, next_id_ptr, this->interarrival_time_cdf, last_vehicles);
     }
 
@@ -11,22 +11,37 @@
 #include "Inputs.h"
 #include "CDF.h"
 
+// Number of steps between the checks of the observed density of a Road, which switch the storage of its Lanes
+const int ENGINE_CHECK_INTERVAL = 100;
+
 // Forward Declarations
 class Vehicle;
+class ArrivalTrace;
 
 /**
  * Class for the Road in the Simulation. The road has multiple Lanes that each contain Vehicles. Has methods to attempt
- * spawning Vehicles in the Lanes
+ * spawning Vehicles in the Lanes, with the interarrival times or with the arrivals of a trace
  */
 class Road {
 private:
     std::vector<Lane*> lanes;
     CDF* interarrival_time_cdf;
+    ArrivalTrace* arrival_trace_ptr;
 public:
     Road(Inputs inputs);
     ~Road();
     std::vector<Lane*> getLanes();
-    int attemptSpawn(Inputs inputs, std::vector<Vehicle*>* vehicles, int* next_id_ptr, std::vector<int> last_vehicles);
+    Lane* getLane(int lane_num);
+    int getNumLanes();
+    bool isSparse();
+    void setSparse(bool sparse);
+    bool updateStorage(double density);
+    void setDetectors(Detectors* detectors_ptr, int segment);
+    void setRecordedRange(int first_site, int last_site);
+    void setArrivalTrace(ArrivalTrace* arrival_trace_ptr);
+    long getMemoryUsage();
+    int attemptSpawn(Inputs inputs, std::vector<Vehicle*>* vehicles, int* next_id_ptr, std::vector<int> last_vehicles,
+                     int first_lane, int last_lane);
     int attemptSpawn(int lane_num, Vehicle* vehicle_ptr, std::vector<Vehicle*>* vehicles);
 #ifdef DEBUG
     void printRoad();
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_RULEPOLICIES_H
+#define CA_TRAFFIC_SIMULATION_RULEPOLICIES_H
+
+#include "Inputs.h"
+#include "VehicleClass.h"
+
+// Ids of the rule policies in the simulation inputs
+const int RULES_RICKERT = 0;
+const int RULES_SLOW_TO_START = 1;
+const int RULES_CRUISE_CONTROL = 2;
+const int RULES_ASYMMETRIC = 3;
+
+/**
+ * Rule policy for the symmetric two lane rules of Rickert et al. with the Nagel-Schreckenberg speed update, which are
+ * the rules of the original simulation
+ */
+struct RickertRules {
+    /**
+     * Probability that the Vehicle slows down randomly after accelerating and braking
+     * @param vehicle_class class of the Vehicle
+     * @param speed speed of the Vehicle at the start of the step
+     * @param max_speed maximum speed of the Vehicle
+     * @return the slow down probability
+     */
+    static inline double slowDownProbability(const VehicleClass& vehicle_class, int speed, int max_speed) {
+        return vehicle_class.prob_slow_down;
+    }
+
+    /**
+     * Incentive criterion of the lane change, the safety criterion is checked separately
+     * @param speed speed of the Vehicle
+     * @param gap_forward gap to the preceding Vehicle in the current Lane
+     * @param gap_other_forward gap to the preceding Vehicle in the other Lane
+     * @param to_left whether the other Lane is to the left of the current Lane
+     * @return whether the Vehicle wants to change lanes
+     */
+    static inline bool wantsLaneChange(int speed, int gap_forward, int gap_other_forward, bool to_left) {
+        return gap_forward < speed + 1 && gap_other_forward > speed + 1;
+    }
+};
+
+/**
+ * Rule policy for the velocity dependent randomization (VDR) rules, where stopped Vehicles are slow to start with a
+ * separate slow down probability, which produces metastable jams
+ */
+struct SlowToStartRules : RickertRules {
+    static inline double slowDownProbability(const VehicleClass& vehicle_class, int speed, int max_speed) {
+        return speed == 0 ? vehicle_class.prob_slow_to_start : vehicle_class.prob_slow_down;
+    }
+};
+
+/**
+ * Rule policy for the cruise control rules, where Vehicles that travel at their maximum speed do not slow down
+ * randomly
+ */
+struct CruiseControlRules : RickertRules {
+    static inline double slowDownProbability(const VehicleClass& vehicle_class, int speed, int max_speed) {
+        return speed == max_speed ? 0.0 : vehicle_class.prob_slow_down;
+    }
+};
+
+/**
+ * Rule policy for the asymmetric lane change rules, where Vehicles only pass on the left Lane and return to the right
+ * Lane whenever there is room for them, whether or not they are blocked in the left Lane. Lane 0 is the right lane.
+ */
+struct AsymmetricRules : RickertRules {
+    static inline bool wantsLaneChange(int speed, int gap_forward, int gap_other_forward, bool to_left) {
+        if (to_left) {
+            return gap_forward < speed + 1 && gap_other_forward > speed + 1;
+        }
+        return gap_other_forward > speed + 1;
+    }
+};
+
+/**
+ * Bundle of a rule policy with the constants of the simulation that are known at compile time, which the update kernel
+ * is templated on. A constant of zero means that it is only known at run time.
+ */
+template <class Rules, int NumLanes, int MaxSpeed>
+struct RuleSet {
+    typedef Rules rules;
+    static const int num_lanes = NumLanes;
+    static const int max_speed = MaxSpeed;
+};
+
+/**
+ * Determines the Lane that a Vehicle considers changing into. With two lanes it is always the other lane. With more
+ * lanes, the Vehicles look to the left on even steps and to the right on odd steps, so that two Vehicles never change
+ * into the same site from both sides.
+ * @param lane_num number of the current Lane of the Vehicle
+ * @param num_lanes number of lanes of the Road, used if NumLanes is zero
+ * @param time current step of the simulation
+ * @return number of the other Lane, or -1 if there is none
+ */
+template <int NumLanes>
+inline int targetLane(int lane_num, int num_lanes, int time) {
+    const int lanes = NumLanes != 0 ? NumLanes : num_lanes;
+    if (lanes == 2) {
+        return 1 - lane_num;
+    }
+    int target = time % 2 == 0 ? lane_num + 1 : lane_num - 1;
+    return (target >= 0 && target < lanes) ? target : -1;
+}
+
+/**
+ * Helper for dispatchRules that specializes the maximum speed for the Nagel-Schreckenberg value of 5 and the value of
+ * 10 of the sample inputs, when all the Vehicle classes share it
+ */
+template <class Rules, int NumLanes, class Runner>
+int dispatchMaxSpeed(const Inputs& inputs, Runner runner) {
+    int max_speed = VehicleClass::table[0].max_speed;
+    for (const VehicleClass& vehicle_class : VehicleClass::table) {
+        if (vehicle_class.max_speed != max_speed) {
+            max_speed = 0;
+        }
+    }
+
+    switch (max_speed) {
+        case 5:
+            return runner(RuleSet<Rules, NumLanes, 5>());
+        case 10:
+            return runner(RuleSet<Rules, NumLanes, 10>());
+        default:
+            return runner(RuleSet<Rules, NumLanes, 0>());
+    }
+}
+
+/**
+ * Helper for dispatchRules that specializes the number of lanes for two lane roads
+ */
+template <class Rules, class Runner>
+int dispatchNumLanes(const Inputs& inputs, Runner runner) {
+    if (inputs.num_lanes == 2) {
+        return dispatchMaxSpeed<Rules, 2>(inputs, runner);
+    }
+    return dispatchMaxSpeed<Rules, 0>(inputs, runner);
+}
+
+/**
+ * Selects the rule policy and the compile time constants from the simulation inputs once, and calls the runner with
+ * the matching RuleSet so that it runs a loop that is fully specialized for them. The rules were checked when the
+ * inputs were loaded.
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param runner generic callable that takes a RuleSet instance and returns a status
+ * @return the status returned by the runner
+ */
+template <class Runner>
+int dispatchRules(const Inputs& inputs, Runner runner) {
+    switch (inputs.rules) {
+        case RULES_SLOW_TO_START:
+            return dispatchNumLanes<SlowToStartRules>(inputs, runner);
+        case RULES_CRUISE_CONTROL:
+            return dispatchNumLanes<CruiseControlRules>(inputs, runner);
+        case RULES_ASYMMETRIC:
+            return dispatchNumLanes<AsymmetricRules>(inputs, runner);
+        case RULES_RICKERT:
+        default:
+            return dispatchNumLanes<RickertRules>(inputs, runner);
+    }
+}
+
+// Explicitly instantiates the templated methods of the update kernel for every RuleSet that dispatchRules can select,
+// where INSTANTIATE is a variadic macro since the RuleSet type contains commas
+#define INSTANTIATE_RULE_SETS_FOR(INSTANTIATE, Rules) \
+    INSTANTIATE(RuleSet<Rules, 2, 5>) INSTANTIATE(RuleSet<Rules, 2, 10>) INSTANTIATE(RuleSet<Rules, 2, 0>) \
+    INSTANTIATE(RuleSet<Rules, 0, 5>) INSTANTIATE(RuleSet<Rules, 0, 10>) INSTANTIATE(RuleSet<Rules, 0, 0>)
+#define INSTANTIATE_RULE_SETS(INSTANTIATE) \
+    INSTANTIATE_RULE_SETS_FOR(INSTANTIATE, RickertRules) \
+    INSTANTIATE_RULE_SETS_FOR(INSTANTIATE, SlowToStartRules) \
+    INSTANTIATE_RULE_SETS_FOR(INSTANTIATE, CruiseControlRules) \
+    INSTANTIATE_RULE_SETS_FOR(INSTANTIATE, AsymmetricRules)
+
+
+#endif //CA_TRAFFIC_SIMULATION_RULEPOLICIES_H
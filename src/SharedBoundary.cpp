@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <new>
+#include <thread>
+#include <cstring>
+
+#include "SharedBoundary.h"
+
+// Alignment of the slots in the shared memory, so that no two slots share a cache line
+const int SLOT_ALIGNMENT = 64;
+
+/**
+ * Rounds a number of bytes up to the alignment of the slots
+ * @param bytes the number of bytes
+ * @return the smallest multiple of the alignment that holds the bytes
+ */
+long alignSlot(long bytes) {
+    return (bytes + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+}
+
+/**
+ * Finds the rank on the node of a rank of the simulation
+ * @param node_comm communicator of the ranks on the node
+ * @param rank rank of the simulation, or a negative number for no rank
+ * @return the rank on the node, or MPI_UNDEFINED if the rank is not on the node
+ */
+int findNodeRank(MPI_Comm node_comm, int rank) {
+    if (rank < 0) {
+        return MPI_UNDEFINED;
+    }
+    MPI_Group world_group, node_group;
+    MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+    MPI_Comm_group(node_comm, &node_group);
+    int node_rank;
+    MPI_Group_translate_ranks(world_group, 1, &rank, node_group, &node_rank);
+    MPI_Group_free(&world_group);
+    MPI_Group_free(&node_group);
+    return node_rank;
+}
+
+/**
+ * Constructor for the SharedBoundary, which allocates the shared memory of the ranks of each node and finds the slots
+ * of the neighbours on the same node. Must be called by all the ranks.
+ * @param prev_rank rank of the previous process, or a negative number if there is none
+ * @param next_rank rank of the next process, or a negative number if there is none
+ * @param num_lanes number of lanes of the road, which is the size of the boundary messages
+ * @param migrant_capacity number of values of the migrating Vehicles that fit in the shared memory
+ */
+SharedBoundary::SharedBoundary(int prev_rank, int next_rank, int num_lanes, int migrant_capacity) {
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &this->node_comm);
+
+    // Lay out the slots one after the other, at the same offsets on every rank
+    this->capacities[SLOT_FIRST_VEHICLES] = num_lanes;
+    this->capacities[SLOT_LAST_VEHICLES] = num_lanes;
+    this->capacities[SLOT_MIGRANTS] = migrant_capacity;
+    long offsets[NUM_SLOTS];
+    long size = 0;
+    for (int slot = 0; slot < NUM_SLOTS; slot++) {
+        offsets[slot] = size;
+        size += alignSlot(sizeof(SlotHeader)) + alignSlot(this->capacities[slot] * sizeof(int));
+    }
+
+    char* base;
+    MPI_Win_allocate_shared(size, 1, MPI_INFO_NULL, this->node_comm, &base, &this->window);
+    for (int slot = 0; slot < NUM_SLOTS; slot++) {
+        this->own_slots[slot] = new(base + offsets[slot]) SlotHeader();
+        this->own_slots[slot]->written.store(0);
+        this->own_slots[slot]->read.store(0);
+        this->num_written[slot] = 0;
+        this->num_read[slot] = 0;
+    }
+
+    // Find the slots of the neighbours on the same node, which are written directly
+    int neighbours[2] = {findNodeRank(this->node_comm, prev_rank), findNodeRank(this->node_comm, next_rank)};
+    SlotHeader** neighbour_slots[2] = {this->prev_slots, this->next_slots};
+    for (int i = 0; i < 2; i++) {
+        char* neighbour_base = nullptr;
+        if (neighbours[i] != MPI_UNDEFINED) {
+            MPI_Aint neighbour_size;
+            int disp_unit;
+            MPI_Win_shared_query(this->window, neighbours[i], &neighbour_size, &disp_unit, &neighbour_base);
+        }
+        for (int slot = 0; slot < NUM_SLOTS; slot++) {
+            neighbour_slots[i][slot] = neighbour_base == nullptr ? nullptr
+                                                                 : (SlotHeader*) (neighbour_base + offsets[slot]);
+        }
+    }
+
+    // The step flags are atomics, so the window stays open for the whole simulation
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, this->window);
+    MPI_Barrier(this->node_comm);
+}
+
+/**
+ * Destructor for the SharedBoundary, which frees the shared memory. Must be called by all the ranks.
+ */
+SharedBoundary::~SharedBoundary() {
+    MPI_Win_unlock_all(this->window);
+    MPI_Win_free(&this->window);
+    MPI_Comm_free(&this->node_comm);
+}
+
+/**
+ * Get the values of a slot, which follow its header
+ * @param header pointer to the header of the slot
+ * @return pointer to the values of the slot
+ */
+int* SharedBoundary::getValues(SlotHeader* header) {
+    return (int*) ((char*) header + alignSlot(sizeof(SlotHeader)));
+}
+
+/**
+ * Stores a message directly into the slot of the neighbour that receives it, once the neighbour has read the previous
+ * message of the slot. The first Vehicles and the migrants go to the next rank, the last Vehicles to the previous rank.
+ * @param slot the slot of the message
+ * @param values the message
+ * @return true if the message was stored, false if the neighbour is on another node or the message is too large for
+ * the slot, in which case it must be sent with MPI
+ */
+bool SharedBoundary::put(int slot, std::vector<int>& values) {
+    SlotHeader* header = slot == SLOT_LAST_VEHICLES ? this->prev_slots[slot] : this->next_slots[slot];
+    if (header == nullptr) {
+        return false;
+    }
+
+    while (header->read.load(std::memory_order_acquire) != this->num_written[slot]) {
+        std::this_thread::yield();
+    }
+
+    bool fits = (int) values.size() <= this->capacities[slot];
+    header->count = fits ? values.size() : -1;
+    if (fits) {
+        memcpy(this->getValues(header), values.data(), values.size() * sizeof(int));
+    }
+    header->written.store(++this->num_written[slot], std::memory_order_release);
+    return fits;
+}
+
+/**
+ * Loads a message directly from a slot of this rank, once the neighbour has stored it
+ * @param slot the slot of the message
+ * @param values where to load the message
+ * @return true if the message was loaded, false if the neighbour is on another node or the message was too large for
+ * the slot, in which case it must be received with MPI
+ */
+bool SharedBoundary::get(int slot, std::vector<int>& values) {
+    SlotHeader* writer = slot == SLOT_LAST_VEHICLES ? this->next_slots[slot] : this->prev_slots[slot];
+    if (writer == nullptr) {
+        return false;
+    }
+
+    SlotHeader* header = this->own_slots[slot];
+    this->num_read[slot]++;
+    while (header->written.load(std::memory_order_acquire) != this->num_read[slot]) {
+        std::this_thread::yield();
+    }
+
+    int count = header->count;
+    if (count >= 0) {
+        int* slot_values = this->getValues(header);
+        values.assign(slot_values, slot_values + count);
+    }
+    header->read.store(this->num_read[slot], std::memory_order_release);
+    return count >= 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_SHAREDBOUNDARY_H
+#define CA_TRAFFIC_SIMULATION_SHAREDBOUNDARY_H
+
+#include <mpi.h>
+#include <atomic>
+#include <vector>
+
+// Slots of the shared memory of a rank, each written by one of its neighbours
+const int SLOT_FIRST_VEHICLES = 0;
+const int SLOT_LAST_VEHICLES = 1;
+const int SLOT_MIGRANTS = 2;
+const int NUM_SLOTS = 3;
+
+/**
+ * Structure for the header of a slot of the shared memory, with the number of messages written into it and read out
+ * of it, which act as the step flags of the exchange, and the number of values of the current message
+ */
+struct SlotHeader {
+    alignas(64) std::atomic<long> written;
+    alignas(64) std::atomic<long> read;
+    int count;
+};
+
+/**
+ * Class for the boundary exchange of the ranks of a road with their neighbours on the same node, through an MPI shared
+ * memory window. Each rank has a slot for each message that it receives from its neighbours, which the neighbour
+ * stores into directly and the rank loads from directly, so the data is copied once and never goes through MPI. A
+ * message that does not fit in its slot is marked as such, and goes through MPI instead.
+ */
+class SharedBoundary {
+private:
+    MPI_Comm node_comm;
+    MPI_Win window;
+    int capacities[NUM_SLOTS];
+    SlotHeader* own_slots[NUM_SLOTS];
+    SlotHeader* prev_slots[NUM_SLOTS];
+    SlotHeader* next_slots[NUM_SLOTS];
+    long num_written[NUM_SLOTS];
+    long num_read[NUM_SLOTS];
+
+    int* getValues(SlotHeader* header);
+public:
+    SharedBoundary(int prev_rank, int next_rank, int num_lanes, int migrant_capacity);
+    ~SharedBoundary();
+    bool put(int slot, std::vector<int>& values);
+    bool get(int slot, std::vector<int>& values);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_SHAREDBOUNDARY_H
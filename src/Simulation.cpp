@@ -3,32 +3,62 @@
  */
 
 #include <chrono>
+#include <sstream>
 #include <algorithm>
 #include <cmath>
 #include <unordered_set>
+#include <stdexcept>
 
 #include "Road.h"
 #include "Simulation.h"
 #include "Vehicle.h"
-
+#include "RulePolicies.h"
+#include "Tracer.h"
+#include "PhaseCounters.h"
+#include "Random.h"
 
 /**
  * Constructor for the Simulation
  * @param inputs
+ * @param detectors_ptr pointer to the detectors of the process
+ * @param ramps_ptr pointer to the ramps of the road of the process
+ * @param arrival_trace_ptr pointer to the trace of arrivals at the start of the road of the process
+ * @param jams_ptr pointer to the jams tracked on the road
  */
-Simulation::Simulation(Inputs inputs) {
+Simulation::Simulation(Inputs inputs, Detectors* detectors_ptr, Ramps* ramps_ptr, ArrivalTrace* arrival_trace_ptr,
+                       Jams* jams_ptr) {
 
-    // Create the Road object for the simulation
+    // Create the Road object for the simulation, with the detectors of segment 0
     this->road_ptr = new Road(inputs);
+    this->detectors_ptr = detectors_ptr;
+    this->road_ptr->setDetectors(detectors_ptr, 0);
+    this->ramps_ptr = ramps_ptr;
+    this->arrival_trace_ptr = arrival_trace_ptr;
+    this->jams_ptr = jams_ptr;
+    if (!arrival_trace_ptr->isEmpty()) {
+        this->road_ptr->setArrivalTrace(arrival_trace_ptr);
+    }
 
     // Initialize the first Vehicle id
     this->next_id = 0;
+    this->num_dropped = 0;
 
     // Obtain the simulation inputs
     this->inputs = inputs;
 
     // Initialize Statistic for travel time
     this->travel_time = new Statistic();
+
+    // Initialize the observables of the Road, as a single segment
+    this->observables = new Observables(inputs, {inputs.length});
+
+    // Initialize the memory report
+    this->memory_report = new MemoryReport(inputs);
+
+    // Initialize the lists of the Vehicles of each Lane, sorted by position
+    this->lane_vehicles.resize(inputs.num_lanes);
+    this->first_lane = 0;
+    this->last_lane = inputs.num_lanes - 1;
 }
 
 /**
@@ -38,10 +68,17 @@ Simulation::~Simulation() {
     // Delete the Road object in the simulation
     delete this->road_ptr;
 
-    // Delete all the Vehicle objects in the Simulation
+    // Delete all the Vehicle objects in the Simulation, including the ones still waiting to move to the next process
     for (int i = 0; i < (int) this->vehicles.size(); i++) {
         delete this->vehicles[i];
     }
+    for (int i = 0; i < (int) this->vehicles_to_send.size(); i++) {
+        delete this->vehicles_to_send[i];
+    }
+
+    delete this->travel_time;
+    delete this->observables;
+    delete this->memory_report;
 }
 
 /**
@@ -49,36 +86,131 @@ Simulation::~Simulation() {
  * @param num_threads number of threads to run the simulation with
  * @return 0 if successful, nonzero otherwise
  */
-int Simulation::run_simulation(MpiProcess *curr_proccess) {
+int Simulation::run_simulation(Process *curr_proccess) {
+    // Select the rule policy once, and run the loop specialized for it
+    return dispatchRules(this->inputs, [&](auto rule_set) {
+        return this->run_loop<decltype(rule_set)>(curr_proccess);
+    });
+}
+
+/**
+ * Executes the simulation loop with the update kernel specialized for a rule policy
+ * @param curr_proccess pointer to the current process
+ * @return 0 if successful, nonzero otherwise
+ */
+template <class RuleSet>
+int Simulation::run_loop(Process *curr_proccess) {
+    this->memory_report->report("start", this->getMemoryUsage(curr_proccess), curr_proccess);
+
     // Obtain the start time
     std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 
     // Set the simulation time to zero
     this->time = 0;
 
-    // Declare a vector for vehicles to be removed each step
+    // The process may only have a group of the Lanes of its segment, and then exchanges the Vehicles of the edge Lanes
+    // and the lane changes across them with the processes of the neighbouring groups every step
+    this->first_lane = curr_proccess->getFirstLane();
+    this->last_lane = curr_proccess->getLastLane();
+    bool lane_groups = curr_proccess->getNumLaneGroups() > 1;
+
+    // Each group of Lanes spawns Vehicles at the start of the road, with a range of ids of its own. The groups of a
+    // segment are on consecutive processes.
+    int lane_group = curr_proccess->getRank() % curr_proccess->getNumLaneGroups();
+    this->next_id = this->ramps_ptr->getSpawnIdRange() / curr_proccess->getNumLaneGroups() * lane_group;
+
+    // Declare vectors for vehicles to be removed each step, at the end of the road and at the off-ramps
     std::vector<int> vehicles_to_remove;
+    std::vector<int> ramp_exits;
 
-    while (this->time < this->inputs.max_time) {
-        std::vector<int> last_vehicles = {-1, -1};
-        std::vector<int> first_vehicles = {-1, -1};
+    // With a one-sided transport, the Vehicles move between the processes along with the boundaries of the next step
+    bool one_sided = curr_proccess->isOneSided();
+    std::vector<int> last_vehicles(this->inputs.num_lanes, -1);
+    std::vector<int> first_vehicles(this->inputs.num_lanes, -1);
 
-        // Receive the last vehicles of the next process
-        if(curr_proccess->getRank() != curr_proccess->getNumOfProcesses()-1){
-            last_vehicles = curr_proccess->recvLastVehicles();
+    // With temporal blocking, the processes exchange deep halos every few steps instead of boundaries every step. The
+    // processes do not know the Vehicles that the on-ramps or the lane changes of their neighbours add to their halos,
+    // so roads with on-ramps or with groups of Lanes exchange every step.
+    bool blocked = this->inputs.exchange_interval > 1;
+    if (blocked && (this->ramps_ptr->hasOnRamps() || lane_groups)) {
+        blocked = false;
+        if (curr_proccess->getRank() == 0) {
+            std::cout << "Simulation : roads with on-ramps or groups of lanes exchange every step, ignoring the "
+                      << "exchange interval" << std::endl;
+        }
+    }
+    int halo = 0;
+    if (blocked) {
+        halo = this->inputs.exchange_interval * this->getHaloLength();
+        if (curr_proccess->getEndPosition() - curr_proccess->getStartPosition() + 1 <= halo) {
+            throw std::runtime_error("The part of the road of a process is not longer than the halo of "
+                                     + std::to_string(halo) + " sites, use a smaller exchange interval");
         }
+        this->road_ptr->setRecordedRange(curr_proccess->getStartPosition(), curr_proccess->getEndPosition());
+    }
 
-        // Send the last vehicles to the previous process
-        if(curr_proccess->getRank() != 0){
-            curr_proccess->sendLastVehicles(this->road_ptr->getLanes(), last_vehicles);
+    // With an optimistic window, the processes run ahead of each other on the boundaries they expect, and roll back
+    // the steps that the data of their neighbours contradicts. The outputs sampled every step cannot be taken back,
+    // so only plain roads run optimistically.
+    bool optimistic = this->inputs.optimistic_window > 0;
+    if (optimistic && (blocked || one_sided || lane_groups || !this->ramps_ptr->isEmpty() ||
+                       this->detectors_ptr->isEnabled() || this->jams_ptr->isEnabled() ||
+                       !this->arrival_trace_ptr->isEmpty() || this->observables->isEnabled())) {
+        optimistic = false;
+        if (curr_proccess->getRank() == 0) {
+            std::cout << "Simulation : roads with ramps, detectors, jams, observables, an arrival trace, groups of lanes "
+                      << "or other exchanges run in lockstep, ignoring the optimistic window" << std::endl;
+        }
+    }
+    TimeWarp time_warp(this->inputs, curr_proccess, this->getHaloLength());
+
+    // The optimistic execution runs all the steps, and skips the loop below. Otherwise, without on-ramps, Vehicles only
+    // enter the road at its start and cannot move faster than the maximum speed, so the processes can tell the steps
+    // in which no Vehicle reaches a neighbour, and skip their exchanges.
+    if (optimistic) {
+        this->runOptimistic<RuleSet>(curr_proccess, time_warp);
+    } else if (!blocked && !one_sided && !lane_groups && !this->ramps_ptr->hasOnRamps()) {
+        curr_proccess->setQuietExchange(this->getMaxSpeed());
+    }
 
-            first_vehicles = curr_proccess->recvFirstVehicles();
+    while (this->time < this->inputs.max_time) {
+        TraceScope step_trace("step");
+        if (blocked) {
+            this->stepBlocked<RuleSet>(curr_proccess, halo);
+            continue;
         }
 
-        // Send the last vehicles to the previous process
-        if(curr_proccess->getRank() != curr_proccess->getNumOfProcesses()-1){
-            curr_proccess->sendFirstVehicles(this->road_ptr->getLanes(), first_vehicles);
+        PhaseScope phase_trace("boundaries");
+        if (one_sided) {
+            TraceScope trace("exchangeOneSided");
+            this->exchangeOneSided(curr_proccess, first_vehicles, last_vehicles);
+        } else {
+            // Receive the last vehicles of the next process
+            if(curr_proccess->getNextRank() != -1){
+                TraceScope trace("recvLastVehicles");
+                last_vehicles = curr_proccess->recvLastVehicles();
+            }
+
+            // Send the last vehicles to the previous process
+            if(curr_proccess->getPrevRank() != -1){
+                TraceScope trace("sendLastVehicles");
+                curr_proccess->sendLastVehicles(this->road_ptr->getLanes(), last_vehicles);
+
+                trace.next("recvFirstVehicles");
+                first_vehicles = curr_proccess->recvFirstVehicles();
+            }
+
+            // Send the last vehicles to the previous process
+            if(curr_proccess->getNextRank() != -1){
+                TraceScope trace("sendFirstVehicles");
+                curr_proccess->sendFirstVehicles(this->road_ptr->getLanes(), first_vehicles);
+            }
         }
+        if (lane_groups) {
+            TraceScope trace("exchangeEdgeLanes");
+            this->exchangeEdgeLanes(curr_proccess, first_vehicles, last_vehicles);
+        }
+        phase_trace.next("lane changes");
 
 #ifdef DEBUG
         if(this->vehicles.size() > 0){
@@ -89,16 +221,19 @@ int Simulation::run_simulation(MpiProcess *curr_proccess) {
 #endif
        
         // Perform the lane switch step for all vehicles
-        for (int n = 0; n < (int) this->vehicles.size(); n++) {
-            this->vehicles[n]->updateGaps(this->road_ptr, curr_proccess->getStartPosition(),
-                        curr_proccess->getEndPosition(), first_vehicles, last_vehicles);
+        this->updateGaps<RuleSet>(curr_proccess->getStartPosition(), curr_proccess->getEndPosition(), first_vehicles,
+                                  last_vehicles);
 #ifdef DEBUG
+        for (int n = 0; n < (int) this->vehicles.size(); n++) {
             this->vehicles[n]->printGaps();
+        }
 #endif
-        }   
 
-        for (int n = 0; n < (int) this->vehicles.size(); n++) {
-            this->vehicles[n]->performLaneSwitch(this->road_ptr);
+        this->switchLanes<RuleSet>();
+        if (lane_groups) {
+            TraceScope trace("exchangeLaneChanges");
+            this->removeGhosts();
+            this->exchangeLaneChanges(curr_proccess);
         }
 
 #ifdef DEBUG
@@ -107,34 +242,38 @@ int Simulation::run_simulation(MpiProcess *curr_proccess) {
             std::cout << "performing lane movements..." << std::endl;
         }
 #endif
+        phase_trace.next("lane moves");
 
-        // Perform the independent lane updates
-        for (int n = 0; n < (int) this->vehicles.size(); n++) {
-            this->vehicles[n]->updateGaps(this->road_ptr, curr_proccess->getStartPosition(),
-                        curr_proccess->getEndPosition(), first_vehicles, last_vehicles);
+        // Perform the independent lane updates, after updating the gaps that the lane changes changed. The lane changes
+        // of the neighbouring groups of Lanes change the Lanes too, so the gaps of all the Vehicles are updated then.
+        if (lane_groups) {
+            this->updateGaps<RuleSet>(curr_proccess->getStartPosition(), curr_proccess->getEndPosition(),
+                                      first_vehicles, last_vehicles);
+        } else {
+            this->updateChangedGaps(curr_proccess->getEndPosition(), last_vehicles);
+        }
 #ifdef DEBUG
+        for (int n = 0; n < (int) this->vehicles.size(); n++) {
             this->vehicles[n]->printGaps();
-#endif
         }
+#endif
 
-        for (int n = 0; n < (int) this->vehicles.size(); n++) {
-            int time_on_road = this->vehicles[n]->performLaneMove();
-
-            if (time_on_road != 0) {
-                    vehicles_to_remove.push_back(n);
-            }
-        }
+        this->moveVehicles<RuleSet>(vehicles_to_remove, ramp_exits, curr_proccess->getStartPosition(),
+                                    curr_proccess->getEndPosition());
+        vehicles_to_remove.insert(vehicles_to_remove.end(), ramp_exits.begin(), ramp_exits.end());
 
 
         // End of iteration steps
         // Increment time
         this->time++;
+        phase_trace.next("removals");
 
         // Remove finished vehicles
         std::sort(vehicles_to_remove.begin(), vehicles_to_remove.end());
         for (int i = vehicles_to_remove.size() - 1; i >= 0; i--) {
-            // Update travel time statistic if beyond warm-up period
-            if (this->time > this->inputs.warmup_time) {
+            // Update travel time statistic if beyond warm-up period, for the Vehicles that reached the end of the road
+            if (this->time > this->inputs.warmup_time &&
+                !std::binary_search(ramp_exits.begin(), ramp_exits.end(), vehicles_to_remove[i])) {
                 this->travel_time->addValue(this->vehicles[vehicles_to_remove[i]]->getTravelTime(this->inputs));
             }
 
@@ -143,22 +282,63 @@ int Simulation::run_simulation(MpiProcess *curr_proccess) {
             this->vehicles.erase(this->vehicles.begin() + vehicles_to_remove[i]);
         }
         vehicles_to_remove.clear();
+        ramp_exits.clear();
 
-        // If this is process 0, attempt to spawn new vehicles in the road
-        if(curr_proccess->getRank() == 0){
-            this->road_ptr->attemptSpawn(this->inputs, &(this->vehicles), &(this->next_id), last_vehicles);
+        // Sample the observables before the Vehicles move between the processes
+        phase_trace.next("observables");
+        this->observables->addVehicles(0, this->vehicles);
+        this->observables->endStep(this->time, curr_proccess);
+        this->detectors_ptr->endStep(this->time, this->inputs.max_time, curr_proccess);
+        this->jams_ptr->endStep(this->time, this->inputs.max_time, this->vehicles, curr_proccess->getStartPosition(),
+                                curr_proccess->getEndPosition(), this->first_lane, this->last_lane, curr_proccess);
+
+        // Periodically switch the Lane storage based on the observed density
+        if (this->time % ENGINE_CHECK_INTERVAL == 0) {
+            this->selectEngine(curr_proccess);
         }
 
-         // Receive the vehicles from the previous process (if this is not process 0)
-        if(curr_proccess->getRank() != 0){
-            receiveVehicles(curr_proccess);
+        // If this is the first segment, attempt to spawn new vehicles in its lanes
+        phase_trace.next("spawn");
+        if(curr_proccess->getPrevRank() == -1){
+            this->road_ptr->attemptSpawn(this->inputs, &(this->vehicles), &(this->next_id), last_vehicles,
+                                         this->first_lane, this->last_lane);
         }
-        
-        // Send the vehicles to the next process (if this is not the last process)
-        if(curr_proccess->getRank() != curr_proccess->getNumOfProcesses()-1){
-            sendVehicles(curr_proccess);
-            // empty the vector
-            this->vehicles_to_send.clear();
+
+        phase_trace.next("migration");
+        if (one_sided) {
+            // Take the vehicles for the next process off the road, they move with the exchange of the next step
+            if(curr_proccess->getNextRank() != -1){
+                sendVehicles(curr_proccess);
+            }
+        } else {
+            // Receive the vehicles from the previous process (if this is not the first segment)
+            if(curr_proccess->getPrevRank() != -1){
+                TraceScope trace("receiveVehicles");
+                receiveVehicles(curr_proccess);
+            }
+
+            // Send the vehicles to the next process (if this is not the last segment)
+            if(curr_proccess->getNextRank() != -1){
+                TraceScope trace("sendVehicles");
+                sendVehicles(curr_proccess);
+                // empty the vector
+                this->vehicles_to_send.clear();
+            }
+        }
+
+        // Spawn the vehicles of the on-ramps in the part of the road of this process, after the vehicles from the
+        // previous process are placed, so that an on-ramp waits for a cell that one of them took
+        phase_trace.next("spawn");
+        this->ramps_ptr->attemptSpawn(this->road_ptr, &(this->vehicles), curr_proccess->getStartPosition(),
+                                      curr_proccess->getEndPosition(), this->first_lane, this->last_lane,
+                                      this->inputs.step_size);
+
+        phase_trace.next("memory report");
+        this->memory_report->trackVehicles(this->vehicles.size());
+        PhaseCounters::addVehicleUpdates(this->vehicles.size());
+        if (this->memory_report->isDue(this->time)) {
+            this->memory_report->report("step " + std::to_string(this->time), this->getMemoryUsage(curr_proccess),
+                                        curr_proccess);
         }
 
 #ifdef DEBUG
@@ -172,10 +352,24 @@ int Simulation::run_simulation(MpiProcess *curr_proccess) {
     // Print the total run time and average iterations per second and seconds per iteration
     std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
     auto time_elapsed = (std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()) /1000000.0;
-    std::cout << "--- Simulation Performance ---" << std::endl;
-    std::cout << "Process : " << curr_proccess->getRank() << " total computation time: " << time_elapsed << " [s]" << std::endl;
-    std::cout << "Process : " << curr_proccess->getRank() << " average time per iteration: " << time_elapsed / inputs.max_time << " [s]" << std::endl;
-    std::cout << "Process : " << curr_proccess->getRank() << " average iterating frequency: " << inputs.max_time / time_elapsed << " [iter/s]" << std::endl;
+    // Write the report in one piece, so that it is not interleaved with the reports of processes that are threads
+    std::ostringstream report;
+    report << "--- Simulation Performance ---" << std::endl;
+    report << "Process : " << curr_proccess->getRank() << " total computation time: " << time_elapsed << " [s]" << std::endl;
+    report << "Process : " << curr_proccess->getRank() << " average time per iteration: " << time_elapsed / inputs.max_time << " [s]" << std::endl;
+    report << "Process : " << curr_proccess->getRank() << " average iterating frequency: " << inputs.max_time / time_elapsed << " [iter/s]" << std::endl;
+    curr_proccess->reportCommunication(report);
+    if (this->num_dropped > 0) {
+        report << "Process : " << curr_proccess->getRank() << " vehicles dropped on arrival at an occupied site: "
+               << this->num_dropped << std::endl;
+    }
+    if (optimistic) {
+        time_warp.report(report, curr_proccess->getRank());
+    }
+    PhaseCounters::report(report, curr_proccess->getRank());
+    std::cout << report.str();
+
+    this->memory_report->report("end", this->getMemoryUsage(curr_proccess), curr_proccess);
 
 #ifdef DEBUG
     // Print final road configuration
@@ -183,22 +377,746 @@ int Simulation::run_simulation(MpiProcess *curr_proccess) {
     this->road_ptr->printRoad();
 #endif
 
-    // The last process calculates the final statistics
-    if(curr_proccess->getRank() == curr_proccess->getNumOfProcesses() - 1){
+    // The last process calculates the final statistics, or process 0 from the ones of the last segment of each group
+    // of Lanes
+    if (lane_groups) {
+        std::vector<double> values = this->travel_time->getValues();
+        double sum = 0.0;
+        double sum_squares = 0.0;
+        for (double value : values) {
+            sum += value;
+            sum_squares += value * value;
+        }
+        std::vector<double> totals = curr_proccess->reduceSum({sum, sum_squares, (double) values.size()});
+        if (curr_proccess->getRank() == 0) {
+            double n = totals[2];
+            double avg = totals[0] / n;
+            double variance = (totals[1] - n * avg * avg) / (n - 1.0);
+            std::cout << "--- Simulation Results ---" << std::endl;
+            std::cout << "Process : " << curr_proccess->getRank() << " time on road: avg=" << avg << ", std="
+                      << pow(variance, 0.5) << ", N=" << (int) n << std::endl;
+        }
+    } else if(curr_proccess->getRank() == curr_proccess->getNumOfProcesses() - 1){
      std::cout << "--- Simulation Results ---" << std::endl;
         std::cout << "Process : " << curr_proccess->getRank()<< " time on road: avg=" << this->travel_time->getAverage() << ", std="
                 << pow(this->travel_time->getVariance(), 0.5) << ", N=" << this->travel_time->getNumSamples()
                 << std::endl;
     }
+    this->ramps_ptr->report(curr_proccess);
+    this->arrival_trace_ptr->report(curr_proccess);
+    this->jams_ptr->report(curr_proccess);
 
     // Return with no errors
     return 0;
 }
 
 
-void Simulation::sendVehicles(MpiProcess *curr_proccess){
+/**
+ * Sorts the Vehicles by Lane, and by position within each Lane, into the lists of the Lanes. The Vehicles stay in this
+ * order between steps, since they do not overtake each other within a Lane, so the list of a Lane is a merge of a few
+ * sorted runs: the Vehicles that stayed in the Lane, the ones that changed into it, and the ones that arrived.
+ */
+void Simulation::sortVehicles() {
+    for (std::vector<Vehicle*>& lane_vehicles : this->lane_vehicles) {
+        lane_vehicles.clear();
+    }
+    for (Vehicle* vehicle : this->vehicles) {
+        this->lane_vehicles[vehicle->getLanePtr()->getLaneNumber()].push_back(vehicle);
+    }
+
+    // Merge each run into the sorted Vehicles before it
+    auto by_position = [](Vehicle* a, Vehicle* b) { return a->getPosition() < b->getPosition(); };
+    for (std::vector<Vehicle*>& lane_vehicles : this->lane_vehicles) {
+        int size = lane_vehicles.size();
+        int sorted = 1;
+        while (sorted < size) {
+            int run_end = sorted + 1;
+            while (run_end < size && !by_position(lane_vehicles[run_end], lane_vehicles[run_end - 1])) {
+                run_end++;
+            }
+            if (by_position(lane_vehicles[sorted], lane_vehicles[sorted - 1])) {
+                std::inplace_merge(lane_vehicles.begin(), lane_vehicles.begin() + sorted,
+                                   lane_vehicles.begin() + run_end, by_position);
+            }
+            sorted = run_end;
+        }
+    }
+
+    // Keep the order for the next step
+    this->vehicles.clear();
+    for (std::vector<Vehicle*>& lane_vehicles : this->lane_vehicles) {
+        this->vehicles.insert(this->vehicles.end(), lane_vehicles.begin(), lane_vehicles.end());
+    }
+}
+
+/**
+ * Updates the perceived gaps of all the Vehicles, from the lists of the Vehicles of each Lane sorted by position
+ * @param start_position first site of the segment of the Road of the current process
+ * @param end_position last site of the segment of the Road of the current process
+ * @param first_vehicles last occupied site of each Lane in the previous processes, or -1
+ * @param last_vehicles first occupied site of each Lane in the next processes, or -1
+ */
+template <class RuleSet>
+void Simulation::updateGaps(int start_position, int end_position, const std::vector<int>& first_vehicles,
+                            const std::vector<int>& last_vehicles) {
+    this->sortVehicles();
+    for (Vehicle& ghost : this->ghost_vehicles) {
+        this->lane_vehicles[ghost.getLanePtr()->getLaneNumber()].push_back(&ghost);
+    }
+    int num_lanes = this->road_ptr->getNumLanes();
+    for (int lane = 0; lane < num_lanes; lane++) {
+        int other_lane = targetLane<RuleSet::num_lanes>(lane, num_lanes, this->time);
+        Vehicle::updateLaneGaps(this->lane_vehicles[lane],
+                                other_lane == -1 ? nullptr : &this->lane_vehicles[other_lane], other_lane,
+                                start_position, end_position, first_vehicles, last_vehicles);
+    }
+}
+
+/**
+ * Performs the lane changes of all the Vehicles synchronously. Every Vehicle decides from the state of the Road at the
+ * start of the step into the next-state buffers, and the Lanes are only changed once all the Vehicles have decided, so
+ * the result does not depend on the order of the Vehicles. A lane change is only accepted into a site that is free at
+ * the start of the step, and of the Vehicles that change into the same site, the one from the lowest Lane wins. The
+ * Vehicles that change into a Lane outside the group of the process are taken off the road, to be sent to the process
+ * of their new Lane. All the Lanes change in the same direction in a step, so they never compete for a site with the
+ * Vehicles of that process.
+ */
+template <class RuleSet>
+void Simulation::switchLanes() {
+    int num_vehicles = this->vehicles.size();
+    this->next_lanes.resize(num_vehicles);
+    this->lane_claims.clear();
+    for (int n = 0; n < num_vehicles; n++) {
+        Vehicle* vehicle = this->vehicles[n];
+        this->next_lanes[n] = vehicle->decideLaneSwitch<RuleSet>(this->road_ptr, this->time);
+        if (this->next_lanes[n] != -1) {
+            this->lane_claims.push_back({this->next_lanes[n], vehicle->getPosition(),
+                                         vehicle->getLanePtr()->getLaneNumber(), n});
+        }
+    }
+    if (this->lane_claims.empty()) {
+        return;
+    }
+
+    // Resolve the claims on the same site in a fixed order
+    std::sort(this->lane_claims.begin(), this->lane_claims.end(), [](const LaneClaim& a, const LaneClaim& b) {
+        if (a.lane != b.lane) {
+            return a.lane < b.lane;
+        }
+        if (a.position != b.position) {
+            return a.position < b.position;
+        }
+        return a.from_lane < b.from_lane;
+    });
+    int accepted = 0;
+    for (int i = 0; i < (int) this->lane_claims.size(); i++) {
+        const LaneClaim& claim = this->lane_claims[i];
+        bool taken = accepted > 0 && this->lane_claims[accepted - 1].lane == claim.lane &&
+                     this->lane_claims[accepted - 1].position == claim.position;
+        if (!taken && !this->road_ptr->getLane(claim.lane)->hasVehicleInSite(claim.position)) {
+            this->lane_claims[accepted++] = claim;
+        }
+    }
+    this->lane_claims.resize(accepted);
+
+    // Vacate the sites of the current state before occupying the sites of the next state
+    for (const LaneClaim& claim : this->lane_claims) {
+        Vehicle* vehicle = this->vehicles[claim.vehicle];
+        vehicle->getLanePtr()->removeVehicle(claim.position);
+    }
+    bool migrants = false;
+    for (const LaneClaim& claim : this->lane_claims) {
+        Vehicle* vehicle = this->vehicles[claim.vehicle];
+        Lane* lane_ptr = this->road_ptr->getLane(claim.lane);
+        vehicle->setLanePtr(lane_ptr);
+        if (claim.lane < this->first_lane || claim.lane > this->last_lane) {
+            (claim.lane < this->first_lane ? this->migrants_to_right : this->migrants_to_left).push_back(vehicle);
+            this->vehicles[claim.vehicle] = nullptr;
+            migrants = true;
+            continue;
+        }
+        lane_ptr->addVehicle(claim.position, vehicle);
+    }
+    if (migrants) {
+        this->vehicles.erase(std::remove(this->vehicles.begin(), this->vehicles.end(), nullptr), this->vehicles.end());
+    }
+}
+
+/**
+ * Updates the gaps to the preceding Vehicles after the lane changes, which are all that the moves read, from the lists
+ * of the Lanes sorted before the lane changes and the accepted claims. Only the Vehicles that changed Lanes and the
+ * Vehicles behind the sites they left or took can have a new preceding Vehicle, so the gaps of the other Vehicles are
+ * still those of the pass before the lane changes. The gaps to the other Lane are not updated. The Vehicles are then
+ * sorted again, which only merges the Vehicles that changed Lanes. Only valid when the Lanes did not change otherwise,
+ * that is without groups of Lanes.
+ * @param end_position last site of the segment of the Road of the current process
+ * @param last_vehicles first occupied site of each Lane in the next processes, or -1
+ */
+void Simulation::updateChangedGaps(int end_position, const std::vector<int>& last_vehicles) {
+    if (this->lane_claims.empty()) {
+        return;
+    }
+
+    // The Vehicles are in the order of the lists of the Lanes, so the Vehicles of a Lane start at its offset
+    int num_lanes = this->lane_vehicles.size();
+    std::vector<int> offsets(num_lanes + 1, 0);
+    for (int lane = 0; lane < num_lanes; lane++) {
+        offsets[lane + 1] = offsets[lane] + this->lane_vehicles[lane].size();
+    }
+    this->changed_lane.assign(this->vehicles.size(), 0);
+    for (const LaneClaim& claim : this->lane_claims) {
+        this->changed_lane[claim.vehicle] = 1;
+    }
+
+    // Finds the first Vehicle ahead of a site of a Lane after the lane changes, which is either the first Vehicle that
+    // stayed in the Lane or the first Vehicle that changed into it
+    auto next_site = [this, &offsets](int lane, int position) {
+        const std::vector<Vehicle*>& list = this->lane_vehicles[lane];
+        int i = std::upper_bound(list.begin(), list.end(), position, [](int site, Vehicle* vehicle) {
+            return site < vehicle->getPosition();
+        }) - list.begin();
+        while (i < (int) list.size() && this->changed_lane[offsets[lane] + i]) {
+            i++;
+        }
+        int site = i < (int) list.size() ? list[i]->getPosition() : -1;
+        LaneClaim key = {lane, position, 0, 0};
+        std::vector<LaneClaim>::iterator claim = std::upper_bound(
+                this->lane_claims.begin(), this->lane_claims.end(), key, [](const LaneClaim& a, const LaneClaim& b) {
+                    return a.lane != b.lane ? a.lane < b.lane : a.position < b.position;
+                });
+        if (claim != this->lane_claims.end() && claim->lane == lane && (site == -1 || claim->position < site)) {
+            site = claim->position;
+        }
+        return site;
+    };
+
+    // Finds the last Vehicle behind a site of a Lane that stayed in the Lane
+    auto behind = [this, &offsets](int lane, int position) -> Vehicle* {
+        const std::vector<Vehicle*>& list = this->lane_vehicles[lane];
+        int i = std::lower_bound(list.begin(), list.end(), position, [](Vehicle* vehicle, int site) {
+            return vehicle->getPosition() < site;
+        }) - list.begin() - 1;
+        while (i >= 0 && this->changed_lane[offsets[lane] + i]) {
+            i--;
+        }
+        return i >= 0 ? list[i] : nullptr;
+    };
+
+    for (const LaneClaim& claim : this->lane_claims) {
+        this->vehicles[claim.vehicle]->updateForwardGap(next_site(claim.lane, claim.position), end_position,
+                                                        last_vehicles);
+        for (int lane : {claim.from_lane, claim.lane}) {
+            Vehicle* vehicle = behind(lane, claim.position);
+            if (vehicle != nullptr) {
+                vehicle->updateForwardGap(next_site(lane, vehicle->getPosition()), end_position, last_vehicles);
+            }
+        }
+    }
+
+    // The Vehicles that are sent to the next process are chosen in the order of the Lanes and positions
+    this->sortVehicles();
+}
+
+/**
+ * Moves all the Vehicles synchronously. Every Vehicle computes its next position from the state of the Road at the
+ * start of the step into the next-state buffer, and the Lanes are only changed once all the Vehicles have moved, so the
+ * result does not depend on the order of the Vehicles. The Vehicles that pass over an off-ramp may leave there instead.
+ * @param exited indices of the Vehicles that left at the end of the road, which keep their position before the move
+ * @param ramp_exits indices of the Vehicles that left at an off-ramp, which keep their position before the move
+ * @param start_position first site of the part of the road of the current process
+ * @param end_position last site of the part of the road of the current process
+ */
+template <class RuleSet>
+void Simulation::moveVehicles(std::vector<int>& exited, std::vector<int>& ramp_exits, int start_position,
+                              int end_position) {
+    int num_vehicles = this->vehicles.size();
+    bool off_ramps = !this->ramps_ptr->isEmpty();
+    this->next_positions.resize(num_vehicles);
+    for (int n = 0; n < num_vehicles; n++) {
+        Vehicle* vehicle = this->vehicles[n];
+        this->next_positions[n] = vehicle->advance<RuleSet>();
+        if (off_ramps && this->ramps_ptr->takesExit(vehicle, this->next_positions[n], start_position, end_position)) {
+            this->next_positions[n] = -1;
+        }
+    }
+
+    // On sparse Lanes, only the leaving Vehicles are taken off the Lanes, and the sites of the others are updated in
+    // one pass per Lane after the moves
+    if (this->road_ptr->isSparse()) {
+        for (int n = 0; n < num_vehicles; n++) {
+            Vehicle* vehicle = this->vehicles[n];
+            if (this->next_positions[n] == vehicle->getPosition()) {
+                continue;
+            }
+            if (this->next_positions[n] == -1) {
+                vehicle->getLanePtr()->removeVehicle(vehicle->getPosition());
+                ramp_exits.push_back(n);
+                continue;
+            }
+            if (this->next_positions[n] >= vehicle->getLanePtr()->getSize()) {
+                vehicle->getLanePtr()->removeVehicle(vehicle->getPosition());
+                exited.push_back(n);
+                continue;
+            }
+            vehicle->setPosition(this->next_positions[n]);
+        }
+        for (int i = this->first_lane; i <= this->last_lane; i++) {
+            this->road_ptr->getLane(i)->updateOccupants();
+        }
+        return;
+    }
 
-    for(int i = 0; i < (int)this->vehicles.size(); i++){
+    // Vacate the sites of the current state before occupying the sites of the next state
+    for (int n = 0; n < num_vehicles; n++) {
+        Vehicle* vehicle = this->vehicles[n];
+        if (this->next_positions[n] != vehicle->getPosition()) {
+            vehicle->getLanePtr()->removeVehicle(vehicle->getPosition());
+        }
+    }
+    for (int n = 0; n < num_vehicles; n++) {
+        Vehicle* vehicle = this->vehicles[n];
+        if (this->next_positions[n] == vehicle->getPosition()) {
+            continue;
+        }
+        if (this->next_positions[n] == -1) {
+            ramp_exits.push_back(n);
+            continue;
+        }
+        if (this->next_positions[n] >= vehicle->getLanePtr()->getSize()) {
+            exited.push_back(n);
+            continue;
+        }
+        vehicle->getLanePtr()->addVehicle(this->next_positions[n], vehicle);
+        vehicle->setPosition(this->next_positions[n]);
+    }
+}
+
+/**
+ * Exchanges the positions of the Vehicles of the edge Lanes of the group of Lanes of the current process with the
+ * processes of the neighbouring groups of its segment, along with the first and last Vehicles of the edge Lanes in the
+ * neighbouring segments. The Vehicles of the Lanes next to the group are placed on the road as ghosts until the lane
+ * changes of the step are decided, so that the Vehicles of the edge Lanes see them.
+ * @param curr_proccess pointer to the current process
+ * @param first_vehicles the first vehicles of the previous process, completed with the ones of the Lanes next to the
+ *                       group
+ * @param last_vehicles the last vehicles of the next process, completed with the ones of the Lanes next to the group
+ */
+void Simulation::exchangeEdgeLanes(Process *curr_proccess, std::vector<int>& first_vehicles,
+                                   std::vector<int>& last_vehicles) {
+    int edge_lanes[2] = {this->first_lane, this->last_lane};
+    std::vector<int> to_send[2];
+    for (int i = 0; i < 2; i++) {
+        to_send[i] = {first_vehicles[edge_lanes[i]], last_vehicles[edge_lanes[i]]};
+    }
+    for (Vehicle* vehicle : this->vehicles) {
+        int lane = vehicle->getLanePtr()->getLaneNumber();
+        for (int i = 0; i < 2; i++) {
+            if (lane == edge_lanes[i]) {
+                to_send[i].push_back(vehicle->getPosition());
+            }
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        std::sort(to_send[i].begin() + 2, to_send[i].end());
+    }
+    std::vector<std::vector<int>> received = curr_proccess->exchangeEdgeLanes(to_send[0], to_send[1]);
+
+    // The ghosts are allocated at once, since the Lanes point to them
+    int ghost_lanes[2] = {this->first_lane - 1, this->last_lane + 1};
+    int num_ghosts = 0;
+    for (int i = 0; i < 2; i++) {
+        num_ghosts += std::max(0, (int) received[i].size() - 2);
+    }
+    this->ghost_vehicles.resize(num_ghosts);
+    int ghost = 0;
+    for (int i = 0; i < 2; i++) {
+        if (received[i].empty()) {
+            continue;
+        }
+        Lane* lane_ptr = this->road_ptr->getLane(ghost_lanes[i]);
+        first_vehicles[ghost_lanes[i]] = received[i][0];
+        last_vehicles[ghost_lanes[i]] = received[i][1];
+        for (int k = 2; k < (int) received[i].size(); k++) {
+            Vehicle& ghost_vehicle = this->ghost_vehicles[ghost++];
+            ghost_vehicle.setLanePtr(lane_ptr);
+            ghost_vehicle.setPosition(received[i][k]);
+            lane_ptr->addVehicle(received[i][k], &ghost_vehicle);
+        }
+    }
+}
+
+/**
+ * Takes the ghosts of the Vehicles of the Lanes next to the group of Lanes of the current process off the road
+ */
+void Simulation::removeGhosts() {
+    for (Vehicle& ghost : this->ghost_vehicles) {
+        ghost.getLanePtr()->removeVehicle(ghost.getPosition());
+    }
+    this->ghost_vehicles.clear();
+}
+
+/**
+ * Sends the Vehicles that changed into the Lanes of the neighbouring groups of Lanes to their processes, and places the
+ * Vehicles that changed into the group of Lanes of the current process
+ * @param curr_proccess pointer to the current process
+ */
+void Simulation::exchangeLaneChanges(Process *curr_proccess) {
+    std::vector<std::vector<Vehicle *>> vehicles_to_recv =
+            curr_proccess->exchangeLaneChanges(this->migrants_to_right, this->migrants_to_left);
+    for (Vehicle* vehicle : this->migrants_to_right) {
+        delete vehicle;
+    }
+    for (Vehicle* vehicle : this->migrants_to_left) {
+        delete vehicle;
+    }
+    this->migrants_to_right.clear();
+    this->migrants_to_left.clear();
+
+    for (int i = 0; i < (int) vehicles_to_recv.size(); i++) {
+        for (Vehicle* vehicle : vehicles_to_recv[i]) {
+            this->road_ptr->attemptSpawn(i, vehicle, &(this->vehicles));
+        }
+    }
+}
+
+/**
+ * Gets the number of sites by which the part of the Road that a process knows exactly shrinks in a step, when the
+ * process does not know the Vehicles beyond it. A Vehicle looks ahead a lane change of the Vehicles in front of it and
+ * their move, and behind it for Vehicles in the other Lane and Vehicles that move into its site.
+ * @return the number of sites
+ */
+int Simulation::getHaloLength() {
+    int max_speed = this->getMaxSpeed();
+    int look_other_backward = this->inputs.look_other_backward;
+    for (const VehicleClass& vehicle_class : VehicleClass::table) {
+        look_other_backward = std::max(look_other_backward, vehicle_class.look_other_backward);
+    }
+    return max_speed + 1 + std::max(max_speed + 2, look_other_backward + 1);
+}
+
+/**
+ * Gets the largest number of sites that a Vehicle of any class moves in a step
+ * @return the number of sites
+ */
+int Simulation::getMaxSpeed() {
+    int max_speed = this->inputs.max_speed;
+    for (const VehicleClass& vehicle_class : VehicleClass::table) {
+        max_speed = std::max(max_speed, vehicle_class.max_speed);
+    }
+    return max_speed;
+}
+
+/**
+ * Executes a step of the simulation loop with temporal blocking. At the start of each block of steps, the process
+ * drops the Vehicles outside its part of the Road and exchanges copies of the Vehicles within a halo of its ends with
+ * its neighbours. It then updates the Vehicles of the halos along with its own, which keeps its own part exact for
+ * the whole block, since a Vehicle is owned by the process whose part of the Road it is in at the start of a block.
+ * @param curr_proccess pointer to the current process
+ * @param halo length of the halos, which covers the shrinking of the exact part of the Road over a block
+ */
+template <class RuleSet>
+void Simulation::stepBlocked(Process *curr_proccess, int halo) {
+    int start = curr_proccess->getStartPosition();
+    int end = curr_proccess->getEndPosition();
+    PhaseScope phase_trace("boundaries");
+    if (this->time % this->inputs.exchange_interval == 0) {
+        TraceScope trace("exchangeHalo");
+        this->exchangeHalo(curr_proccess, halo);
+    }
+    phase_trace.next("lane changes");
+
+    // The Vehicles see each other within the halos, and nothing beyond them
+    int first_site = std::max(0, start - halo);
+    int last_site = std::min(this->inputs.length - 1, end + halo);
+    std::vector<int> no_vehicles(this->inputs.num_lanes, -1);
+
+    this->updateGaps<RuleSet>(first_site, last_site, no_vehicles, no_vehicles);
+    this->switchLanes<RuleSet>();
+    this->updateChangedGaps(last_site, no_vehicles);
+
+    // Move the Vehicles, and only count the Vehicles of this process that leave the road
+    phase_trace.next("lane moves");
+    std::vector<int> exited;
+    std::vector<int> ramp_exits;
+    this->moveVehicles<RuleSet>(exited, ramp_exits, start, end);
+    std::vector<Vehicle*> remaining;
+    int next_exited = 0;
+    int next_ramp_exit = 0;
+    for (int n = 0; n < (int) this->vehicles.size(); n++) {
+        Vehicle* vehicle = this->vehicles[n];
+        if (next_ramp_exit < (int) ramp_exits.size() && ramp_exits[next_ramp_exit] == n) {
+            next_ramp_exit++;
+            delete vehicle;
+            continue;
+        }
+        if (next_exited == (int) exited.size() || exited[next_exited] != n) {
+            remaining.push_back(vehicle);
+            continue;
+        }
+        next_exited++;
+        if (vehicle->getPosition() >= start && vehicle->getPosition() <= end &&
+            this->time + 1 > this->inputs.warmup_time) {
+            this->travel_time->addValue(vehicle->getTravelTime(this->inputs));
+        }
+        delete vehicle;
+    }
+    this->vehicles.swap(remaining);
+    this->time++;
+
+    // Sample the observables of the Vehicles in the part of the Road of this process
+    phase_trace.next("observables");
+    std::vector<Vehicle*> owned;
+    for (Vehicle* vehicle : this->vehicles) {
+        if (vehicle->getPosition() >= start && vehicle->getPosition() <= end) {
+            owned.push_back(vehicle);
+        }
+    }
+    this->observables->addVehicles(0, owned);
+    this->observables->endStep(this->time, curr_proccess);
+    this->detectors_ptr->endStep(this->time, this->inputs.max_time, curr_proccess);
+    this->jams_ptr->endStep(this->time, this->inputs.max_time, owned, start, end, this->first_lane, this->last_lane,
+                            curr_proccess);
+
+    if (this->time % ENGINE_CHECK_INTERVAL == 0) {
+        this->selectEngine(curr_proccess);
+    }
+
+    // Process 0 spawns new Vehicles, which it owns
+    phase_trace.next("spawn");
+    if (curr_proccess->getRank() == 0) {
+        this->road_ptr->attemptSpawn(this->inputs, &(this->vehicles), &(this->next_id), no_vehicles, this->first_lane,
+                                     this->last_lane);
+    }
+
+    this->memory_report->trackVehicles(owned.size());
+    PhaseCounters::addVehicleUpdates(owned.size());
+    if (this->memory_report->isDue(this->time)) {
+        this->memory_report->report("step " + std::to_string(this->time), this->getMemoryUsage(curr_proccess),
+                                    curr_proccess);
+    }
+}
+
+/**
+ * Runs the simulation loop optimistically, up to the window of steps ahead of the global virtual time, see TimeWarp.
+ * Before each step, the process takes the messages of its neighbours and rolls back to the earliest step that used
+ * data that differs from them. At the end of the window, it computes the global virtual time with the other processes,
+ * which commits the steps that became final.
+ * @param curr_proccess pointer to the current process
+ * @param time_warp the optimistic execution of the current process
+ */
+template <class RuleSet>
+void Simulation::runOptimistic(Process *curr_proccess, TimeWarp& time_warp) {
+    OptimisticMessage message;
+    while (true) {
+        while (curr_proccess->receiveOptimistic(message)) {
+            time_warp.receive(message, this->time);
+        }
+        int step = time_warp.takeRollback();
+        if (step != -1) {
+            TraceScope trace("rollback");
+            WarpStep rolled_back = time_warp.rollBack(step, this->time);
+            this->restoreStep(rolled_back);
+            this->time = step;
+        }
+
+        if (time_warp.canRun(this->time)) {
+            TraceScope step_trace("step");
+            this->stepOptimistic<RuleSet>(curr_proccess, time_warp);
+            continue;
+        }
+        {
+            TraceScope trace("computeGvt");
+            time_warp.computeGvt(curr_proccess, this->time, this->travel_time);
+        }
+        if (time_warp.isFinished()) {
+            break;
+        }
+    }
+}
+
+/**
+ * Executes a step of the simulation loop optimistically, with the data of the neighbouring processes that the step is
+ * given, and saves the state at its start to roll back to. The Vehicles that leave the road count once the step is
+ * final, and the step sends its boundaries and the Vehicles that move on to the neighbouring processes.
+ * @param curr_proccess pointer to the current process
+ * @param time_warp the optimistic execution of the current process
+ */
+template <class RuleSet>
+void Simulation::stepOptimistic(Process *curr_proccess, TimeWarp& time_warp) {
+    int start = curr_proccess->getStartPosition();
+    int end = curr_proccess->getEndPosition();
+    int step_time = this->time;
+    PhaseScope phase_trace("boundaries");
+    WarpStep& step = time_warp.beginStep(step_time);
+    this->saveStep(step);
+    std::vector<Lane*> lanes = this->road_ptr->getLanes();
+    std::vector<int> last_vehicles = curr_proccess->findLastVehicles(lanes, step.last_vehicles);
+    std::vector<int> first_vehicles = curr_proccess->findFirstVehicles(lanes, step.first_vehicles);
+
+    phase_trace.next("lane changes");
+    this->updateGaps<RuleSet>(start, end, step.first_vehicles, step.last_vehicles);
+    this->switchLanes<RuleSet>();
+    this->updateChangedGaps(end, step.last_vehicles);
+
+    phase_trace.next("lane moves");
+    std::vector<int> vehicles_to_remove;
+    std::vector<int> ramp_exits;
+    this->moveVehicles<RuleSet>(vehicles_to_remove, ramp_exits, start, end);
+    this->time++;
+
+    // Remove finished vehicles, in the same order as the loop in lockstep
+    phase_trace.next("removals");
+    std::sort(vehicles_to_remove.begin(), vehicles_to_remove.end());
+    for (int i = vehicles_to_remove.size() - 1; i >= 0; i--) {
+        if (this->time > this->inputs.warmup_time) {
+            step.travel_times.push_back(this->vehicles[vehicles_to_remove[i]]->getTravelTime(this->inputs));
+        }
+        delete this->vehicles[vehicles_to_remove[i]];
+        this->vehicles.erase(this->vehicles.begin() + vehicles_to_remove[i]);
+    }
+
+    if (this->time % ENGINE_CHECK_INTERVAL == 0) {
+        this->selectEngine(curr_proccess);
+    }
+
+    phase_trace.next("spawn");
+    if (curr_proccess->getPrevRank() == -1) {
+        this->road_ptr->attemptSpawn(this->inputs, &(this->vehicles), &(this->next_id), step.last_vehicles,
+                                     this->first_lane, this->last_lane);
+    }
+
+    // Place copies of the Vehicles that moved from the previous process, which the step keeps to compare, and take
+    // the Vehicles that move on to the next process off the road
+    phase_trace.next("migration");
+    if (curr_proccess->getPrevRank() != -1) {
+        std::vector<std::vector<Vehicle *>> vehicles_to_recv(this->inputs.num_lanes);
+        for (int i = 0; i < (int) step.migrants.size(); i++) {
+            vehicles_to_recv[step.migrant_lanes[i]].push_back(new Vehicle(step.migrants[i]));
+        }
+        this->placeVehicles(curr_proccess, vehicles_to_recv);
+    }
+    if (curr_proccess->getNextRank() != -1) {
+        this->selectVehiclesToSend(curr_proccess);
+        this->removeSentVehicles(false);
+    }
+    time_warp.sendStep(curr_proccess, step_time, last_vehicles, first_vehicles, this->vehicles_to_send);
+    for (Vehicle* vehicle : this->vehicles_to_send) {
+        delete vehicle;
+    }
+    this->vehicles_to_send.clear();
+
+    PhaseCounters::addVehicleUpdates(this->vehicles.size());
+}
+
+/**
+ * Saves the state of the current process at the start of a step that runs optimistically: copies of its Vehicles, in
+ * their order, the steps until the next spawn in each Lane, the next Vehicle id, the number of dropped Vehicles and the
+ * random number generator
+ * @param step the step
+ */
+void Simulation::saveStep(WarpStep& step) {
+    step.vehicles.reserve(this->vehicles.size());
+    for (Vehicle* vehicle : this->vehicles) {
+        step.vehicles.push_back(*vehicle);
+    }
+    for (Lane* lane : this->road_ptr->getLanes()) {
+        step.steps_to_spawn.push_back(lane->getStepsToSpawn());
+    }
+    step.next_id = this->next_id;
+    step.num_dropped = this->num_dropped;
+    step.random_seed = random_seed;
+}
+
+/**
+ * Restores the state of the current process at the start of a step that is rolled back
+ * @param step the step
+ */
+void Simulation::restoreStep(WarpStep& step) {
+    for (Vehicle* vehicle : this->vehicles) {
+        vehicle->getLanePtr()->removeVehicle(vehicle->getPosition());
+        delete vehicle;
+    }
+    this->vehicles.clear();
+    for (Vehicle& saved : step.vehicles) {
+        Vehicle* vehicle = new Vehicle(saved);
+        vehicle->getLanePtr()->addVehicle(vehicle->getPosition(), vehicle);
+        this->vehicles.push_back(vehicle);
+    }
+
+    std::vector<Lane*> lanes = this->road_ptr->getLanes();
+    for (int i = 0; i < (int) lanes.size(); i++) {
+        lanes[i]->setStepsToSpawn(step.steps_to_spawn[i]);
+    }
+    this->next_id = step.next_id;
+    this->num_dropped = step.num_dropped;
+    random_seed = step.random_seed;
+}
+
+/**
+ * Drops the Vehicles outside the part of the Road of the current process, which their owners have updated, and
+ * exchanges copies of the Vehicles within a halo of the ends of the part with the neighbouring processes
+ * @param curr_proccess pointer to the current process
+ * @param halo length of the halos
+ */
+void Simulation::exchangeHalo(Process *curr_proccess, int halo) {
+    int start = curr_proccess->getStartPosition();
+    int end = curr_proccess->getEndPosition();
+
+    std::vector<Vehicle*> owned;
+    std::vector<Vehicle*> to_prev;
+    std::vector<Vehicle*> to_next;
+    for (Vehicle* vehicle : this->vehicles) {
+        int position = vehicle->getPosition();
+        if (position < start || position > end) {
+            vehicle->getLanePtr()->removeVehicle(position);
+            delete vehicle;
+            continue;
+        }
+        owned.push_back(vehicle);
+        if (position < start + halo) {
+            to_prev.push_back(vehicle);
+        }
+        if (position > end - halo) {
+            to_next.push_back(vehicle);
+        }
+    }
+    this->vehicles.swap(owned);
+
+    std::vector<std::vector<Vehicle *>> vehicles_to_recv = curr_proccess->exchangeHalo(to_prev, to_next);
+    for (int i = 0; i < (int) vehicles_to_recv.size(); i++) {
+        for (Vehicle* vehicle : vehicles_to_recv[i]) {
+            if (this->road_ptr->attemptSpawn(i, vehicle, &(this->vehicles)) != 0) {
+                delete vehicle;
+            }
+        }
+    }
+}
+
+/**
+ * Sends the Vehicles that are about to cross the end of the part of the road of the current process to the next
+ * process, along with the ones that the current process received and sends on, and takes them off the road
+ * @param curr_proccess pointer to the current process
+ */
+void Simulation::sendVehicles(Process *curr_proccess){
+    this->selectVehiclesToSend(curr_proccess);
+
+    // With a one-sided transport, the Vehicles are sent with the exchange of the next step
+    bool one_sided = curr_proccess->isOneSided();
+    if (!one_sided) {
+        curr_proccess->sendVehicle(this->vehicles_to_send);
+    }
+    this->removeSentVehicles(!one_sided);
+}
+
+/**
+ * Lists the Vehicles that are about to cross the end of the part of the road of the current process to be sent
+ * @param curr_proccess pointer to the current process
+ */
+void Simulation::selectVehiclesToSend(Process *curr_proccess){
+
+    // The Vehicles are sorted by position within each Lane, so the ones ahead are considered first, and a Vehicle can
+    // follow the Vehicles ahead of it that are sent
+    for(int i = (int)this->vehicles.size() - 1; i >= 0; i--){
         // Check if the threshold will be exceeded and if the vehicle is allowed to be sent
         if(this->vehicles[i]->getPosition() + this->vehicles[i]->getSpeed() > curr_proccess->getEndPosition()
             && curr_proccess->allowSending(vehicles, this->vehicles_to_send, vehicles[i])){
@@ -209,9 +1127,13 @@ void Simulation::sendVehicles(MpiProcess *curr_proccess){
 #endif
         }
     }
+}
 
-    curr_proccess->sendVehicle(this->vehicles_to_send);
-
+/**
+ * Takes the Vehicles that are sent off the road of the current process
+ * @param delete_vehicles whether to delete the Vehicles, or leave them to the list of the Vehicles to send
+ */
+void Simulation::removeSentVehicles(bool delete_vehicles){
     // Code to remove from curr process the vehicles that have been sent
     // Store indices of vehicles to delete
     std::vector<int> indices_to_remove; 
@@ -226,52 +1148,117 @@ void Simulation::sendVehicles(MpiProcess *curr_proccess){
     // Remove vehicles (in reverse order)
     std::sort(indices_to_remove.rbegin(), indices_to_remove.rend());
     for (int index : indices_to_remove) {
-        delete this->vehicles[index];
+        if (delete_vehicles) {
+            delete this->vehicles[index];
+        }
         this->vehicles.erase(this->vehicles.begin() + index);
     }
 
 }
 
-void Simulation::receiveVehicles(MpiProcess *curr_proccess) {
+void Simulation::receiveVehicles(Process *curr_proccess) {
     // Receive the vehicles that are about to cross the threshold
     std::vector<std::vector<Vehicle *>> vehicles_to_recv = curr_proccess->receiveVehicle();
-    // unordered_set of vehicles to remove from curr process
-    std::vector<int> ids_to_remove;
+    this->placeVehicles(curr_proccess, vehicles_to_recv);
+}
 
-    for (int i = 0; i < (int)vehicles_to_recv.size(); ++i) {
-        for (auto* vehicle : vehicles_to_recv[i]) {
-            // if this is not the last process and the vehicle is about to cross the threshold
-            if (curr_proccess->getRank() != curr_proccess->getNumOfProcesses()-1 &&
-                vehicle->getPosition() + vehicle->getSpeed() > curr_proccess->getEndPosition()) {
+/**
+ * Exchanges the boundaries and the Vehicles that move between the processes through a one-sided transport, and places
+ * the Vehicles that moved from the previous process. Vehicles that move on to the next process right away are sent
+ * with the exchange of the next step.
+ * @param curr_proccess pointer to the current process
+ * @param first_vehicles the first vehicles of the previous process, replaced with the ones of this step
+ * @param last_vehicles the last vehicles of the next process, replaced with the ones of this step
+ */
+void Simulation::exchangeOneSided(Process *curr_proccess, std::vector<int>& first_vehicles,
+                                  std::vector<int>& last_vehicles) {
+    std::vector<std::vector<Vehicle *>> vehicles_to_recv =
+            curr_proccess->exchangeOneSided(this->road_ptr->getLanes(), this->vehicles_to_send, first_vehicles,
+                                            last_vehicles);
 
-                vehicle->setLanePtr(this->road_ptr->getLanes()[i]);
-                this->vehicles_to_send.push_back(vehicle);
-                // Store id of vehicle to remove
-                ids_to_remove.push_back(vehicle->getId());
-#ifdef DEBUG
-                printf("Received vehicle %d and promoted it instantly\n", vehicle->getId());
-#endif
-            }
-        }
+    // The sent Vehicles were copied into the inbox of the next process
+    for (Vehicle* vehicle : this->vehicles_to_send) {
+        delete vehicle;
     }
+    this->vehicles_to_send.clear();
 
-    for(int i=0; i < (int)vehicles_to_recv.size(); i++){
-        for(int j=0; j < (int)vehicles_to_recv[i].size(); j++){
-            if(isInVector(vehicles_to_recv[i][j]->getId(), ids_to_remove)){
-                // delete vehicles_to_recv[i][j];
-                vehicles_to_recv[i].erase(vehicles_to_recv[i].begin() + j);
+    this->placeVehicles(curr_proccess, vehicles_to_recv);
+}
+
+/**
+ * Places the Vehicles received from the previous process in their Lanes, or lists them to be sent on if they are
+ * about to cross the end of the part of the road of the current process. A Vehicle whose site is already taken is
+ * deleted and counted as dropped.
+ * @param curr_proccess pointer to the current process
+ * @param vehicles_to_recv the received Vehicles, in a list for each Lane
+ */
+void Simulation::placeVehicles(Process *curr_proccess, std::vector<std::vector<Vehicle *>>& vehicles_to_recv) {
+    // Take the vehicles that are about to cross the threshold out of the lists, they are sent on right away
+    for (int i = 0; i < (int)vehicles_to_recv.size(); ++i) {
+        std::vector<Vehicle*>& lane_vehicles = vehicles_to_recv[i];
+        Lane* lane_ptr = this->road_ptr->getLanes()[i];
+        lane_vehicles.erase(std::remove_if(lane_vehicles.begin(), lane_vehicles.end(), [&](Vehicle* vehicle) {
+            // if this is not the last process and the vehicle is about to cross the threshold
+            if (curr_proccess->getNextRank() == -1 ||
+                vehicle->getPosition() + vehicle->getSpeed() <= curr_proccess->getEndPosition()) {
+                return false;
             }
-        }
+            vehicle->setLanePtr(lane_ptr);
+            this->vehicles_to_send.push_back(vehicle);
+#ifdef DEBUG
+            printf("Received vehicle %d and promoted it instantly\n", vehicle->getId());
+#endif
+            return true;
+        }), lane_vehicles.end());
     }
 
     // Spawn the received vehicles in their proper positions
     for(int i = 0; i < (int)vehicles_to_recv.size(); i++){
         for(auto vehicle: vehicles_to_recv[i]){
-            this->road_ptr->attemptSpawn(i, vehicle, &(this->vehicles));
+            if (this->road_ptr->attemptSpawn(i, vehicle, &(this->vehicles)) != 0) {
+                delete vehicle;
+                this->num_dropped++;
+            }
         }
     }
 }
 
-bool Simulation::isInVector(int value, const std::vector<int>& vec) {
-    return std::find(vec.begin(), vec.end(), value) != vec.end();
+/**
+ * Selects the storage of the Lanes from the observed density of the segment of the Road of the current process
+ * @param curr_proccess pointer to the current process
+ */
+void Simulation::selectEngine(Process *curr_proccess) {
+    int num_sites = (this->last_lane - this->first_lane + 1) *
+                    (curr_proccess->getEndPosition() - curr_proccess->getStartPosition() + 1);
+    double density = (double) this->vehicles.size() / (double) num_sites;
+
+    if (this->road_ptr->updateStorage(density)) {
+#ifdef DEBUG
+        printf("Process: %d, density %f, switched to %s lanes\n", curr_proccess->getRank(), density,
+               this->road_ptr->isSparse() ? "sparse" : "dense");
+#endif
+    }
+}
+
+/**
+ * Measures the memory used by the subsystems of the current process
+ * @param curr_proccess pointer to the current process
+ * @return the memory usage of the current process
+ */
+MemoryUsage Simulation::getMemoryUsage(Process *curr_proccess) {
+    MemoryUsage usage;
+    usage.lanes = this->road_ptr->getMemoryUsage();
+    usage.vehicles = this->vehicles.size() * sizeof(Vehicle) +
+                     (this->vehicles.capacity() + this->vehicles_to_send.capacity()) * sizeof(Vehicle*);
+    usage.vehicles += this->next_lanes.capacity() * sizeof(int) + this->next_positions.capacity() * sizeof(int) +
+                      this->lane_claims.capacity() * sizeof(LaneClaim) +
+                      this->ghost_vehicles.capacity() * sizeof(Vehicle);
+    for (std::vector<Vehicle*>& lane_vehicles : this->lane_vehicles) {
+        usage.vehicles += lane_vehicles.capacity() * sizeof(Vehicle*);
+    }
+    usage.statistics = this->travel_time->getMemoryUsage();
+    usage.buffers = curr_proccess->getPeakBufferBytes();
+    usage.live_vehicles = this->vehicles.size();
+    usage.cells = (long) this->inputs.num_lanes * (curr_proccess->getEndPosition() - curr_proccess->getStartPosition() + 1);
+    return usage;
 }
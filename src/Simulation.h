@@ -10,7 +10,24 @@
 #include "Road.h"
 #include "Inputs.h"
 #include "Statistic.h"
-#include "MpiProcess.h"
+#include "Observables.h"
+#include "Detectors.h"
+#include "MemoryReport.h"
+#include "Process.h"
+#include "Ramps.h"
+#include "ArrivalTrace.h"
+#include "Jams.h"
+#include "TimeWarp.h"
+
+/**
+ * Structure for the claim of a Vehicle on a site of another Lane in the lane change step
+ */
+struct LaneClaim {
+    int lane;
+    int position;
+    int from_lane;
+    int vehicle;
+};
 
 /**
  * Class for the simulation. Has a method for running the simulation.
@@ -22,16 +39,64 @@ private:
     std::vector<Vehicle*> vehicles;
     Inputs inputs;
     int next_id;
+    int num_dropped;
     Statistic* travel_time;
+    Observables* observables;
+    Detectors* detectors_ptr;
+    Ramps* ramps_ptr;
+    ArrivalTrace* arrival_trace_ptr;
+    Jams* jams_ptr;
+    MemoryReport* memory_report;
     std::vector<Vehicle *> vehicles_to_send;
+    std::vector<std::vector<Vehicle*>> lane_vehicles;
+    std::vector<int> next_lanes;
+    std::vector<int> next_positions;
+    std::vector<LaneClaim> lane_claims;
+    std::vector<char> changed_lane;
+    int first_lane;
+    int last_lane;
+    std::vector<Vehicle> ghost_vehicles;
+    std::vector<Vehicle*> migrants_to_right;
+    std::vector<Vehicle*> migrants_to_left;
+    template <class RuleSet>
+    int run_loop(Process *curr_proccess);
+    template <class RuleSet>
+    void stepBlocked(Process *curr_proccess, int halo);
+    template <class RuleSet>
+    void runOptimistic(Process *curr_proccess, TimeWarp& time_warp);
+    template <class RuleSet>
+    void stepOptimistic(Process *curr_proccess, TimeWarp& time_warp);
+    void saveStep(WarpStep& step);
+    void restoreStep(WarpStep& step);
+    int getHaloLength();
+    int getMaxSpeed();
+    void sortVehicles();
+    template <class RuleSet>
+    void updateGaps(int start_position, int end_position, const std::vector<int>& first_vehicles,
+                    const std::vector<int>& last_vehicles);
+    template <class RuleSet>
+    void switchLanes();
+    void updateChangedGaps(int end_position, const std::vector<int>& last_vehicles);
+    template <class RuleSet>
+    void moveVehicles(std::vector<int>& exited, std::vector<int>& ramp_exits, int start_position, int end_position);
+    void exchangeHalo(Process *curr_proccess, int halo);
+    void exchangeEdgeLanes(Process *curr_proccess, std::vector<int>& first_vehicles, std::vector<int>& last_vehicles);
+    void removeGhosts();
+    void exchangeLaneChanges(Process *curr_proccess);
+    MemoryUsage getMemoryUsage(Process *curr_proccess);
 
 public:
-    Simulation(Inputs inputs);
+    Simulation(Inputs inputs, Detectors* detectors_ptr, Ramps* ramps_ptr, ArrivalTrace* arrival_trace_ptr,
+               Jams* jams_ptr);
     ~Simulation();
-    int run_simulation(MpiProcess *curr_process);
-    void sendVehicles(MpiProcess *curr_proccess);
-    void receiveVehicles(MpiProcess *curr_proccess);
-    bool isInVector(int value, const std::vector<int>& vec);
+    int run_simulation(Process *curr_process);
+    void sendVehicles(Process *curr_proccess);
+    void selectVehiclesToSend(Process *curr_proccess);
+    void removeSentVehicles(bool delete_vehicles);
+    void receiveVehicles(Process *curr_proccess);
+    void placeVehicles(Process *curr_proccess, std::vector<std::vector<Vehicle *>>& vehicles_to_recv);
+    void exchangeOneSided(Process *curr_proccess, std::vector<int>& first_vehicles, std::vector<int>& last_vehicles);
+    void selectEngine(Process *curr_proccess);
 };
 
 
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_SPSCRING_H
+#define CA_TRAFFIC_SIMULATION_SPSCRING_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+/**
+ * Class for a bounded single-producer/single-consumer queue on a ring of slots. The producer only writes the tail and
+ * the consumer only writes the head, so the two threads hand items over without locks. The head and the tail are on
+ * separate cache lines so that the threads do not invalidate each other's line on every item.
+ */
+template <typename T>
+class SpscRing {
+private:
+    std::vector<T> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+public:
+    /**
+     * Constructor for the SpscRing
+     * @param capacity minimum number of items that the ring holds, rounded up to a power of two
+     */
+    explicit SpscRing(size_t capacity) : head(0), tail(0) {
+        size_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        this->slots.resize(size);
+        this->mask = size - 1;
+    }
+
+    /**
+     * Moves an item into the ring, from the producer thread only
+     * @param item the item, which is moved from only if there is room
+     * @return true if the item was added, false if the ring is full
+     */
+    bool tryPush(T& item) {
+        size_t tail = this->tail.load(std::memory_order_relaxed);
+        if (tail - this->head.load(std::memory_order_acquire) == this->slots.size()) {
+            return false;
+        }
+        this->slots[tail & this->mask] = std::move(item);
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Moves the oldest item out of the ring, from the consumer thread only
+     * @param item where to move the item
+     * @return true if an item was taken, false if the ring is empty
+     */
+    bool tryPop(T& item) {
+        size_t head = this->head.load(std::memory_order_relaxed);
+        if (head == this->tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(this->slots[head & this->mask]);
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Get the number of items in the ring, which is exact from either thread up to the items in flight. The head is
+     * read first, so that it is never ahead of the tail that is read after it.
+     * @return the number of items in the ring
+     */
+    size_t size() {
+        size_t head = this->head.load(std::memory_order_acquire);
+        return this->tail.load(std::memory_order_acquire) - head;
+    }
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_SPSCRING_H
@@ -70,3 +70,11 @@ int Statistic::getNumSamples() {
 std::vector<double> Statistic::getValues() {
     return this->values;
 }
+
+/**
+ * Gets the memory allocated for the samples of the Statistic
+ * @return number of bytes allocated for the samples
+ */
+long Statistic::getMemoryUsage() {
+    return sizeof(Statistic) + this->values.capacity() * sizeof(double);
+}
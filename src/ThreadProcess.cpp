@@ -0,0 +1,493 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <stdexcept>
+#include <algorithm>
+
+#include "ThreadProcess.h"
+#include "Lane.h"
+
+// Tags of the messages between the threads
+const int TAG_VEHICLES = 10;
+const int TAG_BOUNDARY = 50;
+const int TAG_JUNCTION = 60;
+const int TAG_SUMMARY = 90;
+const int TAG_REDUCE = 110;
+const int TAG_HALO = 120;
+const int TAG_TAILS = 160;
+const int TAG_OPTIMISTIC = 170;
+const int TAG_RESULTS = 180;
+const int TAG_GATHER = 190;
+
+/**
+ * Constructor for the ThreadGroup
+ * @param num_threads number of threads of the simulation
+ */
+ThreadGroup::ThreadGroup(int num_threads) : mailboxes(num_threads) {
+    this->num_threads = num_threads;
+    this->barrier_count = 0;
+    this->barrier_generation = 0;
+}
+
+/**
+ * Places a message in the mailbox of a thread, without waiting for it to be received
+ * @param source number of the sending thread
+ * @param destination number of the receiving thread
+ * @param tag tag of the message
+ * @param message the message
+ */
+void ThreadGroup::send(int source, int destination, int tag, ThreadMessage message) {
+    Mailbox& mailbox = this->mailboxes[destination];
+    {
+        std::lock_guard<std::mutex> lock(mailbox.mutex);
+        mailbox.messages[{source, tag}].push_back(std::move(message));
+    }
+    mailbox.ready.notify_one();
+}
+
+/**
+ * Takes the oldest message from a source thread with a tag out of the mailbox of a thread, waiting until there is one
+ * @param source number of the sending thread
+ * @param destination number of the receiving thread
+ * @param tag tag of the message
+ * @return the message
+ */
+ThreadMessage ThreadGroup::receive(int source, int destination, int tag) {
+    Mailbox& mailbox = this->mailboxes[destination];
+    std::unique_lock<std::mutex> lock(mailbox.mutex);
+    std::deque<ThreadMessage>& queue = mailbox.messages[{source, tag}];
+    mailbox.ready.wait(lock, [&queue] { return !queue.empty(); });
+
+    ThreadMessage message = std::move(queue.front());
+    queue.pop_front();
+    return message;
+}
+
+/**
+ * Takes the oldest message with a tag from any of some source threads out of the mailbox of a thread, if there is
+ * one, trying the sources in order
+ * @param sources numbers of the sending threads
+ * @param destination number of the receiving thread
+ * @param tag tag of the message
+ * @param message the message to fill
+ * @return number of the thread that sent the message, or -1 if there is none
+ */
+int ThreadGroup::receiveAny(const std::vector<int>& sources, int destination, int tag, ThreadMessage& message) {
+    Mailbox& mailbox = this->mailboxes[destination];
+    std::lock_guard<std::mutex> lock(mailbox.mutex);
+    int source = -1;
+    for (int candidate : sources) {
+        if (!mailbox.messages[{candidate, tag}].empty()) {
+            source = candidate;
+            break;
+        }
+    }
+    if (source == -1) {
+        return -1;
+    }
+
+    std::deque<ThreadMessage>& queue = mailbox.messages[{source, tag}];
+    message = std::move(queue.front());
+    queue.pop_front();
+    return source;
+}
+
+/**
+ * Waits until all the threads reach the barrier
+ */
+void ThreadGroup::barrier() {
+    std::unique_lock<std::mutex> lock(this->barrier_mutex);
+    int generation = this->barrier_generation;
+    if (++this->barrier_count == this->num_threads) {
+        this->barrier_count = 0;
+        this->barrier_generation++;
+        this->barrier_ready.notify_all();
+    } else {
+        this->barrier_ready.wait(lock, [this, generation] { return this->barrier_generation != generation; });
+    }
+}
+
+/**
+ * Constructor for the ThreadProcess
+ * @param group_ptr pointer to the memory shared by the threads
+ * @param rank number of the thread
+ */
+ThreadProcess::ThreadProcess(ThreadGroup* group_ptr, int rank) {
+    this->group_ptr = group_ptr;
+    this->setRanks(rank, group_ptr->num_threads);
+}
+
+/**
+ * Loads the inputs on the first thread and shares them with the other threads. The configuration structure is not
+ * used, since the threads share the Inputs directly.
+ * @param config unused
+ * @return the simulation inputs
+ */
+Inputs ThreadProcess::broadcastConfig(Config &config) {
+    if (this->rank == 0) {
+        if (this->group_ptr->inputs.loadFromFile() != 0) {
+            throw std::runtime_error("Failed to load configuration from cats-input.txt");
+        }
+    }
+    this->group_ptr->barrier();
+
+    Inputs inputs = this->group_ptr->inputs;
+    this->num_lanes = inputs.num_lanes;
+    return inputs;
+}
+
+/**
+ * Divides the road between the threads in contiguous parts of nearly equal length, each with all the Lanes
+ * @param inputs instance of the Inputs class with the simulation Inputs
+ */
+void ThreadProcess::divideRoad(Inputs inputs) {
+    int length = splitRange(inputs.length, this->getNumOfProcesses(), this->rank, &this->road_start);
+    this->road_end = this->road_start + length - 1;
+    this->setLanes(0, inputs.num_lanes - 1, -1, -1, 1);
+}
+
+/**
+ * Sends copies of the Vehicles about to cross the end of the part of the road of the thread to the next thread
+ * @param vehicles_to_send the Vehicles to send, which stay with the sender
+ */
+void ThreadProcess::sendVehicle(std::vector<Vehicle *>& vehicles_to_send) {
+    ThreadMessage message;
+    for (Vehicle* vehicle_ptr : vehicles_to_send) {
+        message.values.push_back(vehicle_ptr->getLanePtr()->getLaneNumber());
+        message.vehicles.push_back(new Vehicle(*vehicle_ptr));
+    }
+    this->recordBufferBytes(message.values.size() * sizeof(int) + message.vehicles.size() * sizeof(Vehicle*));
+    this->group_ptr->send(this->rank, this->next_rank, TAG_VEHICLES, std::move(message));
+}
+
+/**
+ * Receives the Vehicles sent by the previous thread
+ * @return the received Vehicles, in a list for each Lane
+ */
+std::vector<std::vector<Vehicle *>> ThreadProcess::receiveVehicle() {
+    ThreadMessage message = this->group_ptr->receive(this->prev_rank, this->rank, TAG_VEHICLES);
+
+    std::vector<std::vector<Vehicle*>> vehicles_to_recv(this->num_lanes);
+    for (int i = 0; i < (int) message.vehicles.size(); i++) {
+        vehicles_to_recv[message.values[i]].push_back(message.vehicles[i]);
+    }
+    return vehicles_to_recv;
+}
+
+/**
+ * Receives the last vehicles (smaller positions) of the next thread (one from each lane)
+ * @return the vector of index of the last vehicles
+ */
+std::vector<int> ThreadProcess::recvLastVehicles() {
+    return this->group_ptr->receive(this->next_rank, this->rank, TAG_BOUNDARY).values;
+}
+
+/**
+ * Sends the last vehicles to the previous thread (one from each lane)
+ * @param lanes pointer in the lanes of the road
+ * @param prev_process_indices the last vehicles received from the next thread, used for empty lanes
+ */
+void ThreadProcess::sendLastVehicles(std::vector<Lane*> lanes, std::vector<int> prev_process_indices) {
+    ThreadMessage message;
+    message.values = this->findLastVehicles(lanes, prev_process_indices);
+    this->group_ptr->send(this->rank, this->prev_rank, TAG_BOUNDARY, std::move(message));
+}
+
+/**
+ * Receives the first vehicles (greatest positions) of the previous thread (one from each lane)
+ * @return the vector of index of the first vehicles
+ */
+std::vector<int> ThreadProcess::recvFirstVehicles() {
+    return this->group_ptr->receive(this->prev_rank, this->rank, TAG_BOUNDARY).values;
+}
+
+/**
+ * Sends the first vehicles to the next thread (one from each lane)
+ * @param lanes pointer in the lanes of the road
+ * @param next_process_indices the first vehicles received from the previous thread, used for empty lanes
+ */
+void ThreadProcess::sendFirstVehicles(std::vector<Lane*> lanes, std::vector<int> next_process_indices) {
+    ThreadMessage message;
+    message.values = this->findFirstVehicles(lanes, next_process_indices);
+    this->group_ptr->send(this->rank, this->next_rank, TAG_BOUNDARY, std::move(message));
+}
+
+/**
+ * Exchanges the entry summaries of the segments of the network with the neighbouring threads
+ * @param neighbours numbers of the neighbouring threads
+ * @param summaries_to_send the summaries to send to each neighbouring thread
+ * @param summary_sizes the number of values to receive from each neighbouring thread
+ * @return the summaries received from each neighbouring thread
+ */
+std::map<int, std::vector<int>> ThreadProcess::exchangeSegmentSummaries(std::vector<int>& neighbours,
+                                                                        std::map<int, std::vector<int>>& summaries_to_send,
+                                                                        std::map<int, int>& summary_sizes) {
+    long bytes = 0;
+    for (int neighbour : neighbours) {
+        ThreadMessage message;
+        message.values = summaries_to_send[neighbour];
+        bytes += message.values.size() * sizeof(int);
+        this->group_ptr->send(this->rank, neighbour, TAG_SUMMARY, std::move(message));
+    }
+    this->recordBufferBytes(bytes);
+
+    std::map<int, std::vector<int>> summaries_received;
+    for (int neighbour : neighbours) {
+        summaries_received[neighbour] = this->group_ptr->receive(neighbour, this->rank, TAG_SUMMARY).values;
+        summaries_received[neighbour].resize(summary_sizes[neighbour]);
+    }
+    return summaries_received;
+}
+
+/**
+ * Hands the Vehicles crossing junctions into segments of other threads to those threads, and takes the Vehicles
+ * crossing junctions into the segments of this thread. The Vehicles are not copied, the receiving thread takes them
+ * over. Every neighbouring thread gets a message, even if it is empty.
+ * @param neighbours numbers of the neighbouring threads
+ * @param transfers the Vehicles to send to each neighbouring thread
+ * @return the Vehicles received from all the neighbouring threads
+ */
+std::vector<JunctionTransfer> ThreadProcess::exchangeJunctionVehicles(std::vector<int>& neighbours,
+                                                                      std::map<int, std::vector<JunctionTransfer>>& transfers) {
+    long bytes = 0;
+    for (int neighbour : neighbours) {
+        ThreadMessage message;
+        bytes += transfers[neighbour].size() * (2 * sizeof(int) + sizeof(Vehicle*));
+        for (JunctionTransfer& transfer : transfers[neighbour]) {
+            message.values.push_back(transfer.segment);
+            message.values.push_back(transfer.lane);
+            message.vehicles.push_back(transfer.vehicle_ptr);
+        }
+        this->group_ptr->send(this->rank, neighbour, TAG_JUNCTION, std::move(message));
+    }
+    this->recordBufferBytes(bytes);
+
+    std::vector<JunctionTransfer> received;
+    for (int neighbour : neighbours) {
+        ThreadMessage message = this->group_ptr->receive(neighbour, this->rank, TAG_JUNCTION);
+        for (int i = 0; i < (int) message.vehicles.size(); i++) {
+            received.push_back({message.values[2 * i], message.values[2 * i + 1], message.vehicles[i]});
+        }
+    }
+
+    transfers.clear();
+    return received;
+}
+
+/**
+ * Sends copies of Vehicles to the neighbouring threads, and receives the copies of their Vehicles
+ * @param to_prev the Vehicles to copy to the previous thread
+ * @param to_next the Vehicles to copy to the next thread
+ * @return the copies of the Vehicles of the neighbouring threads, in a list for each Lane
+ */
+std::vector<std::vector<Vehicle *>> ThreadProcess::exchangeHalo(std::vector<Vehicle *>& to_prev,
+                                                                std::vector<Vehicle *>& to_next) {
+    int neighbours[2] = {this->prev_rank, this->next_rank};
+    std::vector<Vehicle *>* to_send[2] = {&to_prev, &to_next};
+    long bytes = 0;
+    for (int i = 0; i < 2; i++) {
+        if (neighbours[i] < 0) {
+            continue;
+        }
+        ThreadMessage message;
+        for (Vehicle* vehicle_ptr : *to_send[i]) {
+            message.values.push_back(vehicle_ptr->getLanePtr()->getLaneNumber());
+            message.vehicles.push_back(new Vehicle(*vehicle_ptr));
+        }
+        bytes += message.values.size() * sizeof(int) + message.vehicles.size() * sizeof(Vehicle*);
+        this->group_ptr->send(this->rank, neighbours[i], TAG_HALO, std::move(message));
+    }
+    this->recordBufferBytes(bytes);
+
+    std::vector<std::vector<Vehicle*>> vehicles_to_recv(this->num_lanes);
+    for (int neighbour : neighbours) {
+        if (neighbour < 0) {
+            continue;
+        }
+        ThreadMessage message = this->group_ptr->receive(neighbour, this->rank, TAG_HALO);
+        for (int i = 0; i < (int) message.vehicles.size(); i++) {
+            vehicles_to_recv[message.values[i]].push_back(message.vehicles[i]);
+        }
+    }
+    return vehicles_to_recv;
+}
+
+/**
+ * Send the tails of the Lanes of this thread to the next thread, and receive the tails of the previous thread
+ * @param tails a value for each Lane of the road, for the next thread
+ * @return the values of the previous thread, or none if this is the first thread
+ */
+std::vector<int> ThreadProcess::exchangeTails(std::vector<int>& tails) {
+    if (this->next_rank >= 0) {
+        ThreadMessage message;
+        message.values = tails;
+        this->recordBufferBytes(tails.size() * sizeof(int));
+        this->group_ptr->send(this->rank, this->next_rank, TAG_TAILS, std::move(message));
+    }
+    if (this->prev_rank < 0) {
+        return {};
+    }
+    return this->group_ptr->receive(this->prev_rank, this->rank, TAG_TAILS).values;
+}
+
+/**
+ * Sends the data of a step to a neighbouring thread that runs ahead optimistically. The migrating Vehicles are passed
+ * as copies, which belong to the receiving thread.
+ * @param destination number of the neighbouring thread
+ * @param message the message
+ */
+void ThreadProcess::sendOptimistic(int destination, OptimisticMessage& message) {
+    ThreadMessage thread_message;
+    thread_message.values = {message.step};
+    thread_message.values.insert(thread_message.values.end(), message.boundary.begin(), message.boundary.end());
+    thread_message.values.insert(thread_message.values.end(), message.migrant_lanes.begin(),
+                                 message.migrant_lanes.end());
+    for (Vehicle& vehicle : message.migrants) {
+        thread_message.vehicles.push_back(new Vehicle(vehicle));
+    }
+    this->recordBufferBytes(thread_message.values.size() * sizeof(int) + message.migrants.size() * sizeof(Vehicle));
+    this->group_ptr->send(this->rank, destination, TAG_OPTIMISTIC, std::move(thread_message));
+}
+
+/**
+ * Receives the next message of a neighbouring thread that runs ahead optimistically, from either neighbour, if one
+ * has arrived
+ * @param message the message to fill
+ * @return true if a message was received, false otherwise
+ */
+bool ThreadProcess::receiveOptimistic(OptimisticMessage& message) {
+    std::vector<int> sources;
+    for (int neighbour : {this->prev_rank, this->next_rank}) {
+        if (neighbour >= 0) {
+            sources.push_back(neighbour);
+        }
+    }
+    ThreadMessage thread_message;
+    message.source = this->group_ptr->receiveAny(sources, this->rank, TAG_OPTIMISTIC, thread_message);
+    if (message.source == -1) {
+        return false;
+    }
+
+    // The boundary has a value for each Lane, and is followed by the Lanes of the migrating Vehicles
+    std::vector<int>& values = thread_message.values;
+    int num_migrants = thread_message.vehicles.size();
+    message.step = values[0];
+    message.boundary.assign(values.begin() + 1, values.end() - num_migrants);
+    message.migrant_lanes.assign(values.end() - num_migrants, values.end());
+    message.migrants.clear();
+    for (Vehicle* vehicle : thread_message.vehicles) {
+        message.migrants.push_back(*vehicle);
+        delete vehicle;
+    }
+    return true;
+}
+
+/**
+ * Sum values over all the threads
+ * @param values the values of this thread
+ * @return the sums of the values of all threads, valid only on thread 0
+ */
+std::vector<double> ThreadProcess::reduceSum(std::vector<double> values) {
+    return this->reduce(values, false);
+}
+
+/**
+ * Take the maximum of values over all the threads
+ * @param values the values of this thread
+ * @return the maximums of the values of all threads, valid only on thread 0
+ */
+std::vector<double> ThreadProcess::reduceMax(std::vector<double> values) {
+    return this->reduce(values, true);
+}
+
+/**
+ * Combine values over all the threads on thread 0
+ * @param values the values of this thread
+ * @param maximum whether to take the maximum of the values instead of the sum
+ * @return the combined values of all threads, valid only on thread 0
+ */
+std::vector<double> ThreadProcess::reduce(std::vector<double> values, bool maximum) {
+    if (this->rank != 0) {
+        ThreadMessage message;
+        message.reals = values;
+        this->recordBufferBytes(values.size() * sizeof(double));
+        this->group_ptr->send(this->rank, 0, TAG_REDUCE, std::move(message));
+        return std::vector<double>(values.size(), 0.0);
+    }
+
+    std::vector<double> results = values;
+    for (int source = 1; source < this->num_of_processes; source++) {
+        ThreadMessage message = this->group_ptr->receive(source, 0, TAG_REDUCE);
+        for (int i = 0; i < (int) results.size(); i++) {
+            results[i] = maximum ? std::max(results[i], message.reals[i]) : results[i] + message.reals[i];
+        }
+    }
+    return results;
+}
+
+/**
+ * Sum values over all the threads, on all the threads
+ * @param values the values of this thread
+ * @return the sums of the values of all threads
+ */
+std::vector<double> ThreadProcess::allReduceSum(std::vector<double> values) {
+    return this->share(this->reduce(values, false));
+}
+
+/**
+ * Take the maximum of values over all the threads, on all the threads
+ * @param values the values of this thread
+ * @return the maximums of the values of all threads
+ */
+std::vector<double> ThreadProcess::allReduceMax(std::vector<double> values) {
+    return this->share(this->reduce(values, true));
+}
+
+/**
+ * Passes the results of a reduction from thread 0 to all the threads
+ * @param results the results, valid only on thread 0
+ * @return the results of thread 0
+ */
+std::vector<double> ThreadProcess::share(std::vector<double> results) {
+    if (this->rank != 0) {
+        return this->group_ptr->receive(0, this->rank, TAG_RESULTS).reals;
+    }
+    for (int destination = 1; destination < this->num_of_processes; destination++) {
+        ThreadMessage message;
+        message.reals = results;
+        this->group_ptr->send(0, destination, TAG_RESULTS, std::move(message));
+    }
+    return results;
+}
+
+/**
+ * Gather values of different lengths from all the threads
+ * @param values the values of this thread
+ * @return the values of all threads one after the other, in the order of the threads, valid only on thread 0
+ */
+std::vector<double> ThreadProcess::gather(std::vector<double> values) {
+    if (this->rank != 0) {
+        ThreadMessage message;
+        message.reals = values;
+        this->recordBufferBytes(values.size() * sizeof(double));
+        this->group_ptr->send(this->rank, 0, TAG_GATHER, std::move(message));
+        return {};
+    }
+
+    std::vector<double> results = values;
+    for (int source = 1; source < this->num_of_processes; source++) {
+        ThreadMessage message = this->group_ptr->receive(source, 0, TAG_GATHER);
+        results.insert(results.end(), message.reals.begin(), message.reals.end());
+    }
+    return results;
+}
+
+/**
+ * Get the peak resident set size of the program, which is shared by all the threads, on thread 0 only so that it is
+ * counted once when summed over the threads
+ * @return the peak resident set size in bytes on thread 0, zero on the other threads
+ */
+long ThreadProcess::getPeakResidentBytes() {
+    return this->rank == 0 ? Process::getPeakResidentBytes() : 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_THREADPROCESS_H
+#define CA_TRAFFIC_SIMULATION_THREADPROCESS_H
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+
+#include "Inputs.h"
+#include "Vehicle.h"
+#include "Process.h"
+
+/**
+ * Structure for a message between the threads of a ThreadGroup. Vehicles are passed by pointer, and belong to the
+ * receiving thread once the message is received.
+ */
+struct ThreadMessage {
+    std::vector<int> values;
+    std::vector<double> reals;
+    std::vector<Vehicle*> vehicles;
+};
+
+/**
+ * Structure for the mailbox of a thread, with the queue of messages sent to it by each source thread with each tag
+ */
+struct Mailbox {
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::map<std::pair<int, int>, std::deque<ThreadMessage>> messages;
+};
+
+/**
+ * Class for the memory shared by the threads that are the processes of a simulation, with a mailbox for each thread,
+ * the simulation inputs loaded by the first thread, and a barrier
+ */
+class ThreadGroup {
+private:
+    std::vector<Mailbox> mailboxes;
+    std::mutex barrier_mutex;
+    std::condition_variable barrier_ready;
+    int barrier_count;
+    int barrier_generation;
+public:
+    int num_threads;
+    Inputs inputs;
+
+    ThreadGroup(int num_threads);
+    void send(int source, int destination, int tag, ThreadMessage message);
+    ThreadMessage receive(int source, int destination, int tag);
+    int receiveAny(const std::vector<int>& sources, int destination, int tag, ThreadMessage& message);
+    void barrier();
+};
+
+/**
+ * Process of the simulation that is a thread of a single program and exchanges the boundary data through the shared
+ * memory of its ThreadGroup, which avoids the startup of MPI and the copies of the messages between ranks
+ */
+class ThreadProcess : public Process {
+private:
+    ThreadGroup* group_ptr;
+    std::vector<double> reduce(std::vector<double> values, bool maximum);
+    std::vector<double> share(std::vector<double> results);
+public:
+    ThreadProcess(ThreadGroup* group_ptr, int rank);
+
+    Inputs broadcastConfig(Config &config) override;
+    void divideRoad(Inputs inputs) override;
+    void sendVehicle(std::vector<Vehicle *>& vehicles) override;
+    std::vector<std::vector<Vehicle *>> receiveVehicle() override;
+    std::vector<int> recvLastVehicles() override;
+    void sendLastVehicles(std::vector<Lane*> lanes, std::vector<int> prev_process_indices) override;
+    std::vector<int> recvFirstVehicles() override;
+    void sendFirstVehicles(std::vector<Lane*> lanes, std::vector<int> next_process_indices) override;
+    std::map<int, std::vector<int>> exchangeSegmentSummaries(std::vector<int>& neighbours,
+                                                             std::map<int, std::vector<int>>& summaries_to_send,
+                                                             std::map<int, int>& summary_sizes) override;
+    std::vector<JunctionTransfer> exchangeJunctionVehicles(std::vector<int>& neighbours,
+                                                           std::map<int, std::vector<JunctionTransfer>>& transfers) override;
+    std::vector<std::vector<Vehicle *>> exchangeHalo(std::vector<Vehicle *>& to_prev,
+                                                     std::vector<Vehicle *>& to_next) override;
+    std::vector<int> exchangeTails(std::vector<int>& tails) override;
+    std::vector<double> reduceSum(std::vector<double> values) override;
+    std::vector<double> reduceMax(std::vector<double> values) override;
+    std::vector<double> allReduceSum(std::vector<double> values) override;
+    std::vector<double> allReduceMax(std::vector<double> values) override;
+    std::vector<double> gather(std::vector<double> values) override;
+    void sendOptimistic(int destination, OptimisticMessage& message) override;
+    bool receiveOptimistic(OptimisticMessage& message) override;
+    long getPeakResidentBytes() override;
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_THREADPROCESS_H
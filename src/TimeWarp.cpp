@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include "TimeWarp.h"
+
+/**
+ * Constructor for the TimeWarp of a process, before its first step
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @param curr_process pointer to the current process
+ * @param halo number of sites beyond the part of the road of a process within which its boundaries matter
+ */
+TimeWarp::TimeWarp(Inputs inputs, Process* curr_process, int halo) {
+    this->window = inputs.optimistic_window;
+    this->max_time = inputs.max_time;
+    this->num_lanes = inputs.num_lanes;
+    this->prev_rank = curr_process->getPrevRank();
+    this->next_rank = curr_process->getNextRank();
+
+    // The boundaries only matter within the halo of the part of the road of the neighbour they are sent to
+    this->prev_limit = curr_process->getStartPosition() - 1 + halo;
+    this->next_limit = curr_process->getEndPosition() + 1 - halo;
+
+    // Nothing is exchanged before the first step, which is the same as empty boundaries
+    this->committed_last.assign(this->num_lanes, -1);
+    this->committed_first.assign(this->num_lanes, -1);
+    this->sent[0][-1].last_vehicles = this->committed_last;
+    this->sent[1][-1].first_vehicles = this->committed_first;
+    this->gvt = 0;
+    this->rollback_step = -1;
+    this->messages_sent = 0;
+    this->messages_received = 0;
+    this->steps_run = 0;
+    this->rollbacks = 0;
+    this->steps_rolled_back = 0;
+    this->gvt_rounds = 0;
+    this->peak_steps = 0;
+}
+
+/**
+ * Replaces the sites of a boundary that are too far from the part of the road of the neighbour it is sent to to change
+ * its steps with -1, the same as an empty Lane, so that the boundary only changes when it changes within reach
+ * @param boundary the last vehicles of the process for the previous process, or its first vehicles for the next one
+ * @param last whether the boundary is the last vehicles of the process
+ */
+void TimeWarp::clampBoundary(std::vector<int>& boundary, bool last) {
+    for (int& site : boundary) {
+        if (last ? site > this->prev_limit : site < this->next_limit) {
+            site = -1;
+        }
+    }
+}
+
+/**
+ * Marks the step to roll back to, if it is earlier than the one already marked
+ * @param step the step
+ */
+void TimeWarp::rollBackTo(int step) {
+    if (this->rollback_step == -1 || step < this->rollback_step) {
+        this->rollback_step = step;
+    }
+}
+
+/**
+ * Compares a received boundary with the boundaries used by the steps it holds for, from its step until the next step
+ * with a boundary from the same neighbour, and marks the first step that used a different one
+ * @param step the step of the boundary
+ * @param time the next step of the process
+ * @param last whether the boundary is the last vehicles of the next process
+ * @param boundary the boundary
+ */
+void TimeWarp::checkBoundary(int step, int time, bool last, const std::vector<int>& boundary) {
+    int until = time;
+    for (std::map<int, WarpInputs>::iterator later = this->received.upper_bound(step);
+         later != this->received.end() && later->first < time; later++) {
+        if (last ? later->second.has_last : later->second.has_first) {
+            until = later->first;
+            break;
+        }
+    }
+    for (int s = step; s < until; s++) {
+        const WarpStep& used = this->steps[s - this->gvt];
+        if ((last ? used.last_vehicles : used.first_vehicles) != boundary) {
+            this->rollBackTo(s);
+            return;
+        }
+    }
+}
+
+/**
+ * Takes the data of a step from a neighbouring process. The data is compared with the data that the steps that already
+ * ran used, and the first step that used different data is rolled back to before the next step runs.
+ * @param message the message
+ * @param time the next step of the process
+ */
+void TimeWarp::receive(OptimisticMessage& message, int time) {
+    this->messages_received++;
+    if (message.step < this->gvt) {
+        throw std::logic_error("A step before the global virtual time was received");
+    }
+    bool from_prev = message.source == this->prev_rank;
+
+    WarpInputs& inputs = this->received[message.step];
+    if (from_prev) {
+        inputs.has_first = true;
+        inputs.first_vehicles.swap(message.boundary);
+        inputs.migrant_lanes.swap(message.migrant_lanes);
+        inputs.migrants.swap(message.migrants);
+    } else {
+        inputs.has_last = true;
+        inputs.last_vehicles.swap(message.boundary);
+    }
+    if (message.step >= time) {
+        return;
+    }
+
+    if (from_prev) {
+        const WarpStep& used = this->steps[message.step - this->gvt];
+        bool same = used.migrant_lanes == inputs.migrant_lanes;
+        for (int i = 0; same && i < (int) used.migrants.size(); i++) {
+            same = used.migrants[i].hasSameState(inputs.migrants[i]);
+        }
+        if (!same) {
+            this->rollBackTo(message.step);
+        }
+        this->checkBoundary(message.step, time, false, inputs.first_vehicles);
+    } else {
+        this->checkBoundary(message.step, time, true, inputs.last_vehicles);
+    }
+}
+
+/**
+ * Takes the earliest step that used data that differs from the data received for it
+ * @return the step, or -1 if no step has to be rolled back
+ */
+int TimeWarp::takeRollback() {
+    int step = this->rollback_step;
+    this->rollback_step = -1;
+    return step;
+}
+
+/**
+ * Drops the steps from a step on, which run again
+ * @param step the first step that runs again, which is not before the global virtual time
+ * @param time the next step of the process
+ * @return the step, with the state of the process at its start
+ */
+WarpStep TimeWarp::rollBack(int step, int time) {
+    if (step < this->gvt) {
+        throw std::logic_error("A step before the global virtual time was rolled back");
+    }
+    this->rollbacks++;
+    this->steps_rolled_back += time - step;
+    WarpStep rolled_back = std::move(this->steps[step - this->gvt]);
+    this->steps.erase(this->steps.begin() + (step - this->gvt), this->steps.end());
+    return rolled_back;
+}
+
+/**
+ * Computes the global virtual time with the other processes, at the end of the window, and commits the steps before
+ * it. The processes take the messages that have arrived until every message sent has been received, and the global
+ * virtual time is then the earliest of their next steps and of the steps they have to roll back to.
+ * @param curr_process pointer to the current process
+ * @param time the next step of the process
+ * @param travel_time the statistic of the travel times, which the committed steps add theirs to
+ */
+void TimeWarp::computeGvt(Process* curr_process, int time, Statistic* travel_time) {
+    this->gvt_rounds++;
+    OptimisticMessage message;
+    while (true) {
+        while (curr_process->receiveOptimistic(message)) {
+            this->receive(message, time);
+        }
+        int local = this->rollback_step == -1 ? time : std::min(time, this->rollback_step);
+
+        // No process sends while it takes part, so the sum is zero once nothing is in flight
+        std::vector<double> in_flight = curr_process->allReduceSum({(double) (this->messages_sent -
+                                                                              this->messages_received)});
+        if (in_flight[0] == 0.0) {
+            this->commit(-(int) curr_process->allReduceMax({(double) -local})[0], travel_time);
+            return;
+        }
+    }
+}
+
+/**
+ * Commits the steps before the global virtual time, which adds their travel times, and drops the data of the steps
+ * before it that the processes no longer use
+ * @param gvt the global virtual time
+ * @param travel_time the statistic of the travel times
+ */
+void TimeWarp::commit(int gvt, Statistic* travel_time) {
+    for (; this->gvt < gvt; this->gvt++) {
+        WarpStep& step = this->steps.front();
+        for (double value : step.travel_times) {
+            travel_time->addValue(value);
+        }
+        this->committed_last.swap(step.last_vehicles);
+        this->committed_first.swap(step.first_vehicles);
+        this->steps.pop_front();
+    }
+    this->received.erase(this->received.begin(), this->received.lower_bound(this->gvt));
+
+    // The neighbours start from the last data they were sent before the global virtual time
+    for (std::map<int, WarpInputs>& sent : this->sent) {
+        std::map<int, WarpInputs>::iterator first_needed = sent.lower_bound(this->gvt);
+        if (first_needed != sent.begin()) {
+            sent.erase(sent.begin(), std::prev(first_needed));
+        }
+    }
+}
+
+/**
+ * Checks whether the process can run its next step, which must be within the window of the global virtual time
+ * @param time the next step of the process
+ * @return true if the step can run, false otherwise
+ */
+bool TimeWarp::canRun(int time) {
+    return time < this->max_time && time < this->gvt + this->window;
+}
+
+/**
+ * Checks whether all the steps of all the processes are final, after which no message is sent between them
+ * @return true if the global virtual time is the end of the simulation, false otherwise
+ */
+bool TimeWarp::isFinished() {
+    return this->gvt == this->max_time;
+}
+
+/**
+ * Starts the next step, with the data of the neighbours received for it, or else the boundaries of the step before it
+ * and no migrating Vehicles
+ * @param time the step
+ * @return the step, with the data it uses, for the state at its start to be saved in
+ */
+WarpStep& TimeWarp::beginStep(int time) {
+    if (time != this->gvt + (int) this->steps.size()) {
+        throw std::logic_error("The steps of the optimistic execution are not consecutive");
+    }
+    this->steps.emplace_back();
+    WarpStep& step = this->steps.back();
+    const WarpStep* previous = this->steps.size() > 1 ? &this->steps[this->steps.size() - 2] : nullptr;
+    std::map<int, WarpInputs>::iterator inputs = this->received.find(time);
+    bool has_last = inputs != this->received.end() && inputs->second.has_last;
+    bool has_first = inputs != this->received.end() && inputs->second.has_first;
+
+    if (has_last) {
+        step.last_vehicles = inputs->second.last_vehicles;
+    } else {
+        step.last_vehicles = previous != nullptr ? previous->last_vehicles : this->committed_last;
+    }
+    if (has_first) {
+        step.first_vehicles = inputs->second.first_vehicles;
+        step.migrant_lanes = inputs->second.migrant_lanes;
+        step.migrants = inputs->second.migrants;
+    } else {
+        step.first_vehicles = previous != nullptr ? previous->first_vehicles : this->committed_first;
+    }
+
+    this->steps_run++;
+    this->peak_steps = std::max(this->peak_steps, (int) this->steps.size());
+    return step;
+}
+
+/**
+ * Sends the data of a step to the neighbouring processes that assume different data for the step: a different
+ * boundary than the last one they were sent before the step, or different migrating Vehicles than the ones they were
+ * sent for the step, if any
+ * @param curr_process pointer to the current process
+ * @param step the step
+ * @param last_vehicles the last vehicles of the process in the step, for the previous process
+ * @param first_vehicles the first vehicles of the process in the step, for the next process
+ * @param migrants the Vehicles that move to the next process in the step
+ */
+void TimeWarp::sendStep(Process* curr_process, int step, std::vector<int>& last_vehicles,
+                        std::vector<int>& first_vehicles, std::vector<Vehicle*>& migrants) {
+    OptimisticMessage message;
+    message.step = step;
+    if (this->prev_rank != -1) {
+        this->clampBoundary(last_vehicles, true);
+        WarpInputs& assumed = std::prev(this->sent[0].upper_bound(step))->second;
+        if (assumed.last_vehicles != last_vehicles) {
+            this->sent[0][step].last_vehicles = last_vehicles;
+            message.boundary = last_vehicles;
+            this->messages_sent++;
+            curr_process->sendOptimistic(this->prev_rank, message);
+        }
+    }
+    if (this->next_rank != -1) {
+        this->clampBoundary(first_vehicles, false);
+        std::map<int, WarpInputs>::iterator assumed = std::prev(this->sent[1].upper_bound(step));
+        bool same = assumed->second.first_vehicles == first_vehicles;
+        if (assumed->first == step) {
+            same = same && assumed->second.migrants.size() == migrants.size();
+            for (int i = 0; same && i < (int) migrants.size(); i++) {
+                same = assumed->second.migrants[i].hasSameState(*migrants[i]) &&
+                       assumed->second.migrant_lanes[i] == migrants[i]->getLanePtr()->getLaneNumber();
+            }
+        } else {
+            same = same && migrants.empty();
+        }
+        if (!same) {
+            message.boundary = first_vehicles;
+            for (Vehicle* vehicle : migrants) {
+                message.migrant_lanes.push_back(vehicle->getLanePtr()->getLaneNumber());
+                message.migrants.push_back(*vehicle);
+            }
+            WarpInputs& sent = this->sent[1][step];
+            sent.first_vehicles = message.boundary;
+            sent.migrant_lanes = message.migrant_lanes;
+            sent.migrants = message.migrants;
+            this->messages_sent++;
+            curr_process->sendOptimistic(this->next_rank, message);
+        }
+    }
+}
+
+/**
+ * Writes the steps that the process ran and rolled back, the most steps it held at a time, the messages it sent and
+ * the rounds of the global virtual time
+ * @param report the stream to write to
+ * @param rank rank of the process
+ */
+void TimeWarp::report(std::ostream& report, int rank) {
+    report << "Process : " << rank << " optimistic steps run: " << this->steps_run << ", rolled back: "
+           << this->steps_rolled_back << " in " << this->rollbacks << " rollbacks, window: " << this->window
+           << ", peak saved steps: " << this->peak_steps << ", messages sent: " << this->messages_sent
+           << ", GVT rounds: " << this->gvt_rounds << std::endl;
+}
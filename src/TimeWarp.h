@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_TIMEWARP_H
+#define CA_TRAFFIC_SIMULATION_TIMEWARP_H
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <ostream>
+
+#include "Inputs.h"
+#include "Vehicle.h"
+#include "Process.h"
+#include "Statistic.h"
+
+/**
+ * Structure for a step that a process ran before it was final: the state of the process at the start of the step, the
+ * data of the neighbouring processes that the step used, and the travel times of the Vehicles that left the road in
+ * the step, which only count once the step is final
+ */
+struct WarpStep {
+    std::vector<Vehicle> vehicles;
+    std::vector<int> steps_to_spawn;
+    int next_id;
+    int num_dropped;
+    unsigned int random_seed;
+    std::vector<int> last_vehicles;
+    std::vector<int> first_vehicles;
+    std::vector<int> migrant_lanes;
+    std::vector<Vehicle> migrants;
+    std::vector<double> travel_times;
+};
+
+/**
+ * Structure for the data of a step exchanged with the neighbouring processes, the last vehicles of the next process
+ * and the first vehicles and the migrating Vehicles of the previous one
+ */
+struct WarpInputs {
+    bool has_last = false;
+    bool has_first = false;
+    std::vector<int> last_vehicles;
+    std::vector<int> first_vehicles;
+    std::vector<int> migrant_lanes;
+    std::vector<Vehicle> migrants;
+};
+
+/**
+ * Class for the optimistic execution of the processes of a single road, which run a window of steps ahead of the
+ * global virtual time instead of waiting for their neighbours every step. A boundary holds from the step it was sent
+ * for until the next one, and the migrating Vehicles only in their step, so a process only sends the data of a step
+ * when it differs from what its neighbour assumes, and otherwise runs on the data it has. A step keeps a copy of the
+ * state at its start, and when the data of a neighbour differs from what a step assumed, the process rolls back to
+ * that step and runs it again.
+ *
+ * At the end of the window, the processes compute the global virtual time, the earliest step that any of them may
+ * still run again, from their next steps and the steps they have to roll back to once every message sent has been
+ * received. The steps before it are final: they are committed, their travel times counted and their copies of the
+ * state dropped, which bounds the memory to the window.
+ */
+class TimeWarp {
+private:
+    int window;
+    int max_time;
+    int num_lanes;
+    int prev_rank;
+    int next_rank;
+    int prev_limit;
+    int next_limit;
+    int gvt;
+    std::deque<WarpStep> steps;
+    std::map<int, WarpInputs> received;
+    std::map<int, WarpInputs> sent[2];
+    std::vector<int> committed_last;
+    std::vector<int> committed_first;
+    int rollback_step;
+    long messages_sent;
+    long messages_received;
+    long steps_run;
+    long rollbacks;
+    long steps_rolled_back;
+    long gvt_rounds;
+    int peak_steps;
+    void clampBoundary(std::vector<int>& boundary, bool last);
+    void checkBoundary(int step, int time, bool last, const std::vector<int>& boundary);
+    void rollBackTo(int step);
+    void commit(int gvt, Statistic* travel_time);
+public:
+    TimeWarp(Inputs inputs, Process* curr_process, int halo);
+    void receive(OptimisticMessage& message, int time);
+    int takeRollback();
+    WarpStep rollBack(int step, int time);
+    bool canRun(int time);
+    bool isFinished();
+    WarpStep& beginStep(int time);
+    void sendStep(Process* curr_process, int step, std::vector<int>& last_vehicles, std::vector<int>& first_vehicles,
+                  std::vector<Vehicle*>& migrants);
+    void computeGvt(Process* curr_process, int time, Statistic* travel_time);
+    void report(std::ostream& report, int rank);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_TIMEWARP_H
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#ifdef CATS_USE_MPI
+#include <mpi.h>
+#endif
+
+#include "Tracer.h"
+
+// Number of events that the ring buffer of a thread holds
+const int TRACE_CAPACITY = 1 << 16;
+
+// Buffers of all the registered threads, which outlive their threads until the trace is written
+static std::mutex buffers_mutex;
+static std::vector<TraceBuffer*> trace_buffers;
+
+// Buffer of the current thread, or nullptr if it is not registered
+static thread_local TraceBuffer* thread_buffer = nullptr;
+
+/**
+ * Starts recording the events of the threads that register
+ */
+void Tracer::start() {
+    tracing = true;
+}
+
+/**
+ * Registers the current thread, which allocates its ring buffer. The events of threads that did not register are not
+ * recorded.
+ * @param rank rank of the process of the thread, which is the track of its events
+ * @param thread number of the thread in its process
+ * @param thread_name name of the thread in the timeline
+ */
+void Tracer::registerThread(int rank, int thread, std::string thread_name) {
+    if (!tracing) {
+        return;
+    }
+    TraceBuffer* buffer = new TraceBuffer();
+    buffer->rank = rank;
+    buffer->thread = thread;
+    buffer->thread_name = thread_name;
+    buffer->events.resize(TRACE_CAPACITY);
+    buffer->num_events = 0;
+
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    trace_buffers.push_back(buffer);
+    thread_buffer = buffer;
+}
+
+/**
+ * Records an event of the current thread that ends now, over the oldest event once the buffer is full
+ * @param name name of the event
+ * @param begin time at which the event started
+ */
+void Tracer::record(const char* name, std::chrono::steady_clock::time_point begin) {
+    TraceBuffer* buffer = thread_buffer;
+    if (buffer == nullptr) {
+        return;
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    TraceEvent& event = buffer->events[buffer->num_events % TRACE_CAPACITY];
+    event.name = name;
+    event.begin = std::chrono::duration_cast<std::chrono::nanoseconds>(begin.time_since_epoch()).count();
+    event.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+    buffer->num_events++;
+}
+
+/**
+ * Writes the events of the buffers of this process as trace events, with the metadata that names the tracks
+ * @param stream the stream to write to
+ */
+static void writeEvents(std::ostream& stream) {
+    stream << std::fixed << std::setprecision(3);
+    for (TraceBuffer* buffer : trace_buffers) {
+        stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << buffer->rank
+               << ",\"args\":{\"name\":\"Process " << buffer->rank << "\"}},\n";
+        stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << buffer->rank << ",\"tid\":" << buffer->thread
+               << ",\"args\":{\"name\":\"" << buffer->thread_name << "\"}},\n";
+
+        // The oldest event in the buffer comes first
+        long first = std::max(0L, buffer->num_events - TRACE_CAPACITY);
+        for (long i = first; i < buffer->num_events; i++) {
+            TraceEvent& event = buffer->events[i % TRACE_CAPACITY];
+            stream << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":" << buffer->rank << ",\"tid\":"
+                   << buffer->thread << ",\"ts\":" << event.begin / 1000.0 << ",\"dur\":" << event.duration / 1000.0
+                   << "},\n";
+        }
+        if (first > 0) {
+            std::cout << "Tracer : process " << buffer->rank << " dropped its " << first << " oldest events"
+                      << std::endl;
+        }
+    }
+}
+
+/**
+ * Stops recording and writes the events of all the processes to a file in the trace-event JSON format, which trace
+ * viewers open as a timeline with a track for each rank. With MPI, the events are gathered on rank 0, which writes
+ * the file, and all the ranks must call it once their threads have finished. Without MPI, it must be called once all
+ * the threads have finished.
+ * @param file_name name of the file
+ */
+void Tracer::write(std::string file_name) {
+    if (!tracing) {
+        return;
+    }
+    tracing = false;
+
+    std::ostringstream events;
+    writeEvents(events);
+    std::string text = events.str();
+    for (TraceBuffer* buffer : trace_buffers) {
+        delete buffer;
+    }
+    trace_buffers.clear();
+    thread_buffer = nullptr;
+
+#ifdef CATS_USE_MPI
+    // Gather the events of all the ranks on rank 0
+    int rank, num_ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+    int length = text.size();
+    std::vector<int> lengths(num_ranks);
+    MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    std::vector<int> offsets(num_ranks, 0);
+    for (int i = 1; i < num_ranks; i++) {
+        offsets[i] = offsets[i - 1] + lengths[i - 1];
+    }
+    std::vector<char> all_text(rank == 0 ? offsets.back() + lengths.back() : 0);
+    MPI_Gatherv(text.data(), length, MPI_CHAR, all_text.data(), lengths.data(), offsets.data(), MPI_CHAR, 0,
+                MPI_COMM_WORLD);
+    if (rank != 0) {
+        return;
+    }
+    text.assign(all_text.begin(), all_text.end());
+#endif
+
+    // Every event ends with a separator, which the last one does not need
+    if (text.size() >= 2) {
+        text.resize(text.size() - 2);
+    }
+    std::ofstream file(file_name);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" << text << "\n]}\n";
+    std::cout << "Tracer : wrote the timeline to " << file_name << std::endl;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_TRACER_H
+#define CA_TRAFFIC_SIMULATION_TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Whether the events of the threads are recorded
+inline std::atomic<bool> tracing(false);
+
+/**
+ * Structure for an event of the timeline, with its start and duration in nanoseconds of the steady clock
+ */
+struct TraceEvent {
+    const char* name;
+    long long begin;
+    long long duration;
+};
+
+/**
+ * Structure for the ring buffer of the events of a thread, which keeps the latest events once it is full
+ */
+struct TraceBuffer {
+    int rank;
+    int thread;
+    std::string thread_name;
+    std::vector<TraceEvent> events;
+    long num_events;
+};
+
+/**
+ * Class for the tracer of the timeline of the simulation. Each thread that registers gets a ring buffer of events,
+ * allocated once, and records the phases of its steps and its exchanges into it without taking locks or allocating.
+ * The events of all the processes are written at the end in the trace-event JSON format, with a track for each rank.
+ */
+class Tracer {
+public:
+    static void start();
+    static void registerThread(int rank, int thread, std::string thread_name);
+    static void record(const char* name, std::chrono::steady_clock::time_point begin);
+    static void write(std::string file_name);
+};
+
+/**
+ * Class for an event of the timeline that lasts while it is in scope. An event can be followed directly by the next
+ * one, to trace consecutive phases without a scope for each.
+ */
+class TraceScope {
+private:
+    const char* name;
+    std::chrono::steady_clock::time_point begin;
+public:
+    /**
+     * Constructor for the TraceScope, which starts the event
+     * @param name name of the event, which must outlive the tracer
+     */
+    inline TraceScope(const char* name) {
+        this->name = name;
+        if (tracing.load(std::memory_order_relaxed)) {
+            this->begin = std::chrono::steady_clock::now();
+        }
+    }
+
+    /**
+     * Ends the current event and starts the next one
+     * @param name name of the next event, which must outlive the tracer
+     */
+    inline void next(const char* name) {
+        if (tracing.load(std::memory_order_relaxed)) {
+            Tracer::record(this->name, this->begin);
+            this->begin = std::chrono::steady_clock::now();
+        }
+        this->name = name;
+    }
+
+    /**
+     * Destructor for the TraceScope, which ends the event
+     */
+    inline ~TraceScope() {
+        if (tracing.load(std::memory_order_relaxed)) {
+            Tracer::record(this->name, this->begin);
+        }
+    }
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_TRACER_H
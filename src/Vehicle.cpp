@@ -4,20 +4,23 @@
 
 #include <cstdlib>
 #include <iomanip>
+#include <algorithm>
 
 #include "Statistic.h"
 #include "Vehicle.h"
 #include "Lane.h"
 #include "Road.h"
+#include "RulePolicies.h"
+#include "Random.h"
 
 /**
  * Constructor for the Vehicle
  * @param lane_ptr pointer to the Lane in which the Vehicle starts in
  * @param id unique ID number of the Vehicle
  * @param initial_position initial site number of the Vehicle in the Lane
- * @param inputs instance of the Inputs class with the simulation inputs
+ * @param class_id index of the class of the Vehicle in the table of Vehicle classes
  */
-Vehicle::Vehicle(Lane* lane_ptr, int id, int initial_position, Inputs inputs) {
+Vehicle::Vehicle(Lane* lane_ptr, int id, int initial_position, int class_id) {
     // Set the ID number of the Vehicle
     this->id = id;
 
@@ -27,26 +30,11 @@ Vehicle::Vehicle(Lane* lane_ptr, int id, int initial_position, Inputs inputs) {
     // Set the Lane pointer to the pointer to the Lane that contains the Vehicle
     this->lane_ptr = lane_ptr;
 
-    // Set the maximum speed of the Vehicle
-    this->max_speed = inputs.max_speed;
+    // Set the class of the Vehicle, which holds its driving parameters
+    this->class_id = (unsigned char) class_id;
 
     // Set the initial speed of the Vehicle to the maximum speed
-    this->speed = this->max_speed;
-
-    // Set the look forward distance of the Vehicle
-    this->look_forward = this->speed + 1;
-
-    // Set the other lane look forward distance of the Vehicle
-    this->look_other_forward = this->look_forward;
-
-    // Set the other lane look backward distance of the Vehicle
-    this->look_other_backward = inputs.look_other_backward;
-
-    // Set the slow down probability of the Vehicle
-    this->prob_slow_down = inputs.prob_slow_down;
-
-    // Set the lane change probability of the Vehicle
-    this->prob_change = inputs.prob_change;
+    this->speed = VehicleClass::table[this->class_id].max_speed;
 
     // Initialize the time spend on the Road
     this->time_on_road = 0;
@@ -57,80 +45,74 @@ Vehicle::~Vehicle() {}
 /**
  * Update the perceived gaps between the Vehicle and the surrounding Vehicles in the Road
  * @param road_ptr pointer to the Road that the Vehicle is in
+ * @param start_postition first site of the segment of the Road of the current process
+ * @param end_position last site of the segment of the Road of the current process
+ * @param first_vehicles last occupied site of each Lane in the previous processes, or -1
+ * @param last_vehicles first occupied site of each Lane in the next processes, or -1
+ * @param time current step of the simulation, which determines the other Lane of interest
  * @return 0 if successful, nonzero otherwise
-
  */
+template <class RuleSet>
 int Vehicle::updateGaps(Road* road_ptr, int start_postition, int end_position,
-                         std::vector<int> first_vehicles, std::vector<int> last_vehicles) {
+                        const std::vector<int>& first_vehicles, const std::vector<int>& last_vehicles, int time) {
     // Locate the preceding Vehicle and update the forward gap
     this->gap_forward = this->lane_ptr->getSize() - 1;
-    for (int i = this->position + 1; i <= end_position; i++) {
-        if (this->lane_ptr->hasVehicleInSite(i)) {
-            this->gap_forward = i - this->position - 1;
-            break;
-        }
-        // if last position is reached and there is not a vehicle, 
-        // and if the lane pointer of our lane is not -1 (so, there is a vehicle in our lane)
-        // update the gap based on the vehicle ahead
-        if(i == end_position && last_vehicles[this->lane_ptr->getLaneNumber()] != -1){
-            this->gap_forward = std::max(last_vehicles[this->lane_ptr->getLaneNumber()] - this->position - 1, 0);
-#ifdef DEBUG           
-            printf("vehicle %d, gap_forward: %d\n", this->id, this->gap_forward);
+    int next_site = this->lane_ptr->nextOccupiedSite(this->position + 1, end_position);
+    if (next_site != -1) {
+        this->gap_forward = next_site - this->position - 1;
+    }
+    // if last position is reached and there is not a vehicle,
+    // and if the lane pointer of our lane is not -1 (so, there is a vehicle in our lane)
+    // update the gap based on the vehicle ahead
+    else if (this->position < end_position && last_vehicles[this->lane_ptr->getLaneNumber()] != -1) {
+        this->gap_forward = std::max(last_vehicles[this->lane_ptr->getLaneNumber()] - this->position - 1, 0);
+#ifdef DEBUG
+        printf("vehicle %d, gap_forward: %d\n", this->id, this->gap_forward);
 #endif
-            break;
-        }
     }
 
-    // Update vehicle look forward distances
-    this->look_forward = this->speed + 1;
-    this->look_other_forward = this->look_forward;
-
-    // Determine the other lane of interest
-    Lane* other_lane_ptr;
-    if (this->lane_ptr->getLaneNumber() == 0) {
-        other_lane_ptr = road_ptr->getLanes()[1];
-    } else {
-        other_lane_ptr = road_ptr->getLanes()[0];
+    // Determine the other lane of interest, there are no gaps in the other lane if there is none
+    int other_lane = targetLane<RuleSet::num_lanes>(this->lane_ptr->getLaneNumber(), road_ptr->getNumLanes(), time);
+    if (other_lane == -1) {
+        this->gap_other_forward = -1;
+        this->gap_other_backward = -1;
+        return 0;
     }
+    Lane* other_lane_ptr = road_ptr->getLane(other_lane);
 
     // Update the forward gap in the other lane
     this->gap_other_forward = this->lane_ptr->getSize() - 1;
-    for (int i = this->position; i <= end_position; i++) {
+    if (this->position <= end_position) {
+        next_site = other_lane_ptr->nextOccupiedSite(this->position, end_position);
         //if there is a vehicle in the other lane, in the same position as this vehicle
-        if(first_vehicles[other_lane_ptr->getLaneNumber()] == this->position){
-            this->gap_other_forward = i - this->position - 1;
-            break;
+        if (first_vehicles[other_lane_ptr->getLaneNumber()] == this->position) {
+            this->gap_other_forward = -1;
+        } else if (next_site != -1) {
+            this->gap_other_forward = next_site - this->position - 1;
         }
-
-        if (other_lane_ptr->hasVehicleInSite(i)) {
-            this->gap_other_forward = i - this->position - 1;
-            break;
-        }
-        // if last position is reached and there is not a vehicle, 
+        // if last position is reached and there is not a vehicle,
         // and if the lane pointer of the other lane is not -1 (so, there is a vehicle in the other lane)
         // update the gap based on the vehicle ahead
-        if(i == end_position && last_vehicles[other_lane_ptr->getLaneNumber()] != -1){
+        else if (last_vehicles[other_lane_ptr->getLaneNumber()] != -1) {
             this->gap_other_forward = std::max(last_vehicles[other_lane_ptr->getLaneNumber()] - this->position - 1, 0);
 #ifdef DEBUG
             printf("vehicle %d, gap_other_forward: %d\n", this->id, this->gap_other_forward);
 #endif
-            break;
         }
     }
 
     // Update the backward gap in the other lane
     this->gap_other_backward = this->lane_ptr->getSize() - 1;
-    for (int i = this->position; i >= start_postition; i--) {
-        if (other_lane_ptr->hasVehicleInSite(i)) {
-            this->gap_other_backward = this->position - i - 1;
-            break;
+    if (this->position >= start_postition) {
+        int previous_site = other_lane_ptr->lastOccupiedSite(start_postition, this->position);
+        if (previous_site != -1) {
+            this->gap_other_backward = this->position - previous_site - 1;
         }
-        // if starting position is reached and there is not a vehicle there, 
+        // if starting position is reached and there is not a vehicle there,
         // and if the  other lane pointer of our lane is not -1 (so, there is a vehicle in lane)
         // update the backward gap based on the vehicle behind
-        if(i == start_postition && first_vehicles[other_lane_ptr->getLaneNumber()] != -1){
+        else if (first_vehicles[other_lane_ptr->getLaneNumber()] != -1) {
             this->gap_other_backward = std::max(this->position - first_vehicles[other_lane_ptr->getLaneNumber()] - 1, 0);
-            break;
         }
     }
 
@@ -139,24 +121,135 @@ int Vehicle::updateGaps(Road* road_ptr, int start_postition, int end_position,
 }
 
 /**
- * Moved the Vehicle to the other Lane in the Road
+ * Update the perceived gaps of all the Vehicles of a Lane, from the Vehicles of the Lane and of the other Lane of
+ * interest sorted by position. The preceding Vehicle is the next one in the list, and the Vehicles around each Vehicle
+ * in the other Lane are found with a walk over the other list alongside the list of the Lane, which gives the same
+ * gaps as updateGaps without scanning the sites.
+ * @param lane_vehicles the Vehicles of the Lane, sorted by position
+ * @param other_vehicles the Vehicles of the other Lane of interest sorted by position, or nullptr if there is none
+ * @param other_lane number of the other Lane of interest, or -1 if there is none
+ * @param start_position first site of the segment of the Road of the current process
+ * @param end_position last site of the segment of the Road of the current process
+ * @param first_vehicles last occupied site of each Lane in the previous processes, or -1
+ * @param last_vehicles first occupied site of each Lane in the next processes, or -1
+ */
+void Vehicle::updateLaneGaps(const std::vector<Vehicle*>& lane_vehicles, const std::vector<Vehicle*>* other_vehicles,
+                             int other_lane, int start_position, int end_position,
+                             const std::vector<int>& first_vehicles, const std::vector<int>& last_vehicles) {
+    int num_vehicles = lane_vehicles.size();
+    int num_other = other_vehicles != nullptr ? other_vehicles->size() : 0;
+
+    // Index of the first Vehicle of the other Lane that is not behind the current Vehicle
+    int other = 0;
+    for (int i = 0; i < num_vehicles; i++) {
+        Vehicle* vehicle = lane_vehicles[i];
+        int position = vehicle->position;
+        int size = vehicle->lane_ptr->getSize();
+
+        // The preceding Vehicle is the next one in the Lane that is ahead
+        int ahead = i + 1;
+        while (ahead < num_vehicles && lane_vehicles[ahead]->position <= position) {
+            ahead++;
+        }
+        vehicle->updateForwardGap(ahead < num_vehicles ? lane_vehicles[ahead]->position : -1, end_position,
+                                  last_vehicles);
+
+        if (other_vehicles == nullptr) {
+            vehicle->gap_other_forward = -1;
+            vehicle->gap_other_backward = -1;
+            continue;
+        }
+        while (other < num_other && (*other_vehicles)[other]->position < position) {
+            other++;
+        }
+
+        // Update the forward gap in the other lane, from the first Vehicle there that is not behind
+        vehicle->gap_other_forward = size - 1;
+        if (position <= end_position) {
+            int next_site = other < num_other && (*other_vehicles)[other]->position <= end_position
+                            ? (*other_vehicles)[other]->position : -1;
+            if (first_vehicles[other_lane] == position) {
+                vehicle->gap_other_forward = -1;
+            } else if (next_site != -1) {
+                vehicle->gap_other_forward = next_site - position - 1;
+            } else if (last_vehicles[other_lane] != -1) {
+                vehicle->gap_other_forward = std::max(last_vehicles[other_lane] - position - 1, 0);
+            }
+        }
+
+        // Update the backward gap in the other lane, from the Vehicle there alongside or the last one behind
+        vehicle->gap_other_backward = size - 1;
+        if (position >= start_position) {
+            int previous_site = -1;
+            if (other < num_other && (*other_vehicles)[other]->position == position) {
+                previous_site = position;
+            } else if (other > 0 && (*other_vehicles)[other - 1]->position >= start_position) {
+                previous_site = (*other_vehicles)[other - 1]->position;
+            }
+            if (previous_site != -1) {
+                vehicle->gap_other_backward = position - previous_site - 1;
+            } else if (first_vehicles[other_lane] != -1) {
+                vehicle->gap_other_backward = std::max(position - first_vehicles[other_lane] - 1, 0);
+            }
+        }
+    }
+}
+
+/**
+ * Update the perceived gap of the Vehicle to the preceding Vehicle in its Lane
+ * @param next_site position of the preceding Vehicle in the Lane, or -1 if there is none
+ * @param end_position last site of the segment of the Road of the current process
+ * @param last_vehicles first occupied site of each Lane in the next processes, or -1
+ */
+void Vehicle::updateForwardGap(int next_site, int end_position, const std::vector<int>& last_vehicles) {
+    int lane_num = this->lane_ptr->getLaneNumber();
+    this->gap_forward = this->lane_ptr->getSize() - 1;
+    if (next_site != -1 && next_site <= end_position) {
+        this->gap_forward = next_site - this->position - 1;
+    } else if (this->position < end_position && last_vehicles[lane_num] != -1) {
+        this->gap_forward = std::max(last_vehicles[lane_num] - this->position - 1, 0);
+    }
+}
+
+/**
+ * Decides whether the Vehicle changes to the other Lane in the Road, if the lane change rules of the rule policy allow
+ * it. Only reads the gaps and the state of the Vehicle, and changes nothing.
+ * @param road_ptr pointer to the Road in which the Vehicle is on
+ * @param time current step of the simulation, which determines the other Lane of interest
+ * @return number of the Lane that the Vehicle changes to, or -1 if it stays in its Lane
+ */
+template <class RuleSet>
+int Vehicle::decideLaneSwitch(Road* road_ptr, int time) {
+    const VehicleClass& vehicle_class = VehicleClass::table[this->class_id];
+
+    // Determine the lane that the Vehicle could switch to
+    int lane_num = this->lane_ptr->getLaneNumber();
+    int other_lane = targetLane<RuleSet::num_lanes>(lane_num, road_ptr->getNumLanes(), time);
+    if (other_lane == -1) {
+        return -1;
+    }
+
+    // Evaluate if the Vehicle will change lanes
+    bool to_left = other_lane > lane_num;
+    if (RuleSet::rules::wantsLaneChange(this->speed, this->gap_forward, this->gap_other_forward, to_left) &&
+        this->gap_other_backward > vehicle_class.look_other_backward &&
+        vehicleUniform(this->id, this->time_on_road, STREAM_LANE_CHANGE) <= vehicle_class.prob_change ) {
+        return other_lane;
+    }
+    return -1;
+}
+
+/**
+ * Moved the Vehicle to the other Lane in the Road, if the lane change rules of the rule policy allow it
  * @param road_ptr pointer to the Road in which the Vehicle is on
+ * @param time current step of the simulation, which determines the other Lane of interest
  * @return 0 if successful, nonzero otherwise
  */
-int Vehicle::performLaneSwitch(Road* road_ptr) {
-    // Evaluate if the Vehicle will change lanes and then perform the lane change
-    if (this->gap_forward < this->look_forward &&
-        this->gap_other_forward > this->look_other_forward &&
-        this->gap_other_backward > this->look_other_backward &&
-        ((double) rand()) / ((double) RAND_MAX) <= this->prob_change ) {
-
-        // Determine the lane that the Vehicle is switching to
-        Lane* other_lane_ptr;
-        if (this->lane_ptr->getLaneNumber() == 0) {
-            other_lane_ptr = road_ptr->getLanes()[1];
-        } else {
-            other_lane_ptr = road_ptr->getLanes()[0];
-        }
+template <class RuleSet>
+int Vehicle::performLaneSwitch(Road* road_ptr, int time) {
+    int other_lane = this->decideLaneSwitch<RuleSet>(road_ptr, time);
+    if (other_lane != -1) {
+        Lane* other_lane_ptr = road_ptr->getLane(other_lane);
 
 #ifdef DEBUG
         std::cout << "vehicle " << this->id << " switched lane " << this->lane_ptr->getLaneNumber() << " -> "
@@ -178,15 +271,24 @@ int Vehicle::performLaneSwitch(Road* road_ptr) {
 }
 
 /**
- * Moves the Vehicle to the next site in the current Lane during the time-step based on the speed of the Vehicle
- * @return 0 if successful, nonzero otherwise
+ * Updates the speed of the Vehicle and its time on the road during the time-step, based on the speed update rules of
+ * the rule policy, and records its move over the detectors. Only reads the gaps and the state of the Vehicle, and does
+ * not move it in its Lane.
+ * @return the site that the Vehicle moves to, beyond the last site of the Lane if it leaves the road
  */
-int Vehicle::performLaneMove() {
+template <class RuleSet>
+int Vehicle::advance() {
+    const VehicleClass& vehicle_class = VehicleClass::table[this->class_id];
+    const int max_speed = RuleSet::max_speed != 0 ? RuleSet::max_speed : vehicle_class.max_speed;
+
+    // Obtain the slow down probability from the speed at the start of the step
+    double prob_slow_down = RuleSet::rules::slowDownProbability(vehicle_class, this->speed, max_speed);
+
     // Increment the time on road counter
     this->time_on_road++;
 
     // Update Vehicle speed based on vehicle speed update rules
-    if (this->speed != this->max_speed) {
+    if (this->speed != max_speed) {
         this->speed++;
 #ifdef DEBUG
         std::cout << "vehicle " << this->id << " increased speed " << this->speed - 1 << " -> " << this->speed
@@ -202,7 +304,7 @@ int Vehicle::performLaneMove() {
 #endif
 
     if (this->speed > 0) {
-        if ( ((double) rand()) / ((double) RAND_MAX) <= this->prob_slow_down ) {
+        if ( vehicleUniform(this->id, this->time_on_road, STREAM_SLOW_DOWN) <= prob_slow_down ) {
             this->speed--;
 #ifdef DEBUG
             std::cout << "vehicle " << this->id << " decreased speed " << this->speed + 1 << " -> " << this->speed
@@ -211,6 +313,20 @@ int Vehicle::performLaneMove() {
         }
     }
 
+    // Record the move over the detectors of the Lane, including the part beyond the end of the road
+    this->lane_ptr->recordMove(this->position, this->position + this->speed);
+    return this->position + this->speed;
+}
+
+/**
+ * Moves the Vehicle to the next site in the current Lane during the time-step based on the speed of the Vehicle and
+ * the speed update rules of the rule policy
+ * @return 0 if successful, nonzero otherwise
+ */
+template <class RuleSet>
+int Vehicle::performLaneMove() {
+    this->advance<RuleSet>();
+
     if (this->speed > 0) {
         // Compute the new position of the vehicle
         int new_position = (this->position + this->speed) % this->lane_ptr->getSize();
@@ -262,12 +378,20 @@ int Vehicle::getId() {
     return this->id;
 }
 
+/**
+ * Getter method for the class of the Vehicle
+ * @return index of the class of the Vehicle in the table of Vehicle classes
+ */
+int Vehicle::getClassId() {
+    return this->class_id;
+}
+
 /**
  * Getter method for the total time the Vehicle has spent on the Road
  * @param inputs
  * @return
  */
-double Vehicle::getTravelTime(Inputs inputs) {
+double Vehicle::getTravelTime(const Inputs& inputs) {
     return inputs.step_size * this->time_on_road;
 }
 
@@ -319,4 +443,24 @@ bool Vehicle::isInList(std::vector<Vehicle *>& vehicles){
 
 void Vehicle::setId(int id){
     this->id = id;
-}
\ No newline at end of file
+}
+
+/**
+ * Checks whether another Vehicle has the same state as the Vehicle, the state that moves between the processes
+ * @param other the other Vehicle
+ * @return true if the ids, positions, speeds, times on the road and classes are the same, false otherwise
+ */
+bool Vehicle::hasSameState(const Vehicle& other) const {
+    return this->id == other.id && this->position == other.position && this->speed == other.speed &&
+           this->time_on_road == other.time_on_road && this->class_id == other.class_id;
+}
+
+// Instantiate the update kernel for every RuleSet that the simulation can select
+#define INSTANTIATE_VEHICLE_KERNEL(...) \
+    template int Vehicle::updateGaps<__VA_ARGS__>(Road*, int, int, const std::vector<int>&, const std::vector<int>&, \
+                                                  int); \
+    template int Vehicle::decideLaneSwitch<__VA_ARGS__>(Road*, int); \
+    template int Vehicle::performLaneSwitch<__VA_ARGS__>(Road*, int); \
+    template int Vehicle::advance<__VA_ARGS__>(); \
+    template int Vehicle::performLaneMove<__VA_ARGS__>();
+INSTANTIATE_RULE_SETS(INSTANTIATE_VEHICLE_KERNEL)
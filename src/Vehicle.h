@@ -8,6 +8,7 @@
 #include "Inputs.h"
 #include "Road.h"
 #include "Statistic.h"
+#include "VehicleClass.h"
 
 // Forward declarations
 class Lane;
@@ -23,27 +24,35 @@ private:
     int id;
     int position;
     int speed;
-    int max_speed;
     int gap_forward;
     int gap_other_forward;
     int gap_other_backward;
-    int look_forward;
-    int look_other_forward;
-    int look_other_backward;
-    double prob_slow_down;
-    double prob_change;
     int time_on_road;
+    unsigned char class_id;
 
 public:
     Vehicle(){}
-    Vehicle(Lane* lane_ptr, int id, int initial_position, Inputs inputs);
+    Vehicle(Lane* lane_ptr, int id, int initial_position, int class_id);
     ~Vehicle();
+    template <class RuleSet>
     int updateGaps(Road* road_ptr, int start_postition, int end_position,
-                        std::vector<int> first_vehicles, std::vector<int> last_vehicles);
-    int performLaneSwitch(Road* road_ptr);
+                   const std::vector<int>& first_vehicles, const std::vector<int>& last_vehicles, int time);
+    static void updateLaneGaps(const std::vector<Vehicle*>& lane_vehicles,
+                               const std::vector<Vehicle*>* other_vehicles, int other_lane, int start_position,
+                               int end_position, const std::vector<int>& first_vehicles,
+                               const std::vector<int>& last_vehicles);
+    void updateForwardGap(int next_site, int end_position, const std::vector<int>& last_vehicles);
+    template <class RuleSet>
+    int decideLaneSwitch(Road* road_ptr, int time);
+    template <class RuleSet>
+    int performLaneSwitch(Road* road_ptr, int time);
+    template <class RuleSet>
+    int advance();
+    template <class RuleSet>
     int performLaneMove();
     int getId();
-    double getTravelTime(Inputs inputs);
+    int getClassId();
+    double getTravelTime(const Inputs& inputs);
     int setSpeed(int speed);
     int getPosition();
     int getSpeed();
@@ -53,6 +62,7 @@ public:
     void setId(int id);
 
     bool isInList(std::vector<Vehicle *>& vehicles);
+    bool hasSameState(const Vehicle& other) const;
 
     // MpiProcess gets access to the private fields
     friend class MpiProcess;
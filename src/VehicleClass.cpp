@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+
+#include "VehicleClass.h"
+#include "Random.h"
+
+// Table of the Vehicle classes of the simulation
+std::vector<VehicleClass> VehicleClass::table;
+
+/**
+ * Loads the table of Vehicle classes from a comma delimited text file, with one class per line given as
+ * "<name>,<mix>,<max_speed>,<prob_slow_down>,<prob_change>,<look_other_backward>[,<prob_slow_to_start>]", where the
+ * mix is the fraction of the spawned Vehicles that belong to the class. If the file does not exist, the table has a
+ * single class of cars with the parameters of the simulation inputs.
+ * @param file_name path and name of the file to read
+ * @param inputs instance of the Inputs class with the simulation inputs
+ * @return 0 if successful, nonzero otherwise
+ */
+int VehicleClass::loadTable(std::string file_name, Inputs inputs) {
+    table.clear();
+
+    // Open the file containing the Vehicle classes, which is optional
+    std::ifstream file(file_name);
+    if (!file) {
+        table.push_back({"car", 1.0, inputs.max_speed, inputs.look_other_backward, inputs.prob_slow_down,
+                         inputs.prob_change, inputs.prob_slow_to_start});
+        return 0;
+    }
+
+    // Read each line into a Vehicle class
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::vector<std::string> fields;
+        std::stringstream line_stream(line);
+        std::string field;
+        while (std::getline(line_stream, field, ',')) {
+            fields.push_back(field);
+        }
+        if (fields.size() != 6 && fields.size() != 7) {
+            std::cout << "error: malformed line \"" << line << "\" in " << file_name << " file!" << std::endl;
+            return 1;
+        }
+
+        double prob_slow_to_start = fields.size() == 7 ? std::stod(fields[6]) : inputs.prob_slow_to_start;
+        table.push_back({fields[0], std::stod(fields[1]), std::stoi(fields[2]), std::stoi(fields[5]),
+                         std::stod(fields[3]), std::stod(fields[4]), prob_slow_to_start});
+    }
+
+    // The class ids of the Vehicles are stored in a single byte
+    if (table.empty() || table.size() > 256) {
+        std::cout << "error: " << file_name << " file must have between 1 and 256 classes!" << std::endl;
+        return 1;
+    }
+
+    // Normalize the mix of the classes into a cumulative distribution
+    double sum = 0.0;
+    for (VehicleClass& vehicle_class : table) {
+        sum += vehicle_class.mix;
+    }
+    double cumulative = 0.0;
+    for (VehicleClass& vehicle_class : table) {
+        cumulative += vehicle_class.mix / sum;
+        vehicle_class.mix = cumulative;
+    }
+
+    // Close the file
+    file.close();
+
+    // Return with no errors
+    return 0;
+}
+
+/**
+ * Randomly chooses the class of a spawned Vehicle based on the mix of the classes
+ * @return index of the class in the table
+ */
+int VehicleClass::sampleClass() {
+    return sampleClass(randomUniform());
+}
+
+/**
+ * Chooses the class of a spawned Vehicle based on the mix of the classes with a given uniform random number
+ * @param u uniformly distributed number in [0, 1]
+ * @return index of the class in the table
+ */
+int VehicleClass::sampleClass(double u) {
+    for (int i = 0; i < (int) table.size(); i++) {
+        if (table[i].mix >= u) {
+            return i;
+        }
+    }
+    return table.size() - 1;
+}
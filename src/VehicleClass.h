@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#ifndef CA_TRAFFIC_SIMULATION_VEHICLECLASS_H
+#define CA_TRAFFIC_SIMULATION_VEHICLECLASS_H
+
+#include <vector>
+#include <string>
+
+#include "Inputs.h"
+
+/**
+ * Class for a class of Vehicles, like cars, trucks or buses, with the driving parameters shared by all the Vehicles of
+ * the class. The classes of the simulation are kept in a table that Vehicles refer to by the index of their class.
+ */
+class VehicleClass {
+public:
+    std::string name;
+    double mix;
+    int max_speed;
+    int look_other_backward;
+    double prob_slow_down;
+    double prob_change;
+    double prob_slow_to_start;
+
+    static std::vector<VehicleClass> table;
+    static int loadTable(std::string file_name, Inputs inputs);
+    static int sampleClass();
+    static int sampleClass(double u);
+};
+
+
+#endif //CA_TRAFFIC_SIMULATION_VEHICLECLASS_H
@@ -3,45 +3,182 @@
  */
 
 #include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <mutex>
 
 #include "Inputs.h"
 #include "Simulation.h"
+#include "NetworkSimulation.h"
+#include "Network.h"
+#include "VehicleClass.h"
+#include "Detectors.h"
+#include "Ramps.h"
+#include "ArrivalTrace.h"
+#include "Jams.h"
+#include "Random.h"
+#include "Tracer.h"
+#include "PhaseCounters.h"
+#ifdef CATS_USE_MPI
 #include "MpiProcess.h"
+#else
+#include <thread>
+#include "ThreadProcess.h"
+#endif
 
 /**
- * Main point of execution of the program
- * @param argc number of command line arguments
- * @param argv command line arguments
+ * Runs the simulation of the part of the road or of the network of a process
+ * @param curr_process pointer to the current process
  * @return 0 if successful, nonzero otherwise
  */
-int main(int argc, char** argv) {
-    std::cout << "================================================" << std::endl;
-    std::cout << "||    CELLULAR AUTOMATA TRAFFIC SIMULATION    ||" << std::endl;
-    std::cout << "================================================" << std::endl;
-
+int runProcess(Process* curr_process) {
 #ifndef DEBUG
-    srand(time(NULL));
+    seedRandom(time(NULL) + curr_process->getRank());
 #endif
+    Tracer::registerThread(curr_process->getRank(), 0, "simulation");
+    PhaseCounters::registerThread();
 
-    MpiProcess* curr_process = new MpiProcess(argc, argv);
-    
     //Read the inputs from the file and broadcast them to all processes
     Config config;
     Inputs inputs = curr_process->broadcastConfig(config);
 
-    // Create a Simulation object for the current simulation
-    Simulation* simulation_ptr = new Simulation(inputs);
+    // Load the table of Vehicle classes shared by all the Vehicles, once for all the processes that are threads
+    static std::once_flag classes_loaded;
+    static int classes_status;
+    std::call_once(classes_loaded, [&inputs] {
+        classes_status = VehicleClass::loadTable("vehicle-classes.dat", inputs);
+        seedVehicles(inputs.seed);
+    });
+    if (classes_status != 0) {
+        throw std::runtime_error("Failed to load the vehicle classes from vehicle-classes.dat");
+    }
+
+    // Load the road network if there is one, otherwise simulate a single road divided between the processes
+    Network network;
+    int status = network.loadFromFile("road-network.dat");
+    if (status == 2) {
+        throw std::runtime_error("Failed to load the road network from road-network.dat");
+    }
+
+    // Load the virtual loop detectors if there are any
+    Detectors detectors;
+    if (detectors.loadFromFile("detectors.dat", inputs) == 2) {
+        throw std::runtime_error("Failed to load the detectors from detectors.dat");
+    }
+
+    // Load the on-ramps and off-ramps of a single road if there are any
+    Ramps ramps;
+    int ramps_status = ramps.loadFromFile("ramps.dat", inputs);
+    if (ramps_status == 2) {
+        throw std::runtime_error("Failed to load the ramps from ramps.dat");
+    }
+    if (ramps_status == 0 && status == 0) {
+        throw std::runtime_error("Ramps are only supported on a single road, not on a road network");
+    }
 
-    curr_process->divideRoad(inputs.length);
+    // Map the trace of recorded arrivals at the start of a single road if there is one
+    ArrivalTrace arrival_trace;
+    int arrivals_status = arrival_trace.loadFromFile("arrivals.bin");
+    if (arrivals_status == 2) {
+        throw std::runtime_error("Failed to load the arrivals from arrivals.bin");
+    }
+    if (arrivals_status == 0 && status == 0) {
+        throw std::runtime_error("Arrival traces are only supported on a single road, not on a road network");
+    }
 
-    // Run the Simulation
-    simulation_ptr->run_simulation(curr_process);
+    // Load the definition of the jams to track on a single road if there is one
+    Jams jams;
+    int jams_status = jams.loadFromFile("jams.dat", inputs);
+    if (jams_status == 2) {
+        throw std::runtime_error("Failed to load the jams from jams.dat");
+    }
+    if (jams_status == 0 && status == 0) {
+        throw std::runtime_error("Jams are only tracked on a single road, not on a road network");
+    }
 
-    // Delete the Simulation object
-    delete simulation_ptr;
+    if (status == 0) {
+        // Partition the segments of the network between the processes
+        network.partition(curr_process->getNumOfProcesses(), inputs.num_lanes);
 
-    MPI_Finalize();
+        // Create and run a NetworkSimulation object for the segments of the current process
+        NetworkSimulation* network_simulation_ptr = new NetworkSimulation(inputs, &network, &detectors, curr_process);
+        network_simulation_ptr->run_simulation(curr_process);
+        delete network_simulation_ptr;
+    } else {
+        // Create a Simulation object for the current simulation
+        Simulation* simulation_ptr = new Simulation(inputs, &detectors, &ramps, &arrival_trace, &jams);
+
+        curr_process->divideRoad(inputs);
+
+        // Run the Simulation
+        simulation_ptr->run_simulation(curr_process);
+
+        // Delete the Simulation object
+        delete simulation_ptr;
+    }
 
     // Return with no errors
     return 0;
 }
+
+/**
+ * Main point of execution of the program. With MPI, each rank is a process of the simulation. Without MPI, the
+ * processes are threads, as many as given with "-np N" or as the hardware supports otherwise. With "-trace", the
+ * timeline of the processes is written to "trace.json" at the end.
+ * @param argc number of command line arguments
+ * @param argv command line arguments
+ * @return 0 if successful, nonzero otherwise
+ */
+int main(int argc, char** argv) {
+    std::cout << "================================================" << std::endl;
+    std::cout << "||    CELLULAR AUTOMATA TRAFFIC SIMULATION    ||" << std::endl;
+    std::cout << "================================================" << std::endl;
+
+    bool trace = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-trace") == 0) {
+            trace = true;
+        } else if (strcmp(argv[i], "-counters") == 0) {
+            PhaseCounters::start();
+        }
+    }
+
+#ifdef CATS_USE_MPI
+    MpiProcess* curr_process = new MpiProcess(argc, argv);
+    if (trace) {
+        Tracer::start();
+    }
+    int status = runProcess(curr_process);
+    Tracer::write("trace.json");
+    delete curr_process;
+    return status;
+#else
+    int num_threads = std::max(1, (int) std::thread::hardware_concurrency());
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "-np") == 0) {
+            num_threads = std::max(1, atoi(argv[i + 1]));
+        }
+    }
+    std::cout << "Running with " << num_threads << " threads" << std::endl;
+
+    if (trace) {
+        Tracer::start();
+    }
+
+    // Run each process of the simulation in its own thread
+    ThreadGroup group(num_threads);
+    std::vector<int> statuses(num_threads, 0);
+    std::vector<std::thread> threads;
+    for (int rank = 0; rank < num_threads; rank++) {
+        threads.emplace_back([&group, &statuses, rank] {
+            ThreadProcess curr_process(&group, rank);
+            statuses[rank] = runProcess(&curr_process);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    Tracer::write("trace.json");
+    return *std::max_element(statuses.begin(), statuses.end());
+#endif
+}
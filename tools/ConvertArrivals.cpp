@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2019 Maitreya Venkataswamy - All Rights Reserved
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../src/ArrivalTrace.h"
+
+/**
+ * Options of the converter, parsed from the command line
+ */
+struct ConvertOptions {
+    std::string input;
+    std::string output = "arrivals.bin";
+    std::string classes;
+    double time_scale = 1.0;
+    double speed_scale = 1.0;
+};
+
+/**
+ * Prints the usage of the converter
+ */
+void printUsage() {
+    std::cout << "usage: cats-convert-arrivals <arrivals CSV file> [options]" << std::endl
+              << "  The CSV file has a line \"time,lane,speed,class\" per arrival, with an optional header line. An"
+              << std::endl
+              << "  empty speed enters at the maximum speed of the class, and an empty class is drawn from the mix."
+              << std::endl
+              << "  --output FILE       trace of arrivals to write (default arrivals.bin)" << std::endl
+              << "  --classes FILE      vehicle classes file, to give the classes by name (e.g. vehicle-classes.dat)"
+              << std::endl
+              << "  --time-scale F      factor from the times of the CSV file to the units of the interarrival times"
+              << " (default 1)" << std::endl
+              << "  --speed-scale F     factor from the speeds of the CSV file to sites per step (default 1)"
+              << std::endl;
+}
+
+/**
+ * Parses a positive finite factor from a command line argument
+ * @param text the argument
+ * @param value the factor to fill
+ * @return 0 if successful, nonzero if the argument is not a positive finite number
+ */
+int parseFactor(const std::string& text, double& value) {
+    char* end = nullptr;
+    double number = std::strtod(text.c_str(), &end);
+    if (text.empty() || *end != '\0' || !std::isfinite(number) || number <= 0.0) {
+        return 1;
+    }
+    value = number;
+    return 0;
+}
+
+/**
+ * Parses the command line into the options of the converter
+ * @param argc number of command line arguments
+ * @param argv command line arguments
+ * @param options the options to fill
+ * @return 0 if successful, nonzero otherwise
+ */
+int parseArguments(int argc, char** argv, ConvertOptions& options) {
+    if (argc < 2 || (argc - 2) % 2 != 0) {
+        return 1;
+    }
+    options.input = argv[1];
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        if (flag == "--output") {
+            options.output = value;
+        } else if (flag == "--classes") {
+            options.classes = value;
+        } else if (flag == "--time-scale") {
+            if (parseFactor(value, options.time_scale) != 0) {
+                return 1;
+            }
+        } else if (flag == "--speed-scale") {
+            if (parseFactor(value, options.speed_scale) != 0) {
+                return 1;
+            }
+        } else {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Splits a line of a CSV file into its fields
+ * @param line the line
+ * @return the fields of the line
+ */
+std::vector<std::string> splitFields(const std::string& line) {
+    std::vector<std::string> fields;
+    std::stringstream line_stream(line);
+    std::string field;
+    while (std::getline(line_stream, field, ',')) {
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+/**
+ * Reads the names of the Vehicle classes, in the order of their ids, from a vehicle classes file
+ * @param file_name name of the file
+ * @param names the names to fill
+ * @return 0 if successful, nonzero otherwise
+ */
+int readClassNames(std::string file_name, std::vector<std::string>& names) {
+    std::ifstream file(file_name);
+    if (!file) {
+        std::cout << "error: cannot open " << file_name << " file!" << std::endl;
+        return 1;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        names.push_back(splitFields(line)[0]);
+    }
+    return 0;
+}
+
+/**
+ * Parses the class of an arrival, given by its id or by its name
+ * @param field the class field of the CSV line
+ * @param names the names of the Vehicle classes
+ * @param class_id the id of the class to fill, -1 to draw it from the mix
+ * @return 0 if successful, nonzero otherwise
+ */
+int parseClass(const std::string& field, const std::vector<std::string>& names, int32_t& class_id) {
+    if (field.empty()) {
+        class_id = -1;
+        return 0;
+    }
+    std::vector<std::string>::const_iterator name = std::find(names.begin(), names.end(), field);
+    if (name != names.end()) {
+        class_id = name - names.begin();
+        return 0;
+    }
+    size_t end;
+    try {
+        class_id = std::stoi(field, &end);
+    } catch (std::exception&) {
+        return 1;
+    }
+    return end == field.size() && class_id >= 0 && (names.empty() || class_id < (int) names.size()) ? 0 : 1;
+}
+
+/**
+ * Converter of recorded arrivals at the start of the road, like the logs of a detector, from a CSV file to the trace
+ * of arrivals that cats memory-maps from arrivals.bin. The arrivals are sorted by time, so that cats reads the trace
+ * in order, a step at a time.
+ * @param argc number of command line arguments
+ * @param argv command line arguments
+ * @return 0 if successful, nonzero otherwise
+ */
+int main(int argc, char** argv) {
+    ConvertOptions options;
+    if (parseArguments(argc, argv, options) != 0) {
+        printUsage();
+        return 1;
+    }
+
+    std::vector<std::string> class_names;
+    if (!options.classes.empty() && readClassNames(options.classes, class_names) != 0) {
+        return 1;
+    }
+
+    std::ifstream input(options.input);
+    if (!input) {
+        std::cout << "error: cannot open " << options.input << " file!" << std::endl;
+        return 1;
+    }
+
+    // Read the arrivals, skipping a header line whose time is not a number
+    std::vector<ArrivalRecord> records;
+    std::string line;
+    long line_number = 0;
+    bool first_line = true;
+    while (std::getline(input, line)) {
+        line_number++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        bool header_line = first_line;
+        first_line = false;
+        std::vector<std::string> fields = splitFields(line);
+        fields.resize(std::max((int) fields.size(), 4));
+
+        ArrivalRecord record = {0.0, 0, -1, -1, 0};
+        try {
+            record.time = std::stod(fields[0]) * options.time_scale;
+        } catch (std::exception&) {
+            if (header_line) {
+                continue;
+            }
+            std::cout << "error: malformed time on line " << line_number << " of " << options.input << std::endl;
+            return 1;
+        }
+        try {
+            record.lane = std::stoi(fields[1]);
+            if (!fields[2].empty()) {
+                record.speed = std::lround(std::stod(fields[2]) * options.speed_scale);
+            }
+        } catch (std::exception&) {
+            std::cout << "error: malformed lane or speed on line " << line_number << " of " << options.input
+                      << std::endl;
+            return 1;
+        }
+        if (record.lane < 0 || parseClass(fields[3], class_names, record.class_id) != 0) {
+            std::cout << "error: unknown lane or class on line " << line_number << " of " << options.input
+                      << std::endl;
+            return 1;
+        }
+        records.push_back(record);
+    }
+
+    // Sort the arrivals by time, keeping the order of the arrivals at the same time
+    std::stable_sort(records.begin(), records.end(), [](const ArrivalRecord& a, const ArrivalRecord& b) {
+        return a.time < b.time;
+    });
+
+    // Write the header and the records
+    FILE* output = fopen(options.output.c_str(), "wb");
+    if (output == nullptr) {
+        std::cout << "error: cannot write " << options.output << " file!" << std::endl;
+        return 1;
+    }
+    ArrivalHeader header;
+    std::copy(ARRIVAL_TRACE_MAGIC, ARRIVAL_TRACE_MAGIC + sizeof(ARRIVAL_TRACE_MAGIC), header.magic);
+    header.num_records = records.size();
+    bool written = fwrite(&header, sizeof(header), 1, output) == 1 &&
+                   fwrite(records.data(), sizeof(ArrivalRecord), records.size(), output) == records.size();
+    if (fclose(output) != 0 || !written) {
+        std::cout << "error: failed to write " << options.output << " file!" << std::endl;
+        return 1;
+    }
+
+    std::cout << "wrote " << records.size() << " arrivals to " << options.output;
+    if (!records.empty()) {
+        std::cout << ", from time " << records.front().time << " to " << records.back().time;
+    }
+    std::cout << std::endl;
+    return 0;
+}